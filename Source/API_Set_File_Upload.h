@@ -1,52 +1,29 @@
+#pragma once
+
 #include "../JuceLibraryCode/JuceHeader.h"
+#include "SplitClient.h"
 
+// SplitClient::upload() behind a progress window with a Cancel button, for the editor;
+// the protocol itself is in SplitClient, which builds without the GUI modules.
 class API_Set_File_Upload : public ThreadWithProgressWindow {
 public:
-	API_Set_File_Upload(File file_to_upload, String host_name)
+	API_Set_File_Upload(File file_to_upload, String host_name, bool encode_flac = false)
 		: ThreadWithProgressWindow("Uploading file " + file_to_upload.getFileName(), true, true, 1000, "Cancel")
-		, file_to_upload_(file_to_upload)
-		, host_name_(host_name)
+		, client_(file_to_upload, host_name, encode_flac)
 	{
 	}
 
 	virtual void run() override {
-
-		if (!file_to_upload_.existsAsFile()) {
-			response_str = "Upload file does not exist.";
-			return;
-		}
-
-		// open a URL connection to you Rest server.
-		String url_str(host_name_ + "/upload");
-		URL url(url_str);
-
-		url = url.withFileToUpload("audio", file_to_upload_, "application/octet-stream");
-		URL::OpenStreamProgressCallback * callback = &API_Set_File_Upload::ProgressCallback;
-		InputStream * input = url.createInputStream(true, callback, this);
-
-		//String result_post = input->readEntireStreamAsString();
-		//DBG("result post: " + result_post);
-		DBG("Done");
-		response_str += String("one upload done");
-
+		client_.upload([this] { return threadShouldExit(); }, [this](double progress) { setProgress(progress); });
+		DBG("Upload done: " + String(client_.getStatusCode()));
 	}
 
-	static bool ProgressCallback(void* context, int bytesSent, int totalBytes) {
-		double progress_value = bytesSent / ((double)totalBytes);
-		DBG("progress: " + String(progress_value));
-		if (static_cast<API_Set_File_Upload*>(context)->currentThreadShouldExit())
-			return false;
-		static_cast<API_Set_File_Upload*>(context)->setProgress(progress_value);
-		return true;
-	}
-	//String getResponseString() { ScopedLock l(responseLock); return response; }
+	// HTTP status of the last request that decided the outcome, 0 if none was made
+	int getStatusCode() const { return client_.getStatusCode(); }
+	String getResponseString() const { return client_.getResponseString(); }
+	bool succeeded() const { return client_.succeeded(); }
 
 protected:
-
-	File file_to_upload_;
-	String host_name_;
-	String response_str = "ok";
-	String responseLock;
-	String response;
+	SplitClient client_;
 
 };
@@ -0,0 +1,342 @@
+/*
+==============================================================================
+
+BatchRenderer.cpp
+Author: Filipe Borato
+
+==============================================================================
+*/
+
+#include "BatchRenderer.h"
+
+namespace
+{
+	// WAV and AIFF mapped into memory, as the stem preview reads them; nullptr for anything else
+	AudioFormatReader* createMappedReader(const File& file)
+	{
+		std::unique_ptr<MemoryMappedAudioFormatReader> reader;
+		if (file.hasFileExtension("wav"))
+			reader.reset(WavAudioFormat().createMemoryMappedReader(file));
+		else if (file.hasFileExtension("aif;aiff"))
+			reader.reset(AiffAudioFormat().createMemoryMappedReader(file));
+
+		if (reader == nullptr || !reader->mapEntireFile())
+			return nullptr;
+
+		return reader.release();
+	}
+}
+
+BatchRenderer::RenderJob::RenderJob(const File& input_file, const File& output_file,
+	const CompressorEngine::Parameters& params)
+	: ThreadPoolJob("Render " + input_file.getFileName())
+	, input_file_(input_file)
+	, output_file_(output_file)
+	, params_(params)
+{
+}
+
+ThreadPoolJob::JobStatus BatchRenderer::RenderJob::runJob()
+{
+	render();
+	if (error_.isNotEmpty())
+		DBG("Batch render: " + error_);
+
+	finished_ = true;
+	return jobHasFinished;
+}
+
+void BatchRenderer::RenderJob::render()
+{
+	if (output_file_ == input_file_)
+	{
+		error_ = input_file_.getFileName() + " would be overwritten, pick another output folder";
+		return;
+	}
+
+	AudioFormatManager formats;
+	formats.registerBasicFormats();
+
+	std::unique_ptr<AudioFormatReader> reader(createMappedReader(input_file_));
+	if (reader == nullptr)
+		reader.reset(formats.createReaderFor(input_file_));
+
+	if (reader == nullptr)
+	{
+		error_ = "Cannot read " + input_file_.getFileName();
+		return;
+	}
+
+	// the engine takes up to MAX_CHANNELS, surround stems included
+	const int num_channels = (int)reader->numChannels;
+	if (num_channels < 1 || num_channels > CompressorEngine::MAX_CHANNELS)
+	{
+		error_ = input_file_.getFileName() + " has more channels than the compressor takes";
+		return;
+	}
+
+	AudioFormat* format = formats.findFormatForFileExtension(output_file_.getFileExtension());
+	if (format == nullptr || (num_channels == 1 && !format->canDoMono()) || (num_channels == 2 && !format->canDoStereo()))
+	{
+		error_ = "Cannot write " + output_file_.getFileName();
+		return;
+	}
+
+	const int bits_per_sample = format->getPossibleBitDepths().contains((int)reader->bitsPerSample)
+		? (int)reader->bitsPerSample : 24;
+
+	output_file_.deleteFile();
+	std::unique_ptr<FileOutputStream> output_stream(output_file_.createOutputStream());
+	std::unique_ptr<AudioFormatWriter> writer;
+	if (output_stream != nullptr)
+		writer.reset(format->createWriterFor(output_stream.get(), reader->sampleRate, (unsigned int)num_channels,
+			bits_per_sample, reader->metadataValues, 0));
+
+	if (writer == nullptr)
+	{
+		error_ = "Cannot write " + output_file_.getFileName();
+		return;
+	}
+	output_stream.release(); // the writer owns it now
+
+	engine_.prepare(reader->sampleRate, RENDER_BLOCK_SIZE, num_channels, params_);
+
+	// the output is shifted by the engine latency: the first latency samples are
+	// dropped and the input is padded with as many zeros, so the file lines up with the source
+	const int64 length = reader->lengthInSamples;
+	const int64 latency = engine_.getLatencySamples();
+
+	AudioBuffer<float> buffer(num_channels, RENDER_BLOCK_SIZE);
+	const AudioBuffer<float> no_key;
+	int64 read_position = 0;
+	int64 written = 0;
+
+	while (written < length)
+	{
+		if (shouldExit())
+		{
+			error_ = input_file_.getFileName() + " was canceled";
+			break;
+		}
+
+		// the reader fills zeros past the end of the file
+		const int num_samples = (int)jmin((int64)RENDER_BLOCK_SIZE, length + latency - read_position);
+		AudioBuffer<float> block(buffer.getArrayOfWritePointers(), num_channels, num_samples);
+		reader->read(&block, 0, num_samples, read_position, true, true);
+
+		engine_.process(block, no_key);
+
+		const int skip = (int)jlimit((int64)0, (int64)num_samples, latency - read_position);
+		const int count = (int)jmin((int64)(num_samples - skip), length - written);
+		read_position += num_samples;
+
+		if (count > 0 && !writer->writeFromAudioSampleBuffer(block, skip, count))
+		{
+			error_ = "Write failed for " + output_file_.getFileName();
+			break;
+		}
+
+		written += jmax(0, count);
+		progress_ = length > 0 ? (float)((double)written / length) : 1.0f;
+	}
+
+	seconds_rendered_ = written / reader->sampleRate;
+}
+
+//==============================================================================
+BatchRenderer::BatchRenderer(const Array<File>& files_to_render, const File& output_directory,
+	const CompressorEngine::Parameters& params)
+	: ThreadWithProgressWindow("Batch render", true, true, 1000, "Cancel")
+	, output_directory_(output_directory)
+	, pool_(SystemStats::getNumCpus())
+{
+	for (const File& file : files_to_render)
+		jobs_.add(new RenderJob(file, output_directory_.getChildFile(file.getFileName()), params));
+}
+
+BatchRenderer::BatchRenderer(const Array<File>& files_to_render, const File& output_directory,
+	const Array<CompressorEngine::Parameters>& params, const File& mix_file)
+	: ThreadWithProgressWindow("Batch render", true, true, 1000, "Cancel")
+	, output_directory_(output_directory)
+	, mix_file_(mix_file)
+	, pool_(SystemStats::getNumCpus())
+{
+	jassert(params.size() == files_to_render.size());
+	for (int i = 0; i < files_to_render.size(); ++i)
+		jobs_.add(new RenderJob(files_to_render[i], output_directory_.getChildFile(files_to_render[i].getFileName()),
+			params[i]));
+}
+
+BatchRenderer::~BatchRenderer()
+{
+	// the jobs are owned here, not by the pool
+	pool_.removeAllJobs(true, 5000);
+}
+
+void BatchRenderer::run()
+{
+	const double start_ms = Time::getMillisecondCounterHiRes();
+
+	for (RenderJob* job : jobs_)
+		pool_.addJob(job, false);
+
+	// independent files run in parallel; this thread only reports on them
+	for (;;)
+	{
+		int num_finished = 0;
+		float total_progress = 0;
+		String running;
+
+		for (RenderJob* job : jobs_)
+		{
+			total_progress += job->progress_;
+			if (job->finished_)
+				++num_finished;
+			else if (job->isRunning())
+				running << job->input_file_.getFileName() << " " << roundToInt(job->progress_ * 100.0f) << "%  ";
+		}
+
+		setProgress(jobs_.size() > 0 ? total_progress / jobs_.size() : 1.0);
+		setStatusMessage(String(num_finished) + " of " + String(jobs_.size()) + " files done\n" + running);
+
+		if (num_finished == jobs_.size())
+			break;
+
+		if (threadShouldExit())
+		{
+			pool_.removeAllJobs(true, 5000);
+			break;
+		}
+
+		wait(100);
+	}
+
+	const double elapsed_seconds = (Time::getMillisecondCounterHiRes() - start_ms) * 0.001;
+	double seconds_rendered = 0;
+	int num_rendered = 0;
+	StringArray errors;
+
+	for (RenderJob* job : jobs_)
+	{
+		if (!job->finished_)
+			errors.add(job->input_file_.getFileName() + " was canceled");
+		else if (job->error_.isNotEmpty())
+			errors.add(job->error_);
+		else
+			++num_rendered;
+
+		seconds_rendered += job->seconds_rendered_;
+	}
+
+	summary_ = String(num_rendered) + " of " + String(jobs_.size()) + " files rendered, "
+		+ String(seconds_rendered, 1) + " s of audio in " + String(elapsed_seconds, 1) + " s ("
+		+ String(elapsed_seconds > 0 ? seconds_rendered / elapsed_seconds : 0.0, 1) + "x realtime)";
+
+	// summed once all files are in; one that failed is left out of the mix
+	if (mix_file_ != File() && num_rendered > 0 && !threadShouldExit())
+	{
+		setStatusMessage("Summing into " + mix_file_.getFileName());
+		setProgress(-1.0);
+
+		String error;
+		if (sumRenderedFiles(error))
+			summary_ << ", summed into " << mix_file_.getFileName();
+		else
+			errors.add(error);
+	}
+
+	if (errors.size() > 0)
+		summary_ << "\n" << errors.joinIntoString("\n");
+
+	DBG(summary_);
+}
+
+bool BatchRenderer::sumRenderedFiles(String& error)
+{
+	AudioFormatManager formats;
+	formats.registerBasicFormats();
+
+	OwnedArray<AudioFormatReader> readers;
+	int num_channels = 0;
+	int64 length = 0;
+	for (RenderJob* job : jobs_)
+	{
+		if (!job->finished_ || job->error_.isNotEmpty())
+			continue;
+
+		AudioFormatReader* reader = createMappedReader(job->output_file_);
+		if (reader == nullptr)
+			reader = formats.createReaderFor(job->output_file_);
+		if (reader == nullptr)
+		{
+			error = "Cannot read " + job->output_file_.getFileName() + " back for the mix";
+			return false;
+		}
+
+		readers.add(reader);
+		if (reader->sampleRate != readers[0]->sampleRate)
+		{
+			error = job->output_file_.getFileName() + " has another sample rate than the other files, not mixed";
+			return false;
+		}
+
+		num_channels = jmax(num_channels, (int)reader->numChannels);
+		length = jmax(length, reader->lengthInSamples);
+	}
+
+	AudioFormat* format = formats.findFormatForFileExtension(mix_file_.getFileExtension());
+	if (readers.isEmpty() || format == nullptr)
+	{
+		error = "Cannot write " + mix_file_.getFileName();
+		return false;
+	}
+
+	// float where the format has it, so the sum can go over full scale without clipping
+	const Array<int> bit_depths = format->getPossibleBitDepths();
+	const int bits_per_sample = bit_depths.contains(32) ? 32 : 24;
+
+	mix_file_.deleteFile();
+	std::unique_ptr<FileOutputStream> output_stream(mix_file_.createOutputStream());
+	std::unique_ptr<AudioFormatWriter> writer;
+	if (output_stream != nullptr)
+		writer.reset(format->createWriterFor(output_stream.get(), readers[0]->sampleRate, (unsigned int)num_channels,
+			bits_per_sample, {}, 0));
+
+	if (writer == nullptr)
+	{
+		error = "Cannot write " + mix_file_.getFileName();
+		return false;
+	}
+	output_stream.release(); // the writer owns it now
+
+	// mono files go to every channel of the mix, as the reader spreads them
+	AudioBuffer<float> mix(num_channels, RENDER_BLOCK_SIZE);
+	AudioBuffer<float> block(num_channels, RENDER_BLOCK_SIZE);
+	for (int64 position = 0; position < length; position += RENDER_BLOCK_SIZE)
+	{
+		if (threadShouldExit())
+		{
+			error = mix_file_.getFileName() + " was canceled";
+			return false;
+		}
+
+		const int num_samples = (int)jmin((int64)RENDER_BLOCK_SIZE, length - position);
+		mix.clear();
+		for (AudioFormatReader* reader : readers)
+		{
+			reader->read(&block, 0, num_samples, position, true, true);
+			for (int channel = 0; channel < num_channels; ++channel)
+				mix.addFrom(channel, 0, block, channel, 0, num_samples);
+		}
+
+		if (!writer->writeFromAudioSampleBuffer(mix, 0, num_samples))
+		{
+			error = "Write failed for " + mix_file_.getFileName();
+			return false;
+		}
+
+		setProgress((double)(position + num_samples) / length);
+	}
+
+	return true;
+}
@@ -0,0 +1,67 @@
+/*
+==============================================================================
+
+BatchRenderer.h
+Author: Filipe Borato
+
+==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "CompressorEngine.h"
+
+// Runs the compressor offline over a list of audio files, one file per thread pool job,
+// with the compressor settings given. Results go to
+// outputDirectory under the same file names.
+//
+// Every file can have its own settings, e.g. one chain per separated stem, and the
+// results can be summed into a mix file once they are all rendered. WAV and AIFF sources
+// are memory-mapped, so the jobs running side by side never queue on each other's reads.
+class BatchRenderer : public ThreadWithProgressWindow
+{
+public:
+	BatchRenderer(const Array<File>& files_to_render, const File& output_directory,
+		const CompressorEngine::Parameters& params);
+	// params has one entry per file; with a mix_file the rendered files are summed into it
+	BatchRenderer(const Array<File>& files_to_render, const File& output_directory,
+		const Array<CompressorEngine::Parameters>& params, const File& mix_file = {});
+	~BatchRenderer();
+
+	void run() override;
+
+	// files rendered, failures and the overall speed as a multiple of realtime
+	String getSummary() const { return summary_; }
+
+private:
+	class RenderJob : public ThreadPoolJob
+	{
+	public:
+		RenderJob(const File& input_file, const File& output_file, const CompressorEngine::Parameters& params);
+
+		JobStatus runJob() override;
+		// sets error_ when the file could not be rendered
+		void render();
+
+		File input_file_;
+		File output_file_;
+		CompressorEngine::Parameters params_;
+		CompressorEngine engine_;
+		std::atomic<float> progress_ { 0 };
+		std::atomic<bool> finished_ { false };
+		double seconds_rendered_ = 0;
+		String error_;
+	};
+
+	// adds up the files rendered without an error into mix_file_; false and error on failure
+	bool sumRenderedFiles(String& error);
+
+	// samples handed to the engine at once; it is prepared for this size
+	static const int RENDER_BLOCK_SIZE = 8192;
+
+	File output_directory_;
+	File mix_file_;
+	OwnedArray<RenderJob> jobs_;
+	ThreadPool pool_;
+	String summary_;
+};
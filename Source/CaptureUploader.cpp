@@ -0,0 +1,124 @@
+/*
+==============================================================================
+
+CaptureUploader.cpp
+Author: Filipe Borato
+
+==============================================================================
+*/
+
+#include "CaptureUploader.h"
+#include "SplitClient.h"
+
+CaptureUploader::CaptureUploader(const String& host_name, double sample_rate, int num_channels)
+	: Thread("Capture Upload")
+	, host_name_(host_name.trimCharactersAtEnd("/"))
+	, sample_rate_(sample_rate)
+	, num_channels_(num_channels)
+	, fifo_(jmax(1, roundToInt(sample_rate * CAPTURE_FIFO_SECONDS)))
+	, fifo_buffer_(num_channels, fifo_.getTotalSize())
+	, read_buffer_(num_channels, 8192)
+{
+}
+
+CaptureUploader::~CaptureUploader()
+{
+	// a capture that is still running is finished with what the FIFO holds. No timeout: the
+	// thread ends once the FIFO is drained and the upload completed, and every request of
+	// the upload has its own timeout, so killing it would only cut a finished capture short
+	stop();
+	waitForThreadToExit(-1);
+}
+
+void CaptureUploader::stop()
+{
+	stop_requested_ = true;
+	notify();
+}
+
+void CaptureUploader::push(const float* const* channels, int num_channels, int num_samples)
+{
+	int start1, size1, start2, size2;
+	fifo_.prepareToWrite(num_samples, start1, size1, start2, size2);
+
+	for (int channel = 0; channel < num_channels_; ++channel)
+	{
+		// a mono block fills every capture channel
+		const float* source = channels[jmin(channel, num_channels - 1)];
+		if (size1 > 0)
+			fifo_buffer_.copyFrom(channel, start1, source, size1);
+		if (size2 > 0)
+			fifo_buffer_.copyFrom(channel, start2, source + size1, size2);
+	}
+
+	fifo_.finishedWrite(size1 + size2);
+	if (size1 + size2 < num_samples)
+		num_dropped_ += num_samples - size1 - size2;
+}
+
+int CaptureUploader::drain(AudioFormatWriter& writer)
+{
+	int start1, size1, start2, size2;
+	fifo_.prepareToRead(read_buffer_.getNumSamples(), start1, size1, start2, size2);
+
+	for (int channel = 0; channel < num_channels_; ++channel)
+	{
+		if (size1 > 0)
+			read_buffer_.copyFrom(channel, 0, fifo_buffer_, channel, start1, size1);
+		if (size2 > 0)
+			read_buffer_.copyFrom(channel, size1, fifo_buffer_, channel, start2, size2);
+	}
+
+	fifo_.finishedRead(size1 + size2);
+
+	if (size1 + size2 > 0)
+		writer.writeFromAudioSampleBuffer(read_buffer_, 0, size1 + size2);
+
+	return size1 + size2;
+}
+
+void CaptureUploader::run()
+{
+	const String file_name = "Capture " + Time::getCurrentTime().formatted("%Y-%m-%d %H-%M-%S") + ".flac";
+
+	std::unique_ptr<ChunkedUploadStream> stream(new ChunkedUploadStream(host_name_, Uuid().toDashedString(), file_name));
+	stream->onComplete = [this](int status_code, const String& response) { setResponse(status_code, response); };
+
+	std::unique_ptr<AudioFormatWriter> writer(FlacAudioFormat().createWriterFor(stream.get(), sample_rate_,
+		(unsigned int)num_channels_, 24, {}, FLAC_QUALITY));
+
+	if (writer == nullptr)
+	{
+		stream->cancel();
+		setResponse(0, "Cannot create the capture encoder");
+		return;
+	}
+	stream.release(); // the writer owns it now
+
+	// only stop() ends the capture, and only once the FIFO is empty
+	for (;;)
+	{
+		// read before draining, so everything pushed before stop() still goes out
+		const bool stopping = stop_requested_;
+		if (drain(*writer) == 0)
+		{
+			if (stopping)
+				break;
+
+			wait(20);
+		}
+	}
+
+	if (num_dropped_ > 0)
+		DBG("Capture dropped " + String(num_dropped_) + " samples");
+
+	// writes the final STREAMINFO through the stream, which then completes the upload
+	writer = nullptr;
+}
+
+void CaptureUploader::setResponse(int status_code, const String& response)
+{
+	ScopedLock l(response_lock_);
+	status_code_ = status_code;
+	response_ = response;
+}
@@ -0,0 +1,60 @@
+/*
+==============================================================================
+
+CaptureUploader.h
+Author: Filipe Borato
+
+==============================================================================
+*/
+#pragma once
+
+#include "HeadlessHeader.h"
+#include "ChunkedUploadStream.h"
+
+// Records the processor's output and streams it to the Split server while it is captured.
+// The audio thread only copies into a preallocated lock-free FIFO; a background thread
+// encodes FLAC from the FIFO into a ChunkedUploadStream, so the server has the audio
+// before the capture ends.
+class CaptureUploader : private Thread
+{
+public:
+	static const int CAPTURE_FIFO_SECONDS = 10;
+	static const int FLAC_QUALITY = 5; // FlacAudioFormat quality index, the flac tool default
+
+	CaptureUploader(const String& host_name, double sample_rate, int num_channels);
+	~CaptureUploader();
+
+	void start() { startThread(); }
+	// finishes the capture: the FIFO is drained, the last chunk and the header sent and the
+	// upload completed; returns straight away, the thread does the rest. Deleting the
+	// uploader waits for all of that, so delete it once isFinished()
+	void stop();
+	bool isFinished() const { return !isThreadRunning(); }
+
+	// audio thread: copies numSamples of every channel into the FIFO, never blocks or allocates
+	void push(const float* const* channels, int num_channels, int num_samples);
+
+	// samples the FIFO had no room for
+	int getNumDropped() const { return num_dropped_; }
+	int getStatusCode() const { ScopedLock l(response_lock_); return status_code_; }
+	String getResponseString() const { ScopedLock l(response_lock_); return response_; }
+
+private:
+	void run() override;
+	int drain(AudioFormatWriter& writer);
+	void setResponse(int status_code, const String& response);
+
+	String host_name_;
+	double sample_rate_;
+	int num_channels_;
+
+	AbstractFifo fifo_;
+	AudioBuffer<float> fifo_buffer_;
+	AudioBuffer<float> read_buffer_;
+	std::atomic<int> num_dropped_ { 0 };
+	std::atomic<bool> stop_requested_ { false };
+
+	CriticalSection response_lock_;
+	int status_code_ = 0;
+	String response_;
+};
@@ -0,0 +1,187 @@
+/*
+==============================================================================
+
+ChunkedUploadStream.cpp
+Author: Filipe Borato
+
+==============================================================================
+*/
+
+#include "ChunkedUploadStream.h"
+#include "SplitClient.h"
+
+ChunkedUploadStream::ChunkedUploadStream(const String& host_name, const String& upload_id, const String& file_name)
+	: Thread("Chunk Upload")
+	, host_name_(host_name.trimCharactersAtEnd("/"))
+	, upload_id_(upload_id)
+	, file_name_(file_name)
+	, pending_(SplitClient::CHUNK_SIZE)
+{
+	startThread();
+}
+
+ChunkedUploadStream::~ChunkedUploadStream()
+{
+	finish();
+}
+
+void ChunkedUploadStream::cancel()
+{
+	cancelled_ = true;
+	queue_space_.signal();
+	notify();
+}
+
+bool ChunkedUploadStream::setPosition(int64 new_position)
+{
+	if (new_position < 0 || new_position > pending_offset_ + (int64)pending_size_)
+		return false;
+
+	position_ = new_position;
+	return true;
+}
+
+bool ChunkedUploadStream::write(const void* data, size_t num_bytes)
+{
+	if (cancelled_ || failed_)
+		return false;
+
+	const char* source = static_cast<const char*>(data);
+
+	// the part that lands on bytes already queued is kept and sent again at the end
+	if (position_ < pending_offset_)
+	{
+		const size_t num_queued = (size_t)jmin((int64)num_bytes, pending_offset_ - position_);
+		patches_.push_back({ position_, MemoryBlock(source, num_queued) });
+		position_ += num_queued;
+		source += num_queued;
+		num_bytes -= num_queued;
+	}
+
+	if (num_bytes > 0)
+	{
+		const size_t at = (size_t)(position_ - pending_offset_);
+		if (at + num_bytes > pending_.getSize())
+			pending_.setSize(jmax(at + num_bytes, pending_.getSize() * 2));
+
+		memcpy(static_cast<char*>(pending_.getData()) + at, source, num_bytes);
+		pending_size_ = jmax(pending_size_, at + num_bytes);
+		position_ += num_bytes;
+	}
+
+	// a whole chunk goes out as soon as the writer is appending past it
+	if (position_ == pending_offset_ + (int64)pending_size_ && pending_size_ >= (size_t)SplitClient::CHUNK_SIZE)
+	{
+		queueChunk({ pending_offset_, MemoryBlock(pending_.getData(), pending_size_) });
+		pending_offset_ += (int64)pending_size_;
+		pending_size_ = 0;
+	}
+
+	return !failed_;
+}
+
+void ChunkedUploadStream::queueChunk(Range&& chunk)
+{
+	// the encoder waits here while MAX_CHUNKS_QUEUED chunks are still on their way
+	for (;;)
+	{
+		{
+			const ScopedLock l(queue_lock_);
+			if ((int)queue_.size() < MAX_CHUNKS_QUEUED || cancelled_ || failed_)
+			{
+				queue_.push_back(std::move(chunk));
+				break;
+			}
+		}
+
+		queue_space_.wait(50);
+	}
+
+	notify();
+}
+
+void ChunkedUploadStream::run()
+{
+	for (;;)
+	{
+		Range chunk;
+		bool have_chunk = false;
+		{
+			const ScopedLock l(queue_lock_);
+			if (!queue_.empty())
+			{
+				chunk = std::move(queue_.front());
+				queue_.pop_front();
+				have_chunk = true;
+			}
+		}
+
+		if (cancelled_ || failed_)
+			break;
+
+		if (!have_chunk)
+		{
+			if (closing_)
+				break;
+
+			wait(50);
+			continue;
+		}
+
+		// the total isn't known while the encoder is still writing
+		sendWithRetries(chunk, -1);
+		queue_space_.signal();
+	}
+
+	queue_space_.signal();
+}
+
+bool ChunkedUploadStream::sendWithRetries(const Range& range, int64 total_bytes)
+{
+	for (int attempt = 0; attempt <= SplitClient::MAX_RETRIES && !cancelled_; ++attempt)
+	{
+		if (attempt > 0)
+			Thread::sleep(250 << attempt);
+
+		int status_code = 0;
+		if (SplitClient::postChunk(host_name_, upload_id_, file_name_, range.offset, range.data, total_bytes,
+			status_code, last_error_))
+		{
+			bytes_sent_ += (int64)range.data.getSize();
+			return true;
+		}
+
+		last_error_ = "Chunk at byte " + String(range.offset) + " failed (" + String(status_code) + "): " + last_error_;
+	}
+
+	failed_ = true;
+	return false;
+}
+
+void ChunkedUploadStream::finish()
+{
+	closing_ = true;
+	notify();
+	stopThread(-1); // the sender only exits once the queue is empty, failed or cancelled
+
+	if (cancelled_)
+		return;
+
+	const int64 total_bytes = pending_offset_ + (int64)pending_size_;
+
+	if (!failed_ && pending_size_ > 0)
+		sendWithRetries({ pending_offset_, MemoryBlock(pending_.getData(), pending_size_) }, total_bytes);
+
+	for (const Range& patch : patches_)
+		if (!failed_)
+			sendWithRetries(patch, total_bytes);
+
+	int status_code = 0;
+	String response = last_error_;
+	if (!failed_)
+		status_code = SplitClient::postComplete(host_name_, upload_id_, file_name_, total_bytes, response, content_hash_);
+
+	DBG("Chunked upload of " + file_name_ + " done: " + String(status_code));
+	if (onComplete)
+		onComplete(status_code, response);
+}
@@ -0,0 +1,80 @@
+/*
+==============================================================================
+
+ChunkedUploadStream.h
+Author: Filipe Borato
+
+==============================================================================
+*/
+#pragma once
+
+#include "HeadlessHeader.h"
+#include <deque>
+
+// OutputStream that uploads everything written to it with the SplitClient chunk
+// protocol, for encoders writing straight to the Split server.
+//
+// Every full chunk is handed to a sender thread, so the encoder keeps running while the
+// previous chunk is on the wire; at most MAX_CHUNKS_QUEUED chunks wait, which bounds the
+// memory. Audio writers seek back to fill in their headers once they are done; bytes
+// rewritten after they were sent are posted again as their own range at the end.
+//
+// The writer deletes its stream after writing the final header, so the upload is completed
+// in the destructor and the result goes to onComplete, on the thread that deletes it.
+class ChunkedUploadStream : public OutputStream, private Thread
+{
+public:
+	static const int MAX_CHUNKS_QUEUED = 2;
+
+	ChunkedUploadStream(const String& host_name, const String& upload_id, const String& file_name);
+	~ChunkedUploadStream();
+
+	// drops the upload: nothing more is sent and onComplete is not called
+	void cancel();
+
+	// sent with the completion so the server can index the result; set before writing
+	void setContentHash(const String& hash) { content_hash_ = hash; }
+
+	// bytes the server has acknowledged so far
+	int64 getNumBytesSent() const { return bytes_sent_; }
+
+	std::function<void(int status_code, const String& response)> onComplete;
+
+	void flush() override {}
+	bool setPosition(int64 new_position) override;
+	int64 getPosition() override { return position_; }
+	bool write(const void* data, size_t num_bytes) override;
+
+private:
+	struct Range
+	{
+		int64 offset;
+		MemoryBlock data;
+	};
+
+	void run() override;
+	void queueChunk(Range&& chunk);
+	bool sendWithRetries(const Range& range, int64 total_bytes);
+	// waits for the queue, sends the tail and the rewritten ranges, then completes the upload
+	void finish();
+
+	String host_name_;
+	String upload_id_;
+	String file_name_;
+	String content_hash_;
+
+	MemoryBlock pending_;    // not queued yet, starts at pending_offset_
+	size_t pending_size_ = 0;
+	int64 pending_offset_ = 0;
+	int64 position_ = 0;
+	std::vector<Range> patches_;
+
+	CriticalSection queue_lock_;
+	std::deque<Range> queue_;
+	WaitableEvent queue_space_;
+	std::atomic<bool> closing_ { false };
+	std::atomic<bool> cancelled_ { false };
+	std::atomic<bool> failed_ { false };
+	std::atomic<int64> bytes_sent_ { 0 };
+	String last_error_; // written by whichever thread is sending
+};
@@ -0,0 +1,727 @@
+/*
+==============================================================================
+
+CompressorEngine.cpp
+Author: Filipe Borato
+
+==============================================================================
+*/
+
+#include "CompressorEngine.h"
+
+CompressorEngine::Parameters CompressorEngine::Parameters::fromState(const ValueTree& state, const Parameters& base)
+{
+	Parameters params = base;
+	auto read = [&state](const char* id, float fDefault)
+	{
+		const ValueTree param = state.getChildWithProperty("id", id);
+		return param.isValid() ? (float)param["value"] : fDefault;
+	};
+
+	params.detGain = read("DetGain", params.detGain);
+	params.threshold = read("Threshold", params.threshold);
+	params.attackTime = read("AttackTime", params.attackTime);
+	params.releaseTime = read("ReleaseTime", params.releaseTime);
+	params.ratio = read("Ratio", params.ratio);
+	params.outputGain = read("OutputGain", params.outputGain);
+	params.kneeWidth = read("KneeWidth", params.kneeWidth);
+	params.stereoLink = roundToInt(read("StereoLink", (float)params.stereoLink));
+	params.oversampling = roundToInt(read("Oversampling", (float)params.oversampling));
+	params.lookahead = read("Lookahead", params.lookahead);
+	params.bands = roundToInt(read("Bands", (float)params.bands));
+	params.lowCrossover = read("LowCrossover", params.lowCrossover);
+	params.midCrossover = read("MidCrossover", params.midCrossover);
+	params.highCrossover = read("HighCrossover", params.highCrossover);
+	params.externalKey = read("ExternalKey", params.externalKey ? 1.0f : 0.0f) > 0.5f;
+	params.keyHighPass = read("KeyHighPass", params.keyHighPass);
+	params.autoRelease = read("AutoRelease", params.autoRelease ? 1.0f : 0.0f) > 0.5f;
+	params.mix = read("Mix", params.mix);
+	return params;
+}
+
+float CompressorEngine::calcCompressorGain(float fDetectorValue, float fThreshold,
+	float fRatio, float fKneeWidth, bool bLimit)
+{
+	// slope variable
+	float CS = 1.0 - 1.0 / fRatio; // [ Eq. 13.1 ]
+								   // limiting is infinite ratio thus CS->1.0
+								   //if (bLimit)
+								   //CS = 1;
+
+								   // soft-knee with detection value in range?
+	if (fKneeWidth > 0 && fDetectorValue > (fThreshold - fKneeWidth / 2.0) &&
+		fDetectorValue < fThreshold + fKneeWidth / 2.0)
+	{
+		// setup for Lagrange
+		double x[2];
+		double y[2];
+		x[0] = fThreshold - fKneeWidth / 2.0;
+		x[1] = fThreshold + fKneeWidth / 2.0;
+		x[1] = min(0, x[1]); // top limit is 0dBFS
+		y[0] = 0; // CS = 0 for 1:1 ratio
+		y[1] = CS; // current CS
+
+				   // interpolate & overwrite CS
+		CS = lagrpol(&x[0], &y[0], 2, fDetectorValue);
+	}
+	// compute gain; threshold and detection values are in dB
+	float yG = CS * (fThreshold - fDetectorValue); // [ Eq. 13.1 ]
+												   // clamp; this allows ratios of 1:1 to still operate
+	yG = min(0, yG);
+
+	// convert back to linear
+	return pow(10.0, yG / 20.0);
+}
+
+void CompressorEngine::prepare(double sampleRate, int maxBlockSize, int numChannels, const Parameters& params)
+{
+	m_Params = params;
+	m_dSampleRate = sampleRate;
+	m_nMaxBlockSize = jmax(1, maxBlockSize);
+	// everything per channel is set up for this many; process() never goes beyond it
+	m_nChannels = jlimit(1, MAX_CHANNELS, numChannels);
+
+	m_fAttackTime_mSec = m_Params.attackTime;
+	m_fReleaseTime_mSec = m_Params.releaseTime;
+
+	// all oversampling buffers are allocated up front for 4x, switching never allocates;
+	// the audio channels come first, then the two external key channels
+	m_Oversampler.init(m_nChannels + 2, m_nMaxBlockSize);
+	m_Oversampler.setFactorLog2(m_Params.oversampling);
+	m_Oversampler.reset();
+
+	// DigitalAnalogue == true is digital style, i.e. no analog time constants;
+	// the detectors run at the oversampled rate
+	const float fDetectorRate = (float)(sampleRate * m_Oversampler.getFactor());
+	for (int channel = 0; channel < m_nChannels; ++channel)
+		m_Detectors[channel].init(fDetectorRate, m_fAttackTime_mSec, m_fReleaseTime_mSec,
+			!DigitalAnalogue, DETECT_MODE_RMS, true);
+
+	// the lookahead delay runs at the working rate, so it is sized for 4x as well
+	const int nMaxLookahead = (int)ceil(MAX_LOOKAHEAD_MSEC * 0.001 * sampleRate);
+	for (int channel = 0; channel < m_nChannels; ++channel)
+	{
+		m_LookaheadDelay[channel].init(nMaxLookahead << COversampler::MAX_FACTOR_LOG2,
+			m_nMaxBlockSize << COversampler::MAX_FACTOR_LOG2);
+		m_LookaheadDelay[channel].reset();
+		m_LookaheadDelayDouble[channel].init(nMaxLookahead, m_nMaxBlockSize);
+		m_LookaheadDelayDouble[channel].reset();
+	}
+
+	// the dry signal waits out the whole latency, lookahead and oversampling at its largest
+	const int nMaxLatency = nMaxLookahead + (int)m_Oversampler.getLatency(COversampler::MAX_FACTOR_LOG2);
+	for (int channel = 0; channel < m_nChannels; ++channel)
+	{
+		m_DryDelay[channel].init(nMaxLatency, m_nMaxBlockSize);
+		m_DryDelay[channel].reset();
+		m_DryDelayDouble[channel].init(nMaxLatency, m_nMaxBlockSize);
+		m_DryDelayDouble[channel].reset();
+	}
+
+	// the multiband path has its own crossovers, detector state and band delay lines
+	m_nBands = m_Params.bands == 0 ? 0 : m_Params.bands + 2;
+	m_Multiband.init(m_nChannels,
+		m_nMaxBlockSize << COversampler::MAX_FACTOR_LOG2, nMaxLookahead << COversampler::MAX_FACTOR_LOG2);
+	m_Multiband.setNumBands(m_nBands == 0 ? 3 : m_nBands);
+	m_Multiband.setCrossovers(m_Params.lowCrossover, m_Params.midCrossover, m_Params.highCrossover);
+	m_Multiband.setSampleRate(fDetectorRate);
+	m_Multiband.getDetector().init(fDetectorRate, m_fAttackTime_mSec, m_fReleaseTime_mSec,
+		!DigitalAnalogue, DETECT_MODE_RMS, true);
+
+	m_bAutoRelease = m_Params.autoRelease;
+	for (int channel = 0; channel < m_nChannels; ++channel)
+		m_Detectors[channel].setAutoRelease(m_bAutoRelease);
+	m_Multiband.setAutoRelease(m_bAutoRelease);
+
+	m_nLookaheadSamples = roundToInt(m_Params.lookahead * 0.001 * sampleRate);
+	updateLookaheadDelay();
+
+	m_bExternalKey = m_Params.externalKey;
+	m_fKeyHighPass_Hz = m_Params.keyHighPass;
+	updateKeyFilter();
+	for (int channel = 0; channel < m_nChannels; ++channel)
+		m_KeyFilter[channel].reset();
+
+	m_InputMeter.init((float)sampleRate);
+	m_OutputMeter.init((float)sampleRate);
+	m_GainReductionMeter.reset();
+	m_GainHistory.init((float)sampleRate);
+
+	m_nLatencySamples = calcLatencySamples();
+	updateDryDelay();
+
+	// short ramps against zipper noise; start on the current values
+	m_InputGain.reset(sampleRate, 0.02);
+	m_OutputGain.reset(sampleRate, 0.02);
+	m_Threshold.reset(sampleRate, 0.05);
+	m_Ratio.reset(sampleRate, 0.05);
+	m_KneeWidth.reset(sampleRate, 0.05);
+	m_Mix.reset(sampleRate, 0.02);
+
+	m_InputGain.setCurrentAndTargetValue(fastdBToLinear(m_Params.detGain));
+	m_OutputGain.setCurrentAndTargetValue(fastdBToLinear(m_Params.outputGain));
+	m_Threshold.setCurrentAndTargetValue(m_Params.threshold);
+	m_Ratio.setCurrentAndTargetValue(m_Params.ratio);
+	m_KneeWidth.setCurrentAndTargetValue(m_Params.kneeWidth);
+	m_Mix.setCurrentAndTargetValue(m_Params.mix * 0.01f);
+
+	m_nQuantumPos = 0;
+	m_fBlockMinGain = 1.0f;
+	m_fBlockMaxGain = 0.0f;
+	m_nGainRangeSamples = 0;
+
+	// scratch space for detectBlock(); process() works in chunks of m_nMaxBlockSize
+	m_DetectorBuffer.setSize(1, m_nMaxBlockSize << COversampler::MAX_FACTOR_LOG2);
+	m_RampBuffer.setSize(3, m_nMaxBlockSize);
+	m_ConvertBuffer.setSize(m_nChannels, m_nMaxBlockSize);
+	m_KeyBuffer.setSize(jmax(2, m_nChannels), m_nMaxBlockSize << COversampler::MAX_FACTOR_LOG2);
+	m_KeyInputBuffer.setSize(2, m_nMaxBlockSize);
+	m_DryBuffer.setSize(m_nChannels, m_nMaxBlockSize);
+	m_DryBufferDouble.setSize(m_nChannels, m_nMaxBlockSize);
+}
+
+void CompressorEngine::setDetectorRate(float fRate)
+{
+	for (int channel = 0; channel <= m_nChannels; ++channel)
+	{
+		// the multiband detector last
+		CEnvelopeDetector& detector = channel < m_nChannels ? m_Detectors[channel] : m_Multiband.getDetector();
+		detector.setSampleRate(fRate);
+		detector.setAttackTime(m_fAttackTime_mSec);
+		detector.setReleaseTime(m_fReleaseTime_mSec);
+	}
+
+	// the crossovers and the key filter sit at the working rate as well
+	m_Multiband.setSampleRate(fRate);
+	updateKeyFilter();
+}
+
+void CompressorEngine::setOversampling(int nFactorLog2)
+{
+	m_Oversampler.setFactorLog2(nFactorLog2);
+	setDetectorRate((float)(m_dSampleRate * m_Oversampler.getFactor()));
+
+	updateLookaheadDelay();
+	for (int channel = 0; channel < m_nChannels; ++channel)
+	{
+		m_LookaheadDelay[channel].reset();
+		m_LookaheadDelayDouble[channel].reset();
+	}
+	m_Multiband.reset();
+
+	m_nLatencySamples = calcLatencySamples();
+	updateDryDelay();
+}
+
+void CompressorEngine::updateLookaheadDelay()
+{
+	// whole base rate samples, so the reported latency stays exact when oversampling
+	for (int channel = 0; channel < m_nChannels; ++channel)
+	{
+		m_LookaheadDelay[channel].setDelay(m_nLookaheadSamples * m_Oversampler.getFactor());
+		m_LookaheadDelayDouble[channel].setDelay(m_nLookaheadSamples); // only used without oversampling
+	}
+	m_Multiband.setLookahead(m_nLookaheadSamples * m_Oversampler.getFactor());
+}
+
+void CompressorEngine::updateKeyFilter()
+{
+	const float fRate = (float)(m_dSampleRate * m_Oversampler.getFactor());
+	m_bKeyFilter = m_fKeyHighPass_Hz > KEY_HIGH_PASS_OFF_HZ;
+	for (int channel = 0; channel < m_nChannels; ++channel)
+		m_KeyFilter[channel].setHighPass(jmin(m_fKeyHighPass_Hz, 0.45f * fRate), fRate, BUTTERWORTH_Q);
+}
+
+int CompressorEngine::calcLatencySamples() const
+{
+	// the oversampler's round trip is a whole number of samples, so the dry path lines up
+	// with the wet one exactly and Mix below 100% doesn't comb-filter
+	const int nOversamplerLatency = (int)m_Oversampler.getLatency();
+	jassert((float)nOversamplerLatency == m_Oversampler.getLatency());
+	return nOversamplerLatency + m_nLookaheadSamples;
+}
+
+void CompressorEngine::updateDryDelay()
+{
+	for (int channel = 0; channel < m_nChannels; ++channel)
+	{
+		m_DryDelay[channel].setDelay(m_nLatencySamples);
+		m_DryDelayDouble[channel].setDelay(m_nLatencySamples);
+	}
+}
+
+bool CompressorEngine::pullParameters()
+{
+	m_InputGain.setTargetValue(fastdBToLinear(m_Params.detGain));
+	m_OutputGain.setTargetValue(fastdBToLinear(m_Params.outputGain));
+	m_Threshold.setTargetValue(m_Params.threshold);
+	m_Ratio.setTargetValue(m_Params.ratio);
+	m_KneeWidth.setTargetValue(m_Params.kneeWidth);
+	m_Mix.setTargetValue(m_Params.mix * 0.01f);
+
+	// exp() only when the time constants actually move
+	if (m_Params.attackTime != m_fAttackTime_mSec)
+	{
+		m_fAttackTime_mSec = m_Params.attackTime;
+		for (int channel = 0; channel < m_nChannels; ++channel)
+			m_Detectors[channel].setAttackTime(m_fAttackTime_mSec);
+		m_Multiband.getDetector().setAttackTime(m_fAttackTime_mSec);
+	}
+
+	if (m_Params.releaseTime != m_fReleaseTime_mSec)
+	{
+		m_fReleaseTime_mSec = m_Params.releaseTime;
+		for (int channel = 0; channel < m_nChannels; ++channel)
+			m_Detectors[channel].setReleaseTime(m_fReleaseTime_mSec);
+		m_Multiband.getDetector().setReleaseTime(m_fReleaseTime_mSec);
+	}
+
+	if (m_Params.autoRelease != m_bAutoRelease)
+	{
+		m_bAutoRelease = !m_bAutoRelease;
+		for (int channel = 0; channel < m_nChannels; ++channel)
+			m_Detectors[channel].setAutoRelease(m_bAutoRelease);
+		m_Multiband.setAutoRelease(m_bAutoRelease);
+	}
+
+	m_uStereoLink = (UINT)m_Params.stereoLink;
+
+	m_bExternalKey = m_Params.externalKey;
+	if (m_Params.keyHighPass != m_fKeyHighPass_Hz)
+	{
+		m_fKeyHighPass_Hz = m_Params.keyHighPass;
+		updateKeyFilter();
+	}
+
+	// Bands choice 1 and 2 are 3 and 4 bands; the multiband state starts clean on a switch
+	const int nBandsChoice = m_Params.bands;
+	const int nBands = nBandsChoice == 0 ? 0 : nBandsChoice + 2;
+	if (nBands != m_nBands)
+	{
+		m_nBands = nBands;
+		if (m_nBands != 0)
+			m_Multiband.setNumBands(m_nBands);
+		m_Multiband.reset();
+	}
+	m_Multiband.setCrossovers(m_Params.lowCrossover, m_Params.midCrossover, m_Params.highCrossover);
+
+	const int nFactorLog2 = m_Params.oversampling;
+	if (nFactorLog2 != m_Oversampler.getFactorLog2())
+		setOversampling(nFactorLog2);
+
+	const int nLookahead = roundToInt(m_Params.lookahead * 0.001 * m_dSampleRate);
+	if (nLookahead != m_nLookaheadSamples)
+	{
+		m_nLookaheadSamples = nLookahead;
+		updateLookaheadDelay();
+		m_nLatencySamples = calcLatencySamples();
+		updateDryDelay();
+	}
+
+	return m_InputGain.isSmoothing() || m_OutputGain.isSmoothing() || m_Threshold.isSmoothing()
+		|| m_Ratio.isSmoothing() || m_KneeWidth.isSmoothing();
+}
+
+void CompressorEngine::advanceParameters(int numSamples)
+{
+	// setParameters() is a no-op once the ramps have settled
+	m_GainComputer.setParameters(m_Threshold.skip(numSamples), m_Ratio.skip(numSamples),
+		m_KneeWidth.skip(numSamples));
+}
+
+void CompressorEngine::fillRamp(LinearSmoothedValue<float>& smoother, float* pRamp, int numSamples)
+{
+	for (int i = 0; i < numSamples; ++i)
+		pRamp[i] = smoother.getNextValue();
+}
+
+namespace
+{
+	// the detector and gain computer run in float whatever the audio is; these carry their
+	// control signals to and from the sample type without a round-trip for float audio
+	inline const float* toFloat(const float* pSamples, float*, int)
+	{
+		return pSamples;
+	}
+
+	inline const float* toFloat(const double* pSamples, float* pScratch, int numSamples)
+	{
+		for (int i = 0; i < numSamples; ++i)
+			pScratch[i] = (float)pSamples[i];
+		return pScratch;
+	}
+
+	inline void multiplySamples(float* pSamples, const float* pGain, int numSamples)
+	{
+		FloatVectorOperations::multiply(pSamples, pGain, numSamples);
+	}
+
+	inline void multiplySamples(double* pSamples, const float* pGain, int numSamples)
+	{
+		for (int i = 0; i < numSamples; ++i)
+			pSamples[i] *= pGain[i];
+	}
+
+	// largest magnitude in a block, vectorised
+	inline float findPeak(const float* pSamples, int numSamples)
+	{
+		const Range<float> range = FloatVectorOperations::findMinAndMax(pSamples, numSamples);
+		return jmax(-range.getStart(), range.getEnd());
+	}
+
+	template <typename DestType, typename SourceType>
+	inline void copySamples(DestType* pDest, const SourceType* pSource, int numSamples)
+	{
+		for (int i = 0; i < numSamples; ++i)
+			pDest[i] = (DestType)pSource[i];
+	}
+
+	// pWet = pDry + fMix * (pWet - pDry), as two vector passes
+	template <typename SampleType>
+	inline void mixSamples(SampleType* pWet, const SampleType* pDry, float fMix, int numSamples)
+	{
+		FloatVectorOperations::multiply(pWet, (SampleType)fMix, numSamples);
+		FloatVectorOperations::addWithMultiply(pWet, pDry, (SampleType)(1.0f - fMix), numSamples);
+	}
+
+	// mixSamples() with the mix ramped per sample
+	template <typename SampleType>
+	inline void mixSamples(SampleType* pWet, const SampleType* pDry, const float* pMix, int numSamples)
+	{
+		for (int i = 0; i < numSamples; ++i)
+			pWet[i] = pDry[i] + pMix[i] * (pWet[i] - pDry[i]);
+	}
+}
+
+template <typename SampleType>
+void CompressorEngine::processBypassed(AudioBuffer<SampleType>& buffer)
+{
+	// the dry path alone: the output keeps the latency the host was told about, and the
+	// dry delay is primed for when the compressor comes back
+	if (m_nMaxBlockSize == 0)
+		return;
+
+	const int numChannels = jmin(buffer.getNumChannels(), m_nChannels);
+	for (int channel = 0; channel < numChannels; ++channel)
+	{
+		SampleType* pSamples = buffer.getWritePointer(channel);
+		for (int start = 0; start < buffer.getNumSamples(); start += m_nMaxBlockSize)
+			getDryDelay(channel, pSamples).process(pSamples + start, jmin(buffer.getNumSamples() - start, m_nMaxBlockSize));
+	}
+}
+
+template <typename SampleType>
+void CompressorEngine::process(AudioBuffer<SampleType>& buffer, const AudioBuffer<SampleType>& key)
+{
+	ScopedNoDenormals noDenormals;
+
+	const int numSamples = buffer.getNumSamples();
+	const int numChannels = jmin(buffer.getNumChannels(), m_nChannels);
+	const int chunkSize = m_nMaxBlockSize;
+	jassert(chunkSize > 0); // prepare() sizes the scratch buffers
+	if (chunkSize == 0)
+		return;
+
+	float* inputRamp = m_RampBuffer.getWritePointer(0);
+	float* outputRamp = m_RampBuffer.getWritePointer(1);
+	float* mixRamp = m_RampBuffer.getWritePointer(2);
+	AudioBuffer<SampleType>& dryBuffer = getDryBuffer(buffer);
+
+	// the external key is read where the caller put it, float blocks without a copy; it only
+	// keys the single band detector, the multiband path keys from its own bands
+	jassert(key.getNumChannels() == 0 || key.getNumSamples() >= numSamples);
+	const int numKeyChannels = jmin(key.getNumChannels(), 2);
+
+	// The wrappers hand us parameter changes at block boundaries, so the change points
+	// inside a block are the smoothing ramps: while something moves we step through it a
+	// quantum at a time, otherwise in as many whole quanta as fit in the chunk. Either way a
+	// sub-block ends on the quantum grid, so a 1 sample and an 8192 sample host step the
+	// curve and the meters at the same sample positions
+	for (int start = 0; start < numSamples; )
+	{
+		const bool bMoving = pullParameters();
+		const int nToBoundary = PROCESS_QUANTUM - m_nQuantumPos;
+		int n = jmin(numSamples - start, chunkSize);
+		if (bMoving || n < nToBoundary)
+			n = jmin(n, nToBoundary);
+		else
+			n = nToBoundary + (n - nToBoundary) / PROCESS_QUANTUM * PROCESS_QUANTUM;
+
+		// the curve moves on at the start of a quantum, by the whole quantum
+		if (m_nQuantumPos == 0)
+			advanceParameters(jmax(n, (int)PROCESS_QUANTUM));
+
+		// the dry signal before the input gain, delayed to line up with the compressed one;
+		// it runs at every mix so the delay is always primed
+		for (int channel = 0; channel < numChannels; ++channel)
+		{
+			SampleType* pDry = dryBuffer.getWritePointer(channel);
+			FloatVectorOperations::copy(pDry, buffer.getReadPointer(channel, start), n);
+			getDryDelay(channel, pDry).process(pDry, n);
+		}
+
+		// input gain, ramped only while it is moving
+		if (m_InputGain.isSmoothing())
+		{
+			fillRamp(m_InputGain, inputRamp, n);
+			for (int channel = 0; channel < numChannels; ++channel)
+				multiplySamples(buffer.getWritePointer(channel, start), inputRamp, n);
+		}
+		else
+		{
+			for (int channel = 0; channel < numChannels; ++channel)
+				FloatVectorOperations::multiply(buffer.getWritePointer(channel, start),
+					(SampleType)m_InputGain.getTargetValue(), n);
+		}
+
+		const SampleType* inputs[MAX_CHANNELS];
+		for (int channel = 0; channel < numChannels; ++channel)
+			inputs[channel] = buffer.getReadPointer(channel, start);
+		m_InputMeter.process(inputs, numChannels, n);
+
+		// a steady make up gain goes into the gain block; a moving one is ramped at the end
+		const bool bOutputRamp = m_OutputGain.isSmoothing();
+		const float fMakeUpGain = bOutputRamp ? 1.0f : m_OutputGain.getTargetValue();
+
+		const float* keys[2];
+		const int numKeys = m_bExternalKey ? numKeyChannels : 0;
+		for (int channel = 0; channel < numKeys; ++channel)
+			keys[channel] = toFloat(key.getReadPointer(channel, start), m_KeyInputBuffer.getWritePointer(channel), n);
+
+		// compressBlock() widens m_fBlockMinGain/m_fBlockMaxGain to the gains it applied;
+		// the meters get them when the quantum is complete
+		compressSubBlock(buffer, start, n, numChannels, fMakeUpGain, numKeys > 0 ? keys : nullptr, numKeys);
+		m_nGainRangeSamples += n;
+		m_nQuantumPos = (m_nQuantumPos + n) % PROCESS_QUANTUM;
+
+		if (m_nQuantumPos == 0)
+		{
+			if (m_fBlockMaxGain >= m_fBlockMinGain)
+			{
+				m_GainReductionMeter.push(m_fBlockMinGain);
+				m_GainHistory.push(m_fBlockMinGain, m_fBlockMaxGain, m_nGainRangeSamples);
+			}
+
+			m_fBlockMinGain = 1.0f;
+			m_fBlockMaxGain = 0.0f;
+			m_nGainRangeSamples = 0;
+		}
+
+		if (bOutputRamp)
+		{
+			fillRamp(m_OutputGain, outputRamp, n);
+			for (int channel = 0; channel < numChannels; ++channel)
+				multiplySamples(buffer.getWritePointer(channel, start), outputRamp, n);
+		}
+
+		// parallel compression; at 100% the compressed signal passes untouched
+		if (m_Mix.isSmoothing())
+		{
+			fillRamp(m_Mix, mixRamp, n);
+			for (int channel = 0; channel < numChannels; ++channel)
+				mixSamples(buffer.getWritePointer(channel, start), dryBuffer.getReadPointer(channel), mixRamp, n);
+		}
+		else if (m_Mix.getTargetValue() < 1.0f)
+		{
+			for (int channel = 0; channel < numChannels; ++channel)
+				mixSamples(buffer.getWritePointer(channel, start), dryBuffer.getReadPointer(channel), m_Mix.getTargetValue(), n);
+		}
+
+		start += n;
+	}
+
+	m_OutputMeter.process(buffer.getArrayOfReadPointers(), numChannels, numSamples);
+}
+
+void CompressorEngine::compressSubBlock(AudioBuffer<float>& buffer, int start, int numSamples,
+	int numChannels, float fMakeUpGain, const float* const* pKey, int numKeyChannels)
+{
+	float* channels[MAX_CHANNELS];
+	if (m_Oversampler.getFactorLog2() > 0)
+	{
+		// detector, gain and the gain multiply all run at the oversampled rate
+		for (int channel = 0; channel < numChannels; ++channel)
+			channels[channel] = m_Oversampler.upsample(channel, buffer.getReadPointer(channel, start), numSamples);
+
+		// the key through the same filters, so it stays aligned with the audio
+		const float* keys[2];
+		for (int channel = 0; channel < numKeyChannels; ++channel)
+			keys[channel] = m_Oversampler.upsample(m_nChannels + channel, pKey[channel], numSamples);
+
+		compressBlock(channels, numChannels, numSamples * m_Oversampler.getFactor(), fMakeUpGain,
+			pKey != nullptr ? keys : nullptr, numKeyChannels);
+
+		for (int channel = 0; channel < numChannels; ++channel)
+			m_Oversampler.downsample(channel, buffer.getWritePointer(channel, start), numSamples);
+	}
+	else
+	{
+		for (int channel = 0; channel < numChannels; ++channel)
+			channels[channel] = buffer.getWritePointer(channel, start);
+
+		compressBlock(channels, numChannels, numSamples, fMakeUpGain, pKey, numKeyChannels);
+	}
+}
+
+void CompressorEngine::compressSubBlock(AudioBuffer<double>& buffer, int start, int numSamples,
+	int numChannels, float fMakeUpGain, const float* const* pKey, int numKeyChannels)
+{
+	// the oversampling filters and the crossovers are float only; those paths run on a float
+	// copy of the sub-block, the single band path keeps the audio in double throughout
+	if (m_Oversampler.getFactorLog2() > 0 || m_nBands != 0)
+	{
+		for (int channel = 0; channel < numChannels; ++channel)
+			copySamples(m_ConvertBuffer.getWritePointer(channel), buffer.getReadPointer(channel, start), numSamples);
+
+		compressSubBlock(m_ConvertBuffer, 0, numSamples, numChannels, fMakeUpGain, pKey, numKeyChannels);
+
+		for (int channel = 0; channel < numChannels; ++channel)
+			copySamples(buffer.getWritePointer(channel, start), m_ConvertBuffer.getReadPointer(channel), numSamples);
+		return;
+	}
+
+	double* channels[MAX_CHANNELS];
+	for (int channel = 0; channel < numChannels; ++channel)
+		channels[channel] = buffer.getWritePointer(channel, start);
+
+	compressSingleBand(channels, numChannels, numSamples, fMakeUpGain, pKey, numKeyChannels);
+}
+
+void CompressorEngine::compressBlock(float* const* pChannels, int numChannels, int numSamples,
+	float fMakeUpGain, const float* const* pKey, int numKeyChannels)
+{
+	if (m_nBands != 0)
+	{
+		// crossovers, per band detection and gain and the band sum in one pass
+		m_Multiband.process(pChannels, numChannels, numSamples, m_uStereoLink, m_GainComputer, fMakeUpGain);
+		m_fBlockMinGain = jmin(m_fBlockMinGain, m_Multiband.getMinGain());
+		m_fBlockMaxGain = jmax(m_fBlockMaxGain, m_Multiband.getMaxGain());
+		return;
+	}
+
+	compressSingleBand(pChannels, numChannels, numSamples, fMakeUpGain, pKey, numKeyChannels);
+}
+
+template <typename SampleType>
+void CompressorEngine::compressSingleBand(SampleType* const* pChannels, int numChannels, int numSamples,
+	float fMakeUpGain, const float* const* pKey, int numKeyChannels)
+{
+	float* detectorData = m_DetectorBuffer.getWritePointer(0);
+
+	// what the detectors see: the external key or the audio itself, high-passed when the
+	// key filter is on; an external key's last channel serves the channels beyond it
+	const float* keys[MAX_CHANNELS];
+	const int numKeys = pKey != nullptr ? numKeyChannels : numChannels;
+	for (int channel = 0; channel < numKeys; ++channel)
+	{
+		float* pScratch = m_KeyBuffer.getWritePointer(channel);
+		keys[channel] = pKey != nullptr ? pKey[channel] : toFloat(pChannels[channel], pScratch, numSamples);
+		if (m_bKeyFilter)
+		{
+			m_KeyFilter[channel].process(keys[channel], pScratch, numSamples);
+			keys[channel] = pScratch;
+		}
+	}
+	for (int channel = numKeys; channel < numChannels; ++channel)
+		keys[channel] = keys[numKeys - 1];
+
+	if (m_uStereoLink != STEREO_LINK_OFF && numChannels > 1)
+	{
+		// one envelope and one gain per frame, shared by every channel; the external key is
+		// linked over its own channels
+		buildLinkedSidechain(keys, pKey != nullptr ? numKeys : numChannels, numSamples, detectorData);
+
+		const float fPeak = FloatVectorOperations::findMaximum(detectorData, numSamples);
+		if (m_Detectors[0].staysBelow(fPeak, m_GainComputer.getUnityLimit()))
+		{
+			m_Detectors[0].skipBlock(detectorData, numSamples, fPeak);
+			for (int channel = 0; channel < numChannels; ++channel)
+				bypassChannel(channel, pChannels[channel], numSamples, fMakeUpGain);
+			return;
+		}
+
+		m_Detectors[0].detectBlock(detectorData, detectorData, numSamples);
+		m_GainComputer.computeBlock(detectorData, detectorData, numSamples, fMakeUpGain);
+		accumulateGainRange(detectorData, numSamples, fMakeUpGain);
+
+		// the detector has seen the undelayed signal; the gain lands on the delayed one
+		for (int channel = 0; channel < numChannels; ++channel)
+		{
+			getLookaheadDelay(channel, pChannels[channel]).process(pChannels[channel], numSamples);
+			multiplySamples(pChannels[channel], detectorData, numSamples);
+		}
+	}
+	else
+	{
+		// independent channels, each with its own detector state
+		for (int channel = 0; channel < numChannels; ++channel)
+		{
+			CEnvelopeDetector& detector = m_Detectors[channel];
+			const float fPeak = findPeak(keys[channel], numSamples);
+			if (detector.staysBelow(fPeak, m_GainComputer.getUnityLimit()))
+			{
+				detector.skipBlock(keys[channel], numSamples, fPeak);
+				bypassChannel(channel, pChannels[channel], numSamples, fMakeUpGain);
+				continue;
+			}
+
+			detector.detectBlock(keys[channel], detectorData, numSamples);
+			m_GainComputer.computeBlock(detectorData, detectorData, numSamples, fMakeUpGain);
+			accumulateGainRange(detectorData, numSamples, fMakeUpGain);
+			getLookaheadDelay(channel, pChannels[channel]).process(pChannels[channel], numSamples);
+			multiplySamples(pChannels[channel], detectorData, numSamples);
+		}
+	}
+}
+
+template <typename SampleType>
+void CompressorEngine::bypassChannel(int channel, SampleType* pSamples, int numSamples, float fMakeUpGain)
+{
+	// a gain of exactly 1 is what the curve gives here, so this is what the full path
+	// would have produced: the delay and the make up gain
+	getLookaheadDelay(channel, pSamples).process(pSamples, numSamples);
+	if (fMakeUpGain != 1.0f)
+		FloatVectorOperations::multiply(pSamples, (SampleType)fMakeUpGain, numSamples);
+
+	m_fBlockMinGain = jmin(m_fBlockMinGain, 1.0f);
+	m_fBlockMaxGain = jmax(m_fBlockMaxGain, 1.0f);
+}
+
+void CompressorEngine::accumulateGainRange(const float* pGain, int numSamples, float fMakeUpGain)
+{
+	const Range<float> range = FloatVectorOperations::findMinAndMax(pGain, numSamples);
+	m_fBlockMinGain = jmin(m_fBlockMinGain, range.getStart() / fMakeUpGain);
+	m_fBlockMaxGain = jmax(m_fBlockMaxGain, range.getEnd() / fMakeUpGain);
+}
+
+void CompressorEngine::buildLinkedSidechain(const float* const* pChannels, int numChannels, int numSamples,
+	float* pSidechain) const
+{
+	// channel by channel into the sidechain, each pass a plain loop over the frames
+	const float* pFirst = pChannels[0];
+	for (int i = 0; i < numSamples; ++i)
+		pSidechain[i] = fabsf(pFirst[i]);
+
+	for (int channel = 1; channel < numChannels; ++channel)
+	{
+		const float* pData = pChannels[channel];
+		if (m_uStereoLink != STEREO_LINK_MEAN && m_uStereoLink != STEREO_LINK_SUM)
+		{
+			for (int i = 0; i < numSamples; ++i)
+				pSidechain[i] = jmax(pSidechain[i], fabsf(pData[i]));
+		}
+		else
+		{
+			for (int i = 0; i < numSamples; ++i)
+				pSidechain[i] += fabsf(pData[i]);
+		}
+	}
+
+	if (m_uStereoLink == STEREO_LINK_MEAN && numChannels > 1)
+		FloatVectorOperations::multiply(pSidechain, 1.0f / (float)numChannels, numSamples);
+}
+
+template void CompressorEngine::process<float>(AudioBuffer<float>&, const AudioBuffer<float>&);
+template void CompressorEngine::process<double>(AudioBuffer<double>&, const AudioBuffer<double>&);
+template void CompressorEngine::processBypassed<float>(AudioBuffer<float>&);
+template void CompressorEngine::processBypassed<double>(AudioBuffer<double>&);
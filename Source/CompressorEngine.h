@@ -0,0 +1,211 @@
+/*
+==============================================================================
+
+CompressorEngine.h
+Author: Filipe Borato
+
+==============================================================================
+*/
+#pragma once
+
+#include "HeadlessHeader.h"
+#include "EnvelopeDetector.h"
+#include "GainComputer.h"
+#include "Oversampler.h"
+#include "DelayLine.h"
+#include "MultibandCompressor.h"
+#include "LevelMeter.h"
+
+// The whole compressor without the plugin around it: gains, detectors, oversampling,
+// lookahead, multiband, the external key and the dry mix, and the meters they feed. It only
+// needs the modules in HeadlessHeader.h, so render workers and the batch tool run it
+// without the GUI modules or a plugin wrapper.
+//
+// CompreezorAudioProcessor is one host: it fills Parameters from its parameter tree once
+// per block and hands over its main and sidechain buses. Everything is allocated in
+// prepare(); process() never allocates.
+class CompressorEngine
+{
+public:
+	// main bus channels; any layout up to this many is accepted
+	static const int MAX_CHANNELS = 16;
+	static const int MAX_LOOKAHEAD_MSEC = 10;
+	static constexpr float KEY_HIGH_PASS_OFF_HZ = 20.0f; // the bottom of the range bypasses the filter
+
+	static const UINT DETECT_MODE_PEAK = 0;
+	static const UINT DETECT_MODE_MS = 1;
+	static const UINT DETECT_MODE_RMS = 2;
+
+	// channel link: one shared sidechain per frame built from all channels
+	static const UINT STEREO_LINK_OFF = 0;
+	static const UINT STEREO_LINK_MAX = 1;
+	static const UINT STEREO_LINK_MEAN = 2;
+	static const UINT STEREO_LINK_SUM = 3;
+
+	// every control in the units of the processor's parameters of the same name
+	struct Parameters
+	{
+		float detGain = 0;       // input gain, dB
+		float threshold = 0;     // dB
+		float attackTime = 10;   // ms
+		float releaseTime = 200; // ms
+		float ratio = 4;
+		float outputGain = 0;    // make up gain, dB
+		float kneeWidth = 0;     // dB
+		int stereoLink = 1;      // STEREO_LINK_*
+		int oversampling = 0;    // 0 = off, 1 = 2x, 2 = 4x
+		float lookahead = 0;     // ms
+		int bands = 0;           // 0 = single band, 1 = 3 bands, 2 = 4 bands
+		float lowCrossover = 200;   // Hz
+		float midCrossover = 1500;  // Hz
+		float highCrossover = 6000; // Hz
+		bool externalKey = false;
+		float keyHighPass = KEY_HIGH_PASS_OFF_HZ; // Hz
+		bool autoRelease = false;
+		float mix = 100;         // %
+
+		// from the <PARAM id value/> children of a saved plugin state or a preset; what
+		// isn't there keeps its value from base
+		static Parameters fromState(const ValueTree& state, const Parameters& base = Parameters());
+	};
+
+	bool DigitalAnalogue = false; //Digital/Analogue style compression
+
+	// allocates everything for blocks of up to maxBlockSize samples on numChannels
+	void prepare(double sampleRate, int maxBlockSize, int numChannels, const Parameters& params);
+
+	// takes effect with the next process(); call it from the audio thread, once per block
+	void setParameters(const Parameters& params) { m_Params = params; }
+
+	// compresses the first getNumChannels() channels of buffer in place. key is the external
+	// sidechain (up to two channels, used while Parameters::externalKey is on), or a buffer
+	// without channels. Instantiated for float and double
+	template <typename SampleType>
+	void process(AudioBuffer<SampleType>& buffer, const AudioBuffer<SampleType>& key);
+
+	// the dry path alone, delayed by getLatencySamples(), for a bypassed host
+	template <typename SampleType>
+	void processBypassed(AudioBuffer<SampleType>& buffer);
+
+	// lookahead plus oversampling, in base rate samples; changes with those parameters
+	int getLatencySamples() const { return m_nLatencySamples; }
+	int getNumChannels() const { return m_nChannels; }
+	int getMaxBlockSize() const { return m_nMaxBlockSize; }
+	double getSampleRate() const { return m_dSampleRate; }
+
+	// the reference curve CGainComputer tabulates
+	float calcCompressorGain(float fDetectorValue, float fThreshold, float fRatio,
+		float fKneeWidth, bool bLimit);
+
+	// written once per block, safe to read from any thread
+	CLevelMeter m_InputMeter;  // after the input gain, i.e. what the detector sees
+	CLevelMeter m_OutputMeter; // after the make up gain and the mix
+	CGainReductionMeter m_GainReductionMeter;
+	CGainHistory m_GainHistory; // for the scrolling display
+
+private:
+	// pulls the current parameter values into the smoothers and returns true while any of
+	// them is still ramping; attack/release coefficients are only recomputed here, when they change
+	bool pullParameters();
+	// advances the curve smoothers by numSamples and sets the gain curve for that span
+	void advanceParameters(int numSamples);
+	void fillRamp(LinearSmoothedValue<float>& smoother, float* pRamp, int numSamples);
+
+	// oversampling around compressBlock() for one sub-block of buffer; double blocks go
+	// through m_ConvertBuffer where the oversampler or the crossovers are involved.
+	// pKey is the external key at the base rate in float, nullptr to key from the audio
+	void compressSubBlock(AudioBuffer<float>& buffer, int start, int numSamples, int numChannels, float fMakeUpGain,
+		const float* const* pKey, int numKeyChannels);
+	void compressSubBlock(AudioBuffer<double>& buffer, int start, int numSamples, int numChannels, float fMakeUpGain,
+		const float* const* pKey, int numKeyChannels);
+
+	// detector, gain computer and gain multiply over numSamples at the working rate
+	void compressBlock(float* const* pChannels, int numChannels, int numSamples, float fMakeUpGain,
+		const float* const* pKey, int numKeyChannels);
+	template <typename SampleType>
+	void compressSingleBand(SampleType* const* pChannels, int numChannels, int numSamples, float fMakeUpGain,
+		const float* const* pKey, int numKeyChannels);
+
+	// compressSingleBand() for a channel whose detector input can't leave the flat part of
+	// the curve: no detection and no gain math, just the lookahead delay and make up gain
+	template <typename SampleType>
+	void bypassChannel(int channel, SampleType* pSamples, int numSamples, float fMakeUpGain);
+
+	CDelayLine& getLookaheadDelay(int channel, const float*) { return m_LookaheadDelay[channel]; }
+	CDelayLineT<double>& getLookaheadDelay(int channel, const double*) { return m_LookaheadDelayDouble[channel]; }
+	CDelayLine& getDryDelay(int channel, const float*) { return m_DryDelay[channel]; }
+	CDelayLineT<double>& getDryDelay(int channel, const double*) { return m_DryDelayDouble[channel]; }
+	AudioSampleBuffer& getDryBuffer(const AudioBuffer<float>&) { return m_DryBuffer; }
+	AudioBuffer<double>& getDryBuffer(const AudioBuffer<double>&) { return m_DryBufferDouble; }
+
+	// moves the single band detectors and the multiband detector and crossovers to fRate
+	void setDetectorRate(float fRate);
+	// switches the oversampling factor and moves the detectors to the new rate
+	void setOversampling(int nFactorLog2);
+	// sets the lookahead delay lines from m_nLookaheadSamples and the oversampling factor
+	void updateLookaheadDelay();
+	// sets the key high-pass from m_fKeyHighPass_Hz at the working rate
+	void updateKeyFilter();
+	int calcLatencySamples() const;
+	// sets the dry delay lines to m_nLatencySamples
+	void updateDryDelay();
+
+	// one rectified sidechain from numChannels, folded per m_uStereoLink
+	void buildLinkedSidechain(const float* const* pChannels, int numChannels, int numSamples, float* pSidechain) const;
+
+	// widens m_fBlockMinGain/m_fBlockMaxGain to a block of gains, make up gain taken out
+	void accumulateGainRange(const float* pGain, int numSamples, float fMakeUpGain);
+
+	Parameters m_Params;
+
+	CEnvelopeDetector m_Detectors[MAX_CHANNELS]; // one per channel, [0] when linked
+	CGainComputer m_GainComputer;
+	COversampler m_Oversampler;
+	CDelayLine m_LookaheadDelay[MAX_CHANNELS];
+	CDelayLineT<double> m_LookaheadDelayDouble[MAX_CHANNELS]; // the single band path of double blocks
+	CDelayLine m_DryDelay[MAX_CHANNELS]; // the dry signal, at the base rate
+	CDelayLineT<double> m_DryDelayDouble[MAX_CHANNELS];
+	CMultibandCompressor m_Multiband;
+
+	LinearSmoothedValue<float> m_InputGain;  // linear
+	LinearSmoothedValue<float> m_OutputGain; // linear
+	LinearSmoothedValue<float> m_Threshold;
+	LinearSmoothedValue<float> m_Ratio;
+	LinearSmoothedValue<float> m_KneeWidth;
+	LinearSmoothedValue<float> m_Mix; // 0..1
+
+	float m_fAttackTime_mSec = 0;  // what the detectors are currently set to
+	float m_fReleaseTime_mSec = 0;
+	bool m_bAutoRelease = false;
+	UINT m_uStereoLink = 1;
+	bool m_bExternalKey = false; // detect from the external key, when one is passed in
+	bool m_bKeyFilter = false;
+	float m_fKeyHighPass_Hz = 0;
+	int m_nBands = 0; // 0 = single band, otherwise 3 or 4
+
+	double m_dSampleRate = 44100;
+	int m_nMaxBlockSize = 0;
+	int m_nChannels = 0; // what prepare() set the per channel state up for
+	int m_nLookaheadSamples = 0; // at the base rate
+	std::atomic<int> m_nLatencySamples { 0 };
+
+	// process() steps on a grid of quanta of this many samples, counted from prepare() and
+	// not from the host's block: sub-blocks end on it, the gain curve follows its ramps once
+	// per quantum and the gain meters are fed once per quantum, whatever the block size
+	static const int PROCESS_QUANTUM = 32;
+	int m_nQuantumPos = 0; // samples into the current quantum
+
+	AudioSampleBuffer m_DetectorBuffer; // detector / gain values, at up to the 4x rate
+	AudioSampleBuffer m_RampBuffer;     // input gain, output gain and mix ramps
+	AudioSampleBuffer m_ConvertBuffer;  // float copy of a double sub-block, at the base rate
+	AudioSampleBuffer m_KeyBuffer;      // filtered or converted detector input, at up to the 4x rate
+	AudioSampleBuffer m_KeyInputBuffer; // float copy of a double sidechain sub-block
+	AudioSampleBuffer m_DryBuffer;      // delayed dry sub-block, at the base rate
+	AudioBuffer<double> m_DryBufferDouble;
+
+	CBiquad m_KeyFilter[MAX_CHANNELS]; // key high-pass, block-wise at the working rate
+
+	float m_fBlockMinGain = 1.0f; // gains applied in the current quantum
+	float m_fBlockMaxGain = 0.0f;
+	int m_nGainRangeSamples = 0;  // samples in m_fBlockMinGain/m_fBlockMaxGain
+};
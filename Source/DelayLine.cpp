@@ -0,0 +1,91 @@
+/*
+==============================================================================
+
+DelayLine.cpp
+Author: Filipe Borato
+
+==============================================================================
+*/
+
+#include "DelayLine.h"
+
+template <typename SampleType>
+CDelayLineT<SampleType>::CDelayLineT(void)
+{
+	m_nMask = 0;
+	m_nWritePos = 0;
+	m_nDelay = 0;
+	m_nMaxDelay = 0;
+}
+
+template <typename SampleType>
+CDelayLineT<SampleType>::~CDelayLineT(void)
+{
+}
+
+template <typename SampleType>
+void CDelayLineT<SampleType>::init(int nMaxDelay, int nMaxBlock)
+{
+	int nSize = 1;
+	while (nSize < nMaxDelay + nMaxBlock)
+		nSize <<= 1;
+
+	m_Ring.assign(nSize, SampleType(0));
+	m_nMask = nSize - 1;
+	m_nWritePos = 0;
+	m_nMaxDelay = nMaxDelay;
+	setDelay(m_nDelay);
+}
+
+template <typename SampleType>
+void CDelayLineT<SampleType>::reset()
+{
+	std::fill(m_Ring.begin(), m_Ring.end(), SampleType(0));
+	m_nWritePos = 0;
+}
+
+template <typename SampleType>
+void CDelayLineT<SampleType>::setDelay(int nDelay)
+{
+	m_nDelay = nDelay < 0 ? 0 : (nDelay > m_nMaxDelay ? m_nMaxDelay : nDelay);
+}
+
+template <typename SampleType>
+void CDelayLineT<SampleType>::process(SampleType* pData, int nSamples)
+{
+	if (m_Ring.empty())
+		return;
+
+	// the ring is written even at no delay, so raising the delay later reads the samples
+	// that really came before rather than whatever was left from the last non-zero delay.
+	// Write first so the read can also reach into this block for delays shorter than it
+	const int nReadPos = (m_nWritePos - m_nDelay) & m_nMask;
+	write(pData, nSamples);
+	if (m_nDelay != 0)
+		read(pData, nReadPos, nSamples);
+}
+
+template <typename SampleType>
+void CDelayLineT<SampleType>::write(const SampleType* pData, int nSamples)
+{
+	const int nFirst = nSamples < (int)m_Ring.size() - m_nWritePos ? nSamples : (int)m_Ring.size() - m_nWritePos;
+
+	memcpy(&m_Ring[m_nWritePos], pData, nFirst * sizeof(SampleType));
+	if (nSamples > nFirst)
+		memcpy(&m_Ring[0], pData + nFirst, (nSamples - nFirst) * sizeof(SampleType));
+
+	m_nWritePos = (m_nWritePos + nSamples) & m_nMask;
+}
+
+template <typename SampleType>
+void CDelayLineT<SampleType>::read(SampleType* pData, int nPos, int nSamples) const
+{
+	const int nFirst = nSamples < (int)m_Ring.size() - nPos ? nSamples : (int)m_Ring.size() - nPos;
+
+	memcpy(pData, &m_Ring[nPos], nFirst * sizeof(SampleType));
+	if (nSamples > nFirst)
+		memcpy(pData + nFirst, &m_Ring[0], (nSamples - nFirst) * sizeof(SampleType));
+}
+
+template class CDelayLineT<float>;
+template class CDelayLineT<double>;
@@ -0,0 +1,47 @@
+/*
+==============================================================================
+
+DelayLine.h
+Author: Filipe Borato
+
+==============================================================================
+*/
+#pragma once
+
+#include "EnvelopeDetector.h"
+#include <vector>
+
+// block delay line on a power-of-two ring buffer. Blocks are written and read with at
+// most two memcpy()s each (the wrap), so there is no per-sample index arithmetic.
+// Instantiated for float and double (DelayLine.cpp); CDelayLine is the float one
+template <typename SampleType>
+class CDelayLineT
+{
+public:
+	CDelayLineT(void);
+	~CDelayLineT(void);
+
+	// allocates a ring big enough for nMaxDelay samples of delay on blocks of up to
+	// nMaxBlock samples; the only place this class allocates
+	void init(int nMaxDelay, int nMaxBlock);
+	void reset();
+
+	// clamped to the nMaxDelay given to init()
+	void setDelay(int nDelay);
+	int getDelay() const { return m_nDelay; }
+
+	// delays nSamples of pData in place
+	void process(SampleType* pData, int nSamples);
+
+protected:
+	void write(const SampleType* pData, int nSamples);
+	void read(SampleType* pData, int nPos, int nSamples) const;
+
+	std::vector<SampleType> m_Ring;
+	int m_nMask;
+	int m_nWritePos;
+	int m_nDelay;
+	int m_nMaxDelay;
+};
+
+typedef CDelayLineT<float> CDelayLine;
@@ -1,26 +1,224 @@
-#include "../JuceLibraryCode/JuceHeader.h"
+#pragma once
 
-struct Downloader : juce::URL::DownloadTask::Listener
+#include "HeadlessHeader.h"
+#include "StreamingUnzip.h"
+#include "SplitConnection.h"
+
+// Downloads a URL to a file on a background thread, streaming through a fixed-size buffer.
+// The data goes to "<destination>.part" first and is renamed once complete; a .part file
+// left by a canceled or failed download is resumed with an HTTP Range request.
+//
+// downloadAndExtract() unzips the response while it arrives instead, so the archive never
+// exists on disk or in memory; that mode starts over when it is run again.
+struct Downloader : private juce::Thread, private juce::AsyncUpdater
 {
+	static const int BUFFER_SIZE = 64 * 1024;
+	static const int TIMEOUT_MS = 30000;
+
 	explicit Downloader(const juce::URL& downloadURL)
-		: url(downloadURL)
+		: juce::Thread("Downloader")
+		, url(downloadURL)
+	{
+	}
+
+	~Downloader()
 	{
+		stopThread(TIMEOUT_MS);
+		cancelPendingUpdate();
 	}
 
 	void downloadToFile(const juce::File& destinationFile)
 	{
-		url.downloadToFile(destinationFile, {}, this);
+		jassert(!isThreadRunning());
+		destination = destinationFile;
+		extractFolder = juce::File();
+		progress = 0;
+		success = false;
+		startThread();
 	}
 
-	void finished(juce::URL::DownloadTask*, bool success) override
+	void downloadAndExtract(const juce::File& destinationFolder)
 	{
-		if (onFinish)
-			onFinish();
+		jassert(!isThreadRunning());
+		destination = juce::File();
+		extractFolder = destinationFolder;
+		extractedFiles.clear();
+		progress = 0;
+		success = false;
+		startThread();
 	}
 
-	std::function<void()> onFinish;
+	// keeps the .part file, so the next download of the same destination resumes
+	void cancel() { signalThreadShouldExit(); }
+	bool isDownloading() const { return isThreadRunning(); }
+
+	// called on the message thread when the download has ended
+	std::function<void(bool success)> onFinish;
+
+	// 0..1, or -1 while the size is unknown; a ProgressBar can watch this directly
+	double progress = 0;
+	juce::String error;
+	// what downloadAndExtract() wrote; read it once onFinish has been called
+	juce::Array<juce::File> extractedFiles;
 
 private:
+	void run() override
+	{
+		success = extractFolder != juce::File() ? extract() : download();
+		triggerAsyncUpdate();
+	}
+
+	bool extract()
+	{
+		int statusCode = 0;
+		std::unique_ptr<juce::InputStream> input(connection->open(url, false, {}, &statusCode, &Downloader::keepOpen, this));
+
+		if (input == nullptr || statusCode != 200)
+		{
+			error = input == nullptr ? "No response from " + url.toString(false) : "HTTP " + juce::String(statusCode);
+			return false;
+		}
+
+		const juce::int64 totalBytes = input->getTotalLength();
+		juce::InputStream& stream = *input;
+
+		const juce::Result result = StreamingUnzip::extract(stream, extractFolder, extractedFiles, [this, &stream, totalBytes]
+		{
+			progress = totalBytes > 0 ? (double)stream.getPosition() / totalBytes : -1.0;
+			return !threadShouldExit();
+		});
+
+		if (result.failed())
+		{
+			error = result.getErrorMessage();
+			return false;
+		}
+
+		progress = 1.0;
+		return true;
+	}
+
+	bool download()
+	{
+		const juce::File partFile(destination.getFullPathName() + ".part");
+		const juce::int64 existingBytes = partFile.existsAsFile() ? partFile.getSize() : 0;
+
+		juce::String headers;
+		if (existingBytes > 0)
+			headers << "Range: bytes=" << juce::String(existingBytes) << "-\r\n";
+
+		int statusCode = 0;
+		juce::StringPairArray responseHeaders;
+		std::unique_ptr<juce::InputStream> input(connection->open(url, false, headers, &statusCode,
+			&Downloader::keepOpen, this, 0, &responseHeaders));
+
+		if (input == nullptr)
+		{
+			error = "No response from " + url.toString(false);
+			return false;
+		}
+
+		// the server had nothing past what we already have
+		if (statusCode == 416 && existingBytes > 0)
+			return finish(partFile);
+
+		if (statusCode != 200 && statusCode != 206)
+		{
+			error = "HTTP " + juce::String(statusCode);
+			return false;
+		}
+
+		// 206 continues the part file; a server that ignores Range sends everything again
+		const bool resuming = statusCode == 206;
+		if (!resuming)
+			partFile.deleteFile();
+
+		const juce::int64 offset = resuming ? existingBytes : 0;
+		const juce::int64 remaining = input->getTotalLength();
+		const juce::int64 totalBytes = remaining >= 0 ? offset + remaining : -1;
+
+		// the output is closed again before the part file is renamed
+		{
+			// FileOutputStream appends to an existing file
+			juce::FileOutputStream output(partFile, BUFFER_SIZE);
+			if (output.failedToOpen())
+			{
+				error = "Cannot write " + partFile.getFullPathName();
+				return false;
+			}
+
+			juce::HeapBlock<char> buffer(BUFFER_SIZE);
+			juce::int64 received = offset;
+
+			while (!input->isExhausted())
+			{
+				if (threadShouldExit())
+				{
+					error = "Download was canceled";
+					return false;
+				}
+
+				const int numRead = input->read(buffer, BUFFER_SIZE);
+				if (numRead < 0)
+				{
+					error = "Connection lost";
+					return false;
+				}
+
+				if (numRead == 0)
+					break;
+
+				if (!output.write(buffer, (size_t)numRead))
+				{
+					error = "Write failed for " + partFile.getFullPathName();
+					return false;
+				}
+
+				received += numRead;
+				progress = totalBytes > 0 ? (double)received / totalBytes : -1.0;
+			}
+
+			output.flush();
+			if (totalBytes >= 0 && received < totalBytes)
+			{
+				error = "Connection lost";
+				return false;
+			}
+		}
+
+		return finish(partFile);
+	}
+
+	bool finish(const juce::File& partFile)
+	{
+		destination.deleteFile();
+		if (!partFile.moveFileTo(destination))
+		{
+			error = "Cannot move " + partFile.getFullPathName();
+			return false;
+		}
+
+		progress = 1.0;
+		return true;
+	}
+
+	static bool keepOpen(void* context, int, int)
+	{
+		return !static_cast<Downloader*>(context)->threadShouldExit();
+	}
+
+	void handleAsyncUpdate() override
+	{
+		// the callback may delete this Downloader, so it runs from a copy and nothing
+		// touches the members afterwards
+		std::function<void(bool)> callback(onFinish);
+		if (callback)
+			callback(success);
+	}
+
+	juce::SharedResourcePointer<SplitConnection> connection;
 	juce::URL url;
-	std::unique_ptr<juce::URL::DownloadTask> task;
+	juce::File destination;
+	juce::File extractFolder;
+	std::atomic<bool> success { false };
 };
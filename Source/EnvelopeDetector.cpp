@@ -11,6 +11,270 @@ Alteration: Filipe Borato
 
 #include "EnvelopeDetector.h"
 
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#define ENVDET_USE_SSE2 1
+#include <emmintrin.h>
+#elif defined __ARM_NEON || defined __ARM_NEON__
+#define ENVDET_USE_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+	const float LOG_DETECTOR_FLOOR_DB = -96.0; // 16 bit noise floor
+
+#if ENVDET_USE_SSE2
+	// four-wide fastLinearTodB()
+	inline __m128 linearTodB(__m128 x)
+	{
+		const __m128i iBits = _mm_castps_si128(x);
+		const __m128i e = _mm_srai_epi32(_mm_sub_epi32(iBits, _mm_set1_epi32(0x3f2aaaab)), 23);
+		const __m128 m = _mm_castsi128_ps(_mm_sub_epi32(iBits, _mm_slli_epi32(e, 23)));
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 t = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+		const __m128 t2 = _mm_mul_ps(t, t);
+
+		__m128 p = _mm_add_ps(_mm_mul_ps(t2, _mm_set1_ps(1.0f / 7.0f)), _mm_set1_ps(1.0f / 5.0f));
+		p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(1.0f / 3.0f));
+		p = _mm_add_ps(_mm_mul_ps(p, t2), one);
+
+		const __m128 ln = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(e), _mm_set1_ps(0.69314718056f)),
+			_mm_mul_ps(_mm_set1_ps(2.0f), _mm_mul_ps(t, p)));
+		return _mm_mul_ps(ln, _mm_set1_ps(8.68588963807f));
+	}
+#elif ENVDET_USE_NEON
+	// four-wide fastLinearTodB(); ARMv7 has no vector divide so use two Newton steps
+	inline float32x4_t linearTodB(float32x4_t x)
+	{
+		const int32x4_t iBits = vreinterpretq_s32_f32(x);
+		const int32x4_t e = vshrq_n_s32(vsubq_s32(iBits, vdupq_n_s32(0x3f2aaaab)), 23);
+		const float32x4_t m = vreinterpretq_f32_s32(vsubq_s32(iBits, vshlq_n_s32(e, 23)));
+		const float32x4_t one = vdupq_n_f32(1.0f);
+		const float32x4_t den = vaddq_f32(m, one);
+		float32x4_t r = vrecpeq_f32(den);
+		r = vmulq_f32(r, vrecpsq_f32(den, r));
+		r = vmulq_f32(r, vrecpsq_f32(den, r));
+		const float32x4_t t = vmulq_f32(vsubq_f32(m, one), r);
+		const float32x4_t t2 = vmulq_f32(t, t);
+
+		float32x4_t p = vmlaq_f32(vdupq_n_f32(1.0f / 5.0f), t2, vdupq_n_f32(1.0f / 7.0f));
+		p = vmlaq_f32(vdupq_n_f32(1.0f / 3.0f), p, t2);
+		p = vmlaq_f32(one, p, t2);
+
+		const float32x4_t ln = vmlaq_f32(vmulq_f32(vdupq_n_f32(2.0f), vmulq_f32(t, p)),
+			vcvtq_f32_s32(e), vdupq_n_f32(0.69314718056f));
+		return vmulq_f32(ln, vdupq_n_f32(8.68588963807f));
+	}
+#endif
+
+	// |x|, used for the peak and rms detect modes
+	void rectifyBlock(const float* pInput, float* pOutput, int nSamples)
+	{
+		int i = 0;
+#if ENVDET_USE_SSE2
+		const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+		for (; i + 4 <= nSamples; i += 4)
+			_mm_storeu_ps(pOutput + i, _mm_and_ps(_mm_loadu_ps(pInput + i), signMask));
+#elif ENVDET_USE_NEON
+		for (; i + 4 <= nSamples; i += 4)
+			vst1q_f32(pOutput + i, vabsq_f32(vld1q_f32(pInput + i)));
+#endif
+		for (; i < nSamples; ++i)
+			pOutput[i] = fabsf(pInput[i]);
+	}
+
+	// x^2, used for the mean-square detect mode
+	void squareBlock(const float* pInput, float* pOutput, int nSamples)
+	{
+		int i = 0;
+#if ENVDET_USE_SSE2
+		for (; i + 4 <= nSamples; i += 4)
+		{
+			const __m128 x = _mm_loadu_ps(pInput + i);
+			_mm_storeu_ps(pOutput + i, _mm_mul_ps(x, x));
+		}
+#elif ENVDET_USE_NEON
+		for (; i + 4 <= nSamples; i += 4)
+		{
+			const float32x4_t x = vld1q_f32(pInput + i);
+			vst1q_f32(pOutput + i, vmulq_f32(x, x));
+		}
+#endif
+		for (; i < nSamples; ++i)
+			pOutput[i] = pInput[i] * pInput[i];
+	}
+
+	// envelope to dB; the envelope is already clamped to 0 or [FLT_MIN, 1] so every
+	// non-zero value is a normal float and fastLog() is valid for it
+	void envelopeTodBBlock(float* pBuffer, int nSamples)
+	{
+		int i = 0;
+#if ENVDET_USE_SSE2
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 floor = _mm_set1_ps(LOG_DETECTOR_FLOOR_DB);
+		for (; i + 4 <= nSamples; i += 4)
+		{
+			const __m128 x = _mm_loadu_ps(pBuffer + i);
+			const __m128 positive = _mm_cmpgt_ps(x, zero);
+			const __m128 dB = linearTodB(x);
+			_mm_storeu_ps(pBuffer + i, _mm_or_ps(_mm_and_ps(positive, dB), _mm_andnot_ps(positive, floor)));
+		}
+#elif ENVDET_USE_NEON
+		const float32x4_t zero = vdupq_n_f32(0.0f);
+		const float32x4_t floor = vdupq_n_f32(LOG_DETECTOR_FLOOR_DB);
+		for (; i + 4 <= nSamples; i += 4)
+		{
+			const float32x4_t x = vld1q_f32(pBuffer + i);
+			vst1q_f32(pBuffer + i, vbslq_f32(vcgtq_f32(x, zero), linearTodB(x), floor));
+		}
+#endif
+		for (; i < nSamples; ++i)
+			pBuffer[i] = pBuffer[i] > 0 ? fastLinearTodB(pBuffer[i]) : LOG_DETECTOR_FLOOR_DB;
+	}
+
+	// detector input for a detect mode; RMS uses the same |x| input as detect() does
+	template <UINT uDetectMode>
+	inline float rectify(float x)
+	{
+		return uDetectMode == 1 ? x * x : fabsf(x);
+	}
+
+	// one step of the one-pole recursion, with the same underflow and [0, 1] bounds as detect()
+	inline float follow(float fEnvelope, float fInput, float fAttack, float fRelease)
+	{
+		const float fCoeff = fInput > fEnvelope ? fAttack : fRelease;
+		fEnvelope = fCoeff * (fEnvelope - fInput) + fInput;
+		fEnvelope = fEnvelope < FLT_MIN_PLUS ? 0.0f : fEnvelope;
+		return fEnvelope > 1.0f ? 1.0f : fEnvelope;
+	}
+
+	// rectify and the one-pole recursion in one pass; with the mode a template argument the
+	// loop body is straight-line code, the attack/release choice and the bounds are selects.
+	// Auto release adds the slow envelope to the same pass, and a max
+	template <UINT uDetectMode, bool bLogOut, bool bAutoRelease>
+	void detectKernel(const float* pInput, float* pOutput, int nSamples,
+		float fAttack, float fRelease, float fSlowAttack, float fSlowRelease,
+		float& fEnvelopeState, float& fSlowEnvelopeState)
+	{
+		float fEnvelope = fEnvelopeState;
+		float fSlowEnvelope = fSlowEnvelopeState;
+
+		for (int i = 0; i < nSamples; ++i)
+		{
+			const float fInput = rectify<uDetectMode>(pInput[i]);
+			fEnvelope = follow(fEnvelope, fInput, fAttack, fRelease);
+
+			if (bAutoRelease)
+			{
+				fSlowEnvelope = follow(fSlowEnvelope, fInput, fSlowAttack, fSlowRelease);
+				pOutput[i] = fEnvelope > fSlowEnvelope ? fEnvelope : fSlowEnvelope;
+			}
+			else
+			{
+				pOutput[i] = fEnvelope;
+			}
+		}
+
+		fEnvelopeState = fEnvelope;
+		fSlowEnvelopeState = fSlowEnvelope;
+
+		if (bLogOut)
+			envelopeTodBBlock(pOutput, nSamples);
+	}
+
+	// detectKernel() without the output: only the envelopes move, for skipBlock()
+	template <UINT uDetectMode, bool bAutoRelease>
+	void followKernel(const float* pInput, int nSamples, float fAttack, float fRelease,
+		float fSlowAttack, float fSlowRelease, float& fEnvelopeState, float& fSlowEnvelopeState)
+	{
+		float fEnvelope = fEnvelopeState;
+		float fSlowEnvelope = fSlowEnvelopeState;
+
+		for (int i = 0; i < nSamples; ++i)
+		{
+			const float fInput = rectify<uDetectMode>(pInput[i]);
+			fEnvelope = follow(fEnvelope, fInput, fAttack, fRelease);
+			if (bAutoRelease)
+				fSlowEnvelope = follow(fSlowEnvelope, fInput, fSlowAttack, fSlowRelease);
+		}
+
+		fEnvelopeState = fEnvelope;
+		fSlowEnvelopeState = fSlowEnvelope;
+	}
+
+	// the lane recursion of detectLanes() on rectified input, in place
+	template <bool bAutoRelease>
+	void laneKernel(float* pData, int nFrames, int nLanes, float fAttack, float fRelease,
+		float fSlowAttack, float fSlowRelease, float* pEnvelopes, float* pSlowEnvelopes)
+	{
+		for (int i = 0; i < nFrames; ++i)
+		{
+			float* pFrame = pData + i * nLanes;
+			for (int nLane = 0; nLane < nLanes; ++nLane)
+			{
+				const float fInput = pFrame[nLane];
+				const float fEnvelope = follow(pEnvelopes[nLane], fInput, fAttack, fRelease);
+				pEnvelopes[nLane] = fEnvelope;
+
+				if (bAutoRelease)
+				{
+					const float fSlowEnvelope = follow(pSlowEnvelopes[nLane], fInput, fSlowAttack, fSlowRelease);
+					pSlowEnvelopes[nLane] = fSlowEnvelope;
+					pFrame[nLane] = fEnvelope > fSlowEnvelope ? fEnvelope : fSlowEnvelope;
+				}
+				else
+				{
+					pFrame[nLane] = fEnvelope;
+				}
+			}
+		}
+	}
+
+#if ENVDET_USE_SSE2
+	// laneKernel() for four lanes: one register holds the envelopes of all of them
+	inline __m128 followLanes(__m128 envelope, __m128 x, __m128 attack, __m128 release)
+	{
+		const __m128 rising = _mm_cmpgt_ps(x, envelope);
+		const __m128 coeff = _mm_or_ps(_mm_and_ps(rising, attack), _mm_andnot_ps(rising, release));
+		envelope = _mm_add_ps(_mm_mul_ps(coeff, _mm_sub_ps(envelope, x)), x);
+		envelope = _mm_andnot_ps(_mm_cmplt_ps(envelope, _mm_set1_ps(FLT_MIN_PLUS)), envelope);
+		return _mm_min_ps(envelope, _mm_set1_ps(1.0f));
+	}
+
+	template <bool bAutoRelease>
+	void laneKernel4(float* pData, int nFrames, float fAttack, float fRelease,
+		float fSlowAttack, float fSlowRelease, float* pEnvelopes, float* pSlowEnvelopes)
+	{
+		const __m128 attack = _mm_set1_ps(fAttack);
+		const __m128 release = _mm_set1_ps(fRelease);
+		const __m128 slowAttack = _mm_set1_ps(fSlowAttack);
+		const __m128 slowRelease = _mm_set1_ps(fSlowRelease);
+		__m128 envelope = _mm_loadu_ps(pEnvelopes);
+		__m128 slowEnvelope = bAutoRelease ? _mm_loadu_ps(pSlowEnvelopes) : _mm_setzero_ps();
+
+		for (int i = 0; i < nFrames; ++i)
+		{
+			const __m128 x = _mm_loadu_ps(pData + 4 * i);
+			envelope = followLanes(envelope, x, attack, release);
+
+			if (bAutoRelease)
+			{
+				slowEnvelope = followLanes(slowEnvelope, x, slowAttack, slowRelease);
+				_mm_storeu_ps(pData + 4 * i, _mm_max_ps(envelope, slowEnvelope));
+			}
+			else
+			{
+				_mm_storeu_ps(pData + 4 * i, envelope);
+			}
+		}
+
+		_mm_storeu_ps(pEnvelopes, envelope);
+		if (bAutoRelease)
+			_mm_storeu_ps(pSlowEnvelopes, slowEnvelope);
+	}
+#endif
+}
+
 CEnvelopeDetector::CEnvelopeDetector(void)
 {
 	m_fAttackTime_mSec = 0.0;
@@ -23,6 +287,11 @@ CEnvelopeDetector::CEnvelopeDetector(void)
 	m_nSample = 0;
 	m_bAnalogTC = false;
 	m_bLogDetector = false;
+	m_bAutoRelease = false;
+	m_fFastReleaseTime = 0.0;
+	m_fSlowAttackTime = 0.0;
+	m_fSlowEnvelope = 0.0;
+	updateKernel();
 }
 
 CEnvelopeDetector::~CEnvelopeDetector(void)
@@ -32,42 +301,93 @@ CEnvelopeDetector::~CEnvelopeDetector(void)
 void CEnvelopeDetector::prepareForPlay()
 {
 	m_fEnvelope = 0.0;
+	m_fSlowEnvelope = 0.0;
 	m_nSample = 0;
 }
 
 void CEnvelopeDetector::init(float samplerate, float attack_in_ms, float release_in_ms, bool bAnalogTC, UINT uDetect, bool bLogDetector)
 {
 	m_fEnvelope = 0.0;
+	m_fSlowEnvelope = 0.0;
 	m_fSampleRate = samplerate;
 	m_bAnalogTC = bAnalogTC;
 	m_fAttackTime_mSec = attack_in_ms;
 	m_fReleaseTime_mSec = release_in_ms;
 	m_uDetectMode = uDetect;
 	m_bLogDetector = bLogDetector;
+	updateKernel();
 
 	// set themm_uDetectMode = uDetect;
 	setAttackTime(attack_in_ms);
 	setReleaseTime(release_in_ms);
 }
 
+float CEnvelopeDetector::calcCoefficient(float fTime_mSec) const
+{
+	if (m_bAnalogTC)
+		return exp(ANALOG_TC / (fTime_mSec * m_fSampleRate * 0.001));
+
+	return exp(DIGITAL_TC / (fTime_mSec * m_fSampleRate * 0.001));
+}
+
 void CEnvelopeDetector::setAttackTime(float attack_in_ms)
 {
 	m_fAttackTime_mSec = attack_in_ms;
-
-	if (m_bAnalogTC)
-		m_fAttackTime = exp(ANALOG_TC / (attack_in_ms * m_fSampleRate * 0.001));
-	else
-		m_fAttackTime = exp(DIGITAL_TC / (attack_in_ms * m_fSampleRate * 0.001));
+	m_fAttackTime = calcCoefficient(attack_in_ms);
+	updateSlowTimes();
 }
 
 void CEnvelopeDetector::setReleaseTime(float release_in_ms)
 {
 	m_fReleaseTime_mSec = release_in_ms;
+	m_fReleaseTime = calcCoefficient(release_in_ms);
+	updateSlowTimes();
+}
 
-	if (m_bAnalogTC)
-		m_fReleaseTime = exp(ANALOG_TC / (release_in_ms * m_fSampleRate * 0.001));
-	else
-		m_fReleaseTime = exp(DIGITAL_TC / (release_in_ms * m_fSampleRate * 0.001));
+void CEnvelopeDetector::updateSlowTimes()
+{
+	const float fSlowAttack_mSec = m_fAttackTime_mSec * AUTO_RELEASE_SLOW_ATTACK_FACTOR;
+	m_fSlowAttackTime = calcCoefficient(fSlowAttack_mSec > AUTO_RELEASE_MIN_SLOW_ATTACK_MSEC
+		? fSlowAttack_mSec : AUTO_RELEASE_MIN_SLOW_ATTACK_MSEC);
+	m_fFastReleaseTime = calcCoefficient(m_fReleaseTime_mSec / AUTO_RELEASE_RATIO);
+}
+
+void CEnvelopeDetector::setAutoRelease(bool b)
+{
+	if (b == m_bAutoRelease)
+		return;
+
+	// the slow envelope picks up where the detector is
+	m_bAutoRelease = b;
+	m_fSlowEnvelope = m_fEnvelope;
+	updateKernel();
+}
+
+void CEnvelopeDetector::updateKernel()
+{
+	// [detect mode][log output][auto release]
+	static const DetectKernel kernels[3][2][2] =
+	{
+		{ { &detectKernel<0, false, false>, &detectKernel<0, false, true> },
+		  { &detectKernel<0, true, false>, &detectKernel<0, true, true> } },
+		{ { &detectKernel<1, false, false>, &detectKernel<1, false, true> },
+		  { &detectKernel<1, true, false>, &detectKernel<1, true, true> } },
+		{ { &detectKernel<2, false, false>, &detectKernel<2, false, true> },
+		  { &detectKernel<2, true, false>, &detectKernel<2, true, true> } },
+	};
+
+	const UINT uMode = m_uDetectMode == 1 || m_uDetectMode == 2 ? m_uDetectMode : 0;
+	m_pDetectKernel = kernels[uMode][m_bLogDetector ? 1 : 0][m_bAutoRelease ? 1 : 0];
+
+	// [detect mode][auto release]
+	static const FollowKernel followKernels[3][2] =
+	{
+		{ &followKernel<0, false>, &followKernel<0, true> },
+		{ &followKernel<1, false>, &followKernel<1, true> },
+		{ &followKernel<2, false>, &followKernel<2, true> },
+	};
+
+	m_pFollowKernel = followKernels[uMode][m_bAutoRelease ? 1 : 0];
 }
 
 void CEnvelopeDetector::setTCModeAnalog(bool bAnalogTC)
@@ -120,3 +440,90 @@ float CEnvelopeDetector::detect(float fInput)
 
 	return m_fEnvelope;
 }
+
+void CEnvelopeDetector::detectBlock(const float* pInput, float* pOutput, int nSamples)
+{
+	// one indirect call per block, chosen when the mode last changed
+	m_pDetectKernel(pInput, pOutput, nSamples, m_fAttackTime, m_bAutoRelease ? m_fFastReleaseTime : m_fReleaseTime,
+		m_fSlowAttackTime, m_fReleaseTime, m_fEnvelope, m_fSlowEnvelope);
+}
+
+bool CEnvelopeDetector::staysBelow(float fPeak, float fLimit) const
+{
+	const float fInput = m_uDetectMode == 1 ? fPeak * fPeak : fPeak;
+	float fHighest = fInput > m_fEnvelope ? fInput : m_fEnvelope;
+	if (m_bAutoRelease)
+		fHighest = fHighest > m_fSlowEnvelope ? fHighest : m_fSlowEnvelope;
+	fHighest = fHighest > 1.0f ? 1.0f : fHighest;
+
+	if (!m_bLogDetector)
+		return fHighest <= fLimit;
+
+	// the same dB conversion detectBlock() ends with
+	return (fHighest < FLT_MIN_PLUS ? LOG_DETECTOR_FLOOR_DB : fastLinearTodB(fHighest)) <= fLimit;
+}
+
+void CEnvelopeDetector::skipBlock(const float* pInput, int nSamples, float fPeak)
+{
+	const bool bSlowAtRest = !m_bAutoRelease || m_fSlowEnvelope == 0.0f;
+	if (fPeak == 0.0f)
+	{
+		// on silence the recursion is envelope *= release per sample, so the whole block
+		// is one powf(); single precision rounding aside, the same state as the full path
+		if (m_fEnvelope == 0.0f && bSlowAtRest)
+			return;
+
+		if (!bSlowAtRest)
+		{
+			m_fSlowEnvelope *= powf(m_fReleaseTime, (float)nSamples);
+			if (m_fSlowEnvelope < FLT_MIN_PLUS)
+				m_fSlowEnvelope = 0.0f;
+		}
+
+		m_fEnvelope *= powf(m_bAutoRelease ? m_fFastReleaseTime : m_fReleaseTime, (float)nSamples);
+		if (m_fEnvelope < FLT_MIN_PLUS)
+			m_fEnvelope = 0.0f;
+		return;
+	}
+
+	// quiet but not silent: the envelopes follow pInput exactly as detectBlock() would,
+	// through the kernel for the current mode, leaving out the output and the dB stage
+	m_pFollowKernel(pInput, nSamples, m_fAttackTime, m_bAutoRelease ? m_fFastReleaseTime : m_fReleaseTime,
+		m_fSlowAttackTime, m_fReleaseTime, m_fEnvelope, m_fSlowEnvelope);
+}
+
+void CEnvelopeDetector::detectLanes(const float* pInput, float* pOutput, int nFrames, int nLanes, float* pEnvelopes,
+	float* pSlowEnvelopes)
+{
+	const int nValues = nFrames * nLanes;
+
+	if (m_uDetectMode == 1)
+		squareBlock(pInput, pOutput, nValues);
+	else
+		rectifyBlock(pInput, pOutput, nValues);
+
+	const float fAttack = m_fAttackTime;
+	const float fRelease = m_bAutoRelease ? m_fFastReleaseTime : m_fReleaseTime;
+	const float fSlowAttack = m_fSlowAttackTime;
+	const float fSlowRelease = m_fReleaseTime;
+
+#if ENVDET_USE_SSE2
+	if (nLanes == 4)
+	{
+		if (m_bAutoRelease)
+			laneKernel4<true>(pOutput, nFrames, fAttack, fRelease, fSlowAttack, fSlowRelease, pEnvelopes, pSlowEnvelopes);
+		else
+			laneKernel4<false>(pOutput, nFrames, fAttack, fRelease, fSlowAttack, fSlowRelease, pEnvelopes, pSlowEnvelopes);
+	}
+	else
+#endif
+	{
+		if (m_bAutoRelease)
+			laneKernel<true>(pOutput, nFrames, nLanes, fAttack, fRelease, fSlowAttack, fSlowRelease, pEnvelopes, pSlowEnvelopes);
+		else
+			laneKernel<false>(pOutput, nFrames, nLanes, fAttack, fRelease, fSlowAttack, fSlowRelease, pEnvelopes, pSlowEnvelopes);
+	}
+
+	if (m_bLogDetector)
+		envelopeTodBBlock(pOutput, nValues);
+}
@@ -45,6 +45,12 @@ const float ANALOG_TC = -0.43533393574791066201247090699309; // (log(36.7%)
 const float METER_UPDATE_INTERVAL_MSEC = 15.0;
 const float METER_MIN_DB = -60.0;
 
+// auto release: the slow envelope attacks this much slower than the set attack time
+// (never faster than the minimum) and releases this much slower than the fast one
+const float AUTO_RELEASE_SLOW_ATTACK_FACTOR = 10.0;
+const float AUTO_RELEASE_MIN_SLOW_ATTACK_MSEC = 30.0;
+const float AUTO_RELEASE_RATIO = 5.0;
+
 class CEnvelopeDetector
 {
 public:
@@ -70,19 +76,71 @@ public:
 	// DETECT MS	 = 1
 	// DETECT RMS	 = 2
 	//
-	void setDetectMode(UINT uDetect) { m_uDetectMode = uDetect; }
+	void setDetectMode(UINT uDetect) { m_uDetectMode = uDetect; updateKernel(); }
 
 	void setSampleRate(float f) { m_fSampleRate = f; }
 
-	void setLogDetect(bool b) { m_bLogDetector = b; }
+	void setLogDetect(bool b) { m_bLogDetector = b; updateKernel(); }
+
+	// program dependent release: a fast and a slow envelope run side by side and the
+	// detector follows the higher of the two. Short peaks only charge the fast one and
+	// let go after release / AUTO_RELEASE_RATIO; sustained material charges the slow one
+	// too and gets the full release time. The block paths only, detect() ignores it
+	void setAutoRelease(bool b);
+	bool getAutoRelease() const { return m_bAutoRelease; }
 
 	// call this to detect; it returns the peak ms or rms value at that instant
 	float detect(float fInput);
 
+	// block version of detect(); writes one envelope value per input sample to pOutput
+	// (in dB if log detection is on). It runs the kernel compiled for the current detect
+	// mode and log setting, so the loop has no mode branches; the dB stage is vectorised
+	// and only the attack/release recursion is scalar. pInput and pOutput may point to the
+	// same buffer
+	void detectBlock(const float* pInput, float* pOutput, int nSamples);
+
+	// detectBlock() for nLanes interleaved signals (pInput[frame * nLanes + lane]), e.g. the
+	// bands of a multiband split. All lanes share this detector's mode and coefficients but
+	// each keeps its own envelope in pEnvelopes[lane] (and pSlowEnvelopes[lane] for auto
+	// release); the lanes of a frame update together
+	void detectLanes(const float* pInput, float* pOutput, int nFrames, int nLanes, float* pEnvelopes,
+		float* pSlowEnvelopes);
+
+	// true if detectBlock() over any input within +-fPeak would output nothing above
+	// fLimit (dB if log detection is on); the envelope only moves between where it is and
+	// the rectified input, so this needs no pass over the block
+	bool staysBelow(float fPeak, float fLimit) const;
+
+	// stands in for detectBlock() on a block that staysBelow() the point where the output
+	// stops mattering, fPeak being the block's peak. A silent block decays the envelope in
+	// closed form and costs nothing once it has reached 0; otherwise the envelope runs over
+	// pInput as usual but nothing is written and nothing goes through the dB stage, so the
+	// state after it is the same either way
+	void skipBlock(const float* pInput, int nSamples, float fPeak);
+
 	// call this from your prepareForPlay() function each time to reset the detector
 	void prepareForPlay();
 
 protected:
+	// detectBlock() with the detect mode, the dB stage and auto release fixed at compile
+	// time; the analog/digital choice only changes the coefficients, so it needs no variant
+	typedef void (*DetectKernel)(const float* pInput, float* pOutput, int nSamples,
+		float fAttack, float fRelease, float fSlowAttack, float fSlowRelease,
+		float& fEnvelope, float& fSlowEnvelope);
+
+	// the same recursion without the output, for skipBlock()
+	typedef void (*FollowKernel)(const float* pInput, int nSamples,
+		float fAttack, float fRelease, float fSlowAttack, float fSlowRelease,
+		float& fEnvelope, float& fSlowEnvelope);
+
+	// picks m_pDetectKernel and m_pFollowKernel for m_uDetectMode, m_bLogDetector and m_bAutoRelease
+	void updateKernel();
+	// the auto release coefficients from the attack and release times
+	void updateSlowTimes();
+	float calcCoefficient(float fTime_mSec) const;
+
+	DetectKernel m_pDetectKernel;
+	FollowKernel m_pFollowKernel;
 	int  m_nSample;
 	float m_fAttackTime;
 	float m_fReleaseTime;
@@ -93,8 +151,38 @@ protected:
 	UINT  m_uDetectMode;
 	bool  m_bAnalogTC;
 	bool  m_bLogDetector;
+
+	// auto release: m_fEnvelope is the fast envelope, released at m_fFastReleaseTime; the
+	// slow one attacks at m_fSlowAttackTime and releases at m_fReleaseTime
+	bool  m_bAutoRelease;
+	float m_fFastReleaseTime;
+	float m_fSlowAttackTime;
+	float m_fSlowEnvelope;
 };
 
+// fast natural log for normal, positive floats; x = m * 2^e with m in [2/3, 4/3) and
+// ln(m) = 2 * atanh((m - 1) / (m + 1)), which converges to float precision in four terms
+inline float fastLog(float x)
+{
+	int iBits;
+	memcpy(&iBits, &x, sizeof(iBits));
+	const int e = (iBits - 0x3f2aaaab) >> 23;
+	iBits -= e << 23;
+	float m;
+	memcpy(&m, &iBits, sizeof(m));
+
+	const float t = (m - 1.0f) / (m + 1.0f);
+	const float t2 = t * t;
+	const float p = ((t2 * (1.0f / 7.0f) + (1.0f / 5.0f)) * t2 + (1.0f / 3.0f)) * t2 + 1.0f;
+	return (float)e * 0.69314718056f + 2.0f * t * p;
+}
+
+// 20 * log10(x) on top of fastLog()
+inline float fastLinearTodB(float x)
+{
+	return 8.68588963807f * fastLog(x);
+}
+
 inline double lagrpol(double* x, double* y, int n, double xbar)
 {
 	int i, j;
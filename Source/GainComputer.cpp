@@ -0,0 +1,203 @@
+/*
+==============================================================================
+
+GainComputer.cpp
+Author: Filipe Borato
+
+==============================================================================
+*/
+
+#include "GainComputer.h"
+
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#define GAINCOMP_USE_SSE2 1
+#include <emmintrin.h>
+#elif defined __ARM_NEON || defined __ARM_NEON__
+#define GAINCOMP_USE_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+	// Taylor coefficients of 2^f, see fastdBToLinear()
+	const float EXP2_C1 = 0.693147181f;
+	const float EXP2_C2 = 0.240226507f;
+	const float EXP2_C3 = 0.0555041087f;
+	const float EXP2_C4 = 0.00961812911f;
+	const float EXP2_C5 = 0.00133335581f;
+	const float EXP2_C6 = 0.000154035304f;
+
+#if GAINCOMP_USE_SSE2
+	// four-wide fastdBToLinear(); cvtps rounds to nearest so |f| <= 0.5 as in the scalar version
+	inline __m128 dBToLinear(__m128 dB)
+	{
+		__m128 v = _mm_mul_ps(dB, _mm_set1_ps(0.166096404744f));
+		v = _mm_min_ps(_mm_max_ps(v, _mm_set1_ps(-126.0f)), _mm_set1_ps(126.0f));
+
+		const __m128i n = _mm_cvtps_epi32(v);
+		const __m128 f = _mm_sub_ps(v, _mm_cvtepi32_ps(n));
+
+		__m128 p = _mm_add_ps(_mm_mul_ps(f, _mm_set1_ps(EXP2_C6)), _mm_set1_ps(EXP2_C5));
+		p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(EXP2_C4));
+		p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(EXP2_C3));
+		p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(EXP2_C2));
+		p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(EXP2_C1));
+		p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f));
+
+		const __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23));
+		return _mm_mul_ps(p, scale);
+	}
+#elif GAINCOMP_USE_NEON
+	// four-wide fastdBToLinear(); vcvtq truncates, so round half away from zero by hand
+	inline float32x4_t dBToLinear(float32x4_t dB)
+	{
+		float32x4_t v = vmulq_f32(dB, vdupq_n_f32(0.166096404744f));
+		v = vminq_f32(vmaxq_f32(v, vdupq_n_f32(-126.0f)), vdupq_n_f32(126.0f));
+
+		const float32x4_t half = vbslq_f32(vcltq_f32(v, vdupq_n_f32(0.0f)), vdupq_n_f32(-0.5f), vdupq_n_f32(0.5f));
+		const int32x4_t n = vcvtq_s32_f32(vaddq_f32(v, half));
+		const float32x4_t f = vsubq_f32(v, vcvtq_f32_s32(n));
+
+		float32x4_t p = vmlaq_f32(vdupq_n_f32(EXP2_C5), f, vdupq_n_f32(EXP2_C6));
+		p = vmlaq_f32(vdupq_n_f32(EXP2_C4), p, f);
+		p = vmlaq_f32(vdupq_n_f32(EXP2_C3), p, f);
+		p = vmlaq_f32(vdupq_n_f32(EXP2_C2), p, f);
+		p = vmlaq_f32(vdupq_n_f32(EXP2_C1), p, f);
+		p = vmlaq_f32(vdupq_n_f32(1.0f), p, f);
+
+		const float32x4_t scale = vreinterpretq_f32_s32(vshlq_n_s32(vaddq_s32(n, vdupq_n_s32(127)), 23));
+		return vmulq_f32(p, scale);
+	}
+#endif
+}
+
+CGainComputer::CGainComputer(void)
+{
+	m_fThreshold = 1.0;  // force the first setParameters() to build the curve
+	m_fRatio = 0.0;
+	m_fKneeWidth = -1.0;
+	m_fSlope = 0.0;
+	m_fKneeLow = 0.0;
+	m_fKneeHigh = 0.0;
+	m_fKneeScale = 0.0;
+	m_pComputeKernel = &computeKernel<false>;
+	setParameters(0.0, 1.0, 0.0);
+}
+
+CGainComputer::~CGainComputer(void)
+{
+}
+
+void CGainComputer::setParameters(float fThreshold, float fRatio, float fKneeWidth)
+{
+	if (fThreshold == m_fThreshold && fRatio == m_fRatio && fKneeWidth == m_fKneeWidth)
+		return;
+
+	m_fThreshold = fThreshold;
+	m_fRatio = fRatio;
+	m_fKneeWidth = fKneeWidth;
+
+	// slope variable [ Eq. 13.1 ]
+	m_fSlope = 1.0 - 1.0 / fRatio;
+
+	// the two point Lagrange interpolation of the soft knee is a straight line from
+	// CS = 0 at the bottom of the knee to CS at the top (limited to 0dBFS)
+	const float fKneeLow = fThreshold - fKneeWidth / 2.0;
+	const float fKneeTop = min(0, fThreshold + fKneeWidth / 2.0);
+
+	if (fKneeWidth > 0 && fKneeTop > fKneeLow)
+	{
+		m_fKneeLow = fKneeLow;
+		m_fKneeHigh = fThreshold + fKneeWidth / 2.0;
+		m_fKneeScale = m_fSlope / (fKneeTop - fKneeLow);
+		m_pComputeKernel = &computeKernel<true>;
+	}
+	else
+	{
+		// hard knee; empty knee region
+		m_fKneeLow = fThreshold;
+		m_fKneeHigh = fThreshold;
+		m_fKneeScale = 0.0;
+		m_pComputeKernel = &computeKernel<false>;
+	}
+}
+
+float CGainComputer::computeGain(float fDetectorValue) const
+{
+	return fastdBToLinear(gainReductiondB(fDetectorValue, m_fThreshold, m_fSlope,
+		m_fKneeLow, m_fKneeHigh, m_fKneeScale));
+}
+
+void CGainComputer::computeBlock(const float* pDetector, float* pGain, int nSamples, float fMakeUpGain) const
+{
+	m_pComputeKernel(*this, pDetector, pGain, nSamples, fMakeUpGain);
+}
+
+template <bool bKnee>
+void CGainComputer::computeKernel(const CGainComputer& computer, const float* pDetector, float* pGain,
+	int nSamples, float fMakeUpGain)
+{
+	const float fThreshold = computer.m_fThreshold;
+	const float fSlope = computer.m_fSlope;
+	const float fKneeLow = computer.m_fKneeLow;
+	const float fKneeHigh = computer.m_fKneeHigh;
+	const float fKneeScale = computer.m_fKneeScale;
+
+	int i = 0;
+#if GAINCOMP_USE_SSE2
+	const __m128 threshold = _mm_set1_ps(fThreshold);
+	const __m128 slope = _mm_set1_ps(fSlope);
+	const __m128 kneeLow = _mm_set1_ps(fKneeLow);
+	const __m128 kneeHigh = _mm_set1_ps(fKneeHigh);
+	const __m128 kneeScale = _mm_set1_ps(fKneeScale);
+	const __m128 makeUp = _mm_set1_ps(fMakeUpGain);
+
+	for (; i + 4 <= nSamples; i += 4)
+	{
+		const __m128 x = _mm_loadu_ps(pDetector + i);
+		__m128 cs = slope;
+		if (bKnee)
+		{
+			const __m128 inKnee = _mm_and_ps(_mm_cmpgt_ps(x, kneeLow), _mm_cmplt_ps(x, kneeHigh));
+			const __m128 kneeSlope = _mm_mul_ps(kneeScale, _mm_sub_ps(x, kneeLow));
+			cs = _mm_or_ps(_mm_and_ps(inKnee, kneeSlope), _mm_andnot_ps(inKnee, slope));
+		}
+		const __m128 yG = _mm_min_ps(_mm_mul_ps(cs, _mm_sub_ps(threshold, x)), _mm_setzero_ps());
+		_mm_storeu_ps(pGain + i, _mm_mul_ps(makeUp, dBToLinear(yG)));
+	}
+#elif GAINCOMP_USE_NEON
+	const float32x4_t threshold = vdupq_n_f32(fThreshold);
+	const float32x4_t slope = vdupq_n_f32(fSlope);
+	const float32x4_t kneeLow = vdupq_n_f32(fKneeLow);
+	const float32x4_t kneeHigh = vdupq_n_f32(fKneeHigh);
+	const float32x4_t kneeScale = vdupq_n_f32(fKneeScale);
+	const float32x4_t makeUp = vdupq_n_f32(fMakeUpGain);
+
+	for (; i + 4 <= nSamples; i += 4)
+	{
+		const float32x4_t x = vld1q_f32(pDetector + i);
+		float32x4_t cs = slope;
+		if (bKnee)
+		{
+			const uint32x4_t inKnee = vandq_u32(vcgtq_f32(x, kneeLow), vcltq_f32(x, kneeHigh));
+			const float32x4_t kneeSlope = vmulq_f32(kneeScale, vsubq_f32(x, kneeLow));
+			cs = vbslq_f32(inKnee, kneeSlope, slope);
+		}
+		const float32x4_t yG = vminq_f32(vmulq_f32(cs, vsubq_f32(threshold, x)), vdupq_n_f32(0.0f));
+		vst1q_f32(pGain + i, vmulq_f32(makeUp, dBToLinear(yG)));
+	}
+#endif
+	for (; i < nSamples; ++i)
+	{
+		if (bKnee)
+		{
+			pGain[i] = fMakeUpGain * fastdBToLinear(gainReductiondB(pDetector[i], fThreshold, fSlope,
+				fKneeLow, fKneeHigh, fKneeScale));
+		}
+		else
+		{
+			const float yG = fSlope * (fThreshold - pDetector[i]);
+			pGain[i] = fMakeUpGain * fastdBToLinear(yG < 0 ? yG : 0);
+		}
+	}
+}
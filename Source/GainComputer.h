@@ -0,0 +1,89 @@
+/*
+==============================================================================
+
+GainComputer.h
+Author: Filipe Borato
+
+==============================================================================
+*/
+#pragma once
+
+#include "EnvelopeDetector.h"
+
+// fast 10^(fdB / 20): 2^v = 2^n * 2^f with n = round(v) and |f| <= 0.5, where 2^f is
+// a degree-6 Taylor polynomial (relative error ~1e-6, see Tests/ApproximationCheck.cpp).
+// Scalar twin of the SSE2/NEON version used by CGainComputer::computeBlock()
+inline float fastdBToLinear(float fdB)
+{
+	float v = fdB * 0.166096404744f; // log2(10) / 20
+	v = v < -126.0f ? -126.0f : v;
+	v = v > 126.0f ? 126.0f : v;
+
+	const int n = (int)(v + (v < 0 ? -0.5f : 0.5f));
+	const float f = v - (float)n;
+	const float p = 1.0f + f * (0.693147181f + f * (0.240226507f + f * (0.0555041087f
+		+ f * (0.00961812911f + f * (0.00133335581f + f * 0.000154035304f)))));
+
+	const int iBits = (n + 127) << 23;
+	float fScale;
+	memcpy(&fScale, &iBits, sizeof(fScale));
+	return p * fScale;
+}
+
+// static compressor curve of CompressorEngine::calcCompressorGain as a piecewise
+// polynomial in the detector dB value. The coefficients are rebuilt only when threshold,
+// ratio or knee width change, so turning detector values into gains needs no pow/lagrpol
+class CGainComputer
+{
+public:
+	CGainComputer(void);
+	~CGainComputer(void);
+
+	// recompute the curve; does nothing if the values are unchanged
+	void setParameters(float fThreshold, float fRatio, float fKneeWidth);
+
+	// gain for a single detector value (dB)
+	float computeGain(float fDetectorValue) const;
+
+	// detector values (dB) to linear gains, scaled by fMakeUpGain; pDetector and pGain
+	// may point to the same buffer
+	void computeBlock(const float* pDetector, float* pGain, int nSamples, float fMakeUpGain = 1.0) const;
+
+	float getThreshold() const { return m_fThreshold; }
+	float getRatio() const { return m_fRatio; }
+	float getKneeWidth() const { return m_fKneeWidth; }
+
+	// detector values at or below this get a gain of exactly 1 (the bottom of the knee)
+	float getUnityLimit() const { return m_fKneeLow; }
+
+protected:
+	// gain reduction in dB (<= 0) for a detector value; takes the coefficients by value
+	// so the compiler keeps them in registers and if-converts the selects
+	static float gainReductiondB(float fDetectorValue, float fThreshold, float fSlope,
+		float fKneeLow, float fKneeHigh, float fKneeScale)
+	{
+		const float fKneeSlope = fKneeScale * (fDetectorValue - fKneeLow);
+		const bool bInKnee = (fDetectorValue > fKneeLow) & (fDetectorValue < fKneeHigh);
+		const float yG = (bInKnee ? fKneeSlope : fSlope) * (fThreshold - fDetectorValue);
+		return yG < 0 ? yG : 0;
+	}
+
+	float m_fThreshold;
+	float m_fRatio;
+	float m_fKneeWidth;
+
+	float m_fSlope;     // CS = 1 - 1/ratio
+	float m_fKneeLow;   // knee region is (m_fKneeLow, m_fKneeHigh)
+	float m_fKneeHigh;
+	float m_fKneeScale; // CS rises linearly from 0 at m_fKneeLow
+
+	// computeBlock() with the knee decided at compile time; a hard knee drops the knee
+	// compare and select from every sample. setParameters() picks the instantiation
+	template <bool bKnee>
+	static void computeKernel(const CGainComputer& computer, const float* pDetector, float* pGain,
+		int nSamples, float fMakeUpGain);
+
+	typedef void (*ComputeKernel)(const CGainComputer& computer, const float* pDetector, float* pGain,
+		int nSamples, float fMakeUpGain);
+	ComputeKernel m_pComputeKernel;
+};
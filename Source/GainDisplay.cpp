@@ -0,0 +1,151 @@
+/*
+==============================================================================
+
+GainDisplay.cpp
+Author: Filipe Borato
+
+==============================================================================
+*/
+
+#include "GainDisplay.h"
+
+namespace
+{
+	const int AREA_GAP = 8;
+	const int CURVE_POINTS = 120;
+	const int GRID_STEP_DB = 12;
+}
+
+GainDisplay::GainDisplay(AudioProcessorValueTreeState& parameters, CGainHistory& history)
+	: threshold_(parameters.getRawParameterValue("Threshold"))
+	, ratio_(parameters.getRawParameterValue("Ratio"))
+	, knee_width_(parameters.getRawParameterValue("KneeWidth"))
+	, history_(history)
+{
+	setOpaque(true);
+	startTimer((int)METER_UPDATE_INTERVAL_MSEC);
+}
+
+GainDisplay::~GainDisplay()
+{
+	stopTimer();
+}
+
+void GainDisplay::resized()
+{
+	curve_area_ = getLocalBounds().withWidth(getHeight());
+	history_area_ = getLocalBounds().withLeft(curve_area_.getRight() + AREA_GAP);
+
+	history_min_.allocate((size_t)jmax(1, history_area_.getWidth()), true);
+	history_max_.allocate((size_t)jmax(1, history_area_.getWidth()), true);
+
+	rebuildCurve();
+}
+
+void GainDisplay::timerCallback()
+{
+	// setParameters() is a no-op on unchanged values, so compare before touching the path
+	if (*threshold_ != curve_.getThreshold() || *ratio_ != curve_.getRatio() || *knee_width_ != curve_.getKneeWidth())
+	{
+		rebuildCurve();
+		repaint(curve_area_);
+	}
+
+	const unsigned int written = history_.getNumWritten();
+	if (written != history_written_)
+	{
+		history_written_ = written;
+		repaint(history_area_);
+	}
+}
+
+void GainDisplay::rebuildCurve()
+{
+	curve_.setParameters(*threshold_, *ratio_, *knee_width_);
+
+	const juce::Rectangle<float> area = curve_area_.toFloat();
+	auto toPoint = [area](float input_db, float output_db)
+	{
+		return Point<float>(area.getX() + area.getWidth() * (1.0f + input_db / CURVE_RANGE_DB),
+			area.getY() + area.getHeight() * jlimit(0.0f, 1.0f, -output_db / CURVE_RANGE_DB));
+	};
+
+	curve_path_.clear();
+	for (int i = 0; i <= CURVE_POINTS; ++i)
+	{
+		const float input_db = -CURVE_RANGE_DB * (1.0f - (float)i / CURVE_POINTS);
+		const float output_db = input_db + Decibels::gainToDecibels(curve_.computeGain(input_db), -200.0f);
+
+		if (i == 0)
+			curve_path_.startNewSubPath(toPoint(input_db, output_db));
+		else
+			curve_path_.lineTo(toPoint(input_db, output_db));
+	}
+}
+
+void GainDisplay::paint(Graphics& g)
+{
+	g.fillAll(getLookAndFeel().findColour(ResizableWindow::backgroundColourId));
+
+	if (g.clipRegionIntersects(curve_area_))
+		paintCurve(g);
+
+	if (g.clipRegionIntersects(history_area_))
+		paintHistory(g);
+}
+
+void GainDisplay::paintCurve(Graphics& g)
+{
+	const juce::Rectangle<float> area = curve_area_.toFloat();
+
+	g.setColour(Colour(0xff1c1c1c));
+	g.fillRect(area);
+
+	g.setColour(Colour(0xff3a3a3a));
+	for (int db = GRID_STEP_DB; db < CURVE_RANGE_DB; db += GRID_STEP_DB)
+	{
+		const float proportion = (float)db / CURVE_RANGE_DB;
+		g.drawHorizontalLine(roundToInt(area.getY() + proportion * area.getHeight()), area.getX(), area.getRight());
+		g.drawVerticalLine(roundToInt(area.getRight() - proportion * area.getWidth()), area.getY(), area.getBottom());
+	}
+
+	// 1:1 for reference
+	g.drawLine(area.getX(), area.getBottom(), area.getRight(), area.getY());
+
+	g.setColour(Colour(0xffd08a3c));
+	g.strokePath(curve_path_, PathStrokeType(1.5f));
+}
+
+void GainDisplay::paintHistory(Graphics& g)
+{
+	const juce::Rectangle<float> area = history_area_.toFloat();
+
+	g.setColour(Colour(0xff1c1c1c));
+	g.fillRect(area);
+
+	const int num_columns = history_area_.getWidth();
+	const int num_buckets = history_.read(history_min_, history_max_, num_columns);
+
+	// the reduction hangs from the top: the range of the bucket bright, above it dim
+	RectangleList<float> reduction, range;
+	const float x0 = area.getRight() - num_buckets;
+	for (int i = 0; i < num_buckets; ++i)
+	{
+		const float min_y = area.getY() + area.getHeight()
+			* jlimit(0.0f, 1.0f, -Decibels::gainToDecibels(history_min_[i], -200.0f) / HISTORY_RANGE_DB);
+		const float max_y = area.getY() + area.getHeight()
+			* jlimit(0.0f, 1.0f, -Decibels::gainToDecibels(history_max_[i], -200.0f) / HISTORY_RANGE_DB);
+
+		reduction.addWithoutMerging({ x0 + i, area.getY(), 1.0f, max_y - area.getY() });
+		range.addWithoutMerging({ x0 + i, max_y, 1.0f, jmax(1.0f, min_y - max_y) });
+	}
+
+	g.setColour(Colour(0xff6b4a26));
+	g.fillRectList(reduction);
+	g.setColour(Colour(0xffd08a3c));
+	g.fillRectList(range);
+
+	g.setColour(Colour(0xffb9b9b9));
+	g.setFont(Font(11.0f, Font::plain).withTypefaceStyle("Regular"));
+	g.drawText("-" + String(HISTORY_RANGE_DB) + " dB", history_area_.reduced(4, 2), Justification::bottomLeft, false);
+}
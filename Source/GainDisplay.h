@@ -0,0 +1,54 @@
+/*
+==============================================================================
+
+GainDisplay.h
+Author: Filipe Borato
+
+==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "GainComputer.h"
+#include "LevelMeter.h"
+
+// The static compressor curve next to a scrolling gain reduction history.
+//
+// The curve is the same CGainComputer curve the audio thread runs; its path is only
+// rebuilt when Threshold, Ratio or KneeWidth change. The history is one pixel column per
+// CGainHistory bucket, newest on the right, redrawn only when the audio thread has
+// finished a bucket. While nothing plays and nothing moves, a tick just compares values.
+class GainDisplay : public Component, private Timer
+{
+public:
+	static const int CURVE_RANGE_DB = 60;   // both axes of the curve, down from 0 dBFS
+	static const int HISTORY_RANGE_DB = 24; // bottom of the history
+
+	GainDisplay(AudioProcessorValueTreeState& parameters, CGainHistory& history);
+	~GainDisplay();
+
+	void paint(Graphics& g) override;
+	void resized() override;
+
+private:
+	void timerCallback() override;
+	void rebuildCurve();
+	void paintCurve(Graphics& g);
+	void paintHistory(Graphics& g);
+
+	float* threshold_;
+	float* ratio_;
+	float* knee_width_;
+	CGainHistory& history_;
+
+	CGainComputer curve_;
+	Path curve_path_;
+	juce::Rectangle<int> curve_area_;
+	juce::Rectangle<int> history_area_;
+
+	unsigned int history_written_ = 0;
+	HeapBlock<float> history_min_; // one bucket per column of history_area_
+	HeapBlock<float> history_max_;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GainDisplay)
+};
@@ -0,0 +1,33 @@
+/*
+==============================================================================
+
+HeadlessHeader.h
+Author: Filipe Borato
+
+==============================================================================
+*/
+#pragma once
+
+// What the compressor engine and the Split client are built against, instead of
+// JuceHeader.h: no juce_gui_*, no juce_opengl, no plugin client. A render worker or a
+// command line tool links them with just these modules and its own AppConfig.h; in the
+// plugin they see the same modules and configuration as everything else.
+//
+// A tool with a Projucer project of its own (Tests/EngineLoad) defines
+// COMPRESSOR_OWN_APPCONFIG, so these sources see its AppConfig.h rather than the plugin's
+#if COMPRESSOR_OWN_APPCONFIG
+ #include <AppConfig.h>
+#else
+ #include "../JuceLibraryCode/AppConfig.h"
+#endif
+
+#include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
+#include <juce_data_structures/juce_data_structures.h>
+#include <juce_cryptography/juce_cryptography.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+
+#if ! DONT_SET_USING_JUCE_NAMESPACE
+using namespace juce;
+#endif
@@ -0,0 +1,202 @@
+/*
+==============================================================================
+
+LevelMeter.cpp
+Author: Filipe Borato
+
+==============================================================================
+*/
+
+#include "LevelMeter.h"
+
+namespace
+{
+	// raises value to fNew unless a reader reset or the writer raised it in between;
+	// single writer, so the loop only spins against the reader's exchange
+	void storeMax(std::atomic<float>& value, float fNew)
+	{
+		float fOld = value.load(std::memory_order_relaxed);
+		while (fNew > fOld && !value.compare_exchange_weak(fOld, fNew, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	void storeMin(std::atomic<float>& value, float fNew)
+	{
+		float fOld = value.load(std::memory_order_relaxed);
+		while (fNew < fOld && !value.compare_exchange_weak(fOld, fNew, std::memory_order_relaxed))
+		{
+		}
+	}
+}
+
+CLevelMeter::CLevelMeter(void)
+	: m_fPeak(0.0f)
+	, m_fRMS(0.0f)
+{
+	m_fSampleRate = 44100;
+	m_fMeanSquare = 0;
+}
+
+CLevelMeter::~CLevelMeter(void)
+{
+}
+
+void CLevelMeter::init(float fSampleRate)
+{
+	m_fSampleRate = fSampleRate;
+	reset();
+}
+
+void CLevelMeter::reset()
+{
+	m_fMeanSquare = 0;
+	m_fPeak.store(0.0f);
+	m_fRMS.store(0.0f);
+}
+
+void CLevelMeter::process(const float* const* pChannels, int nChannels, int nSamples)
+{
+	if (nSamples <= 0 || nChannels <= 0)
+		return;
+
+	float fPeak = 0;
+	float fSumSquares = 0;
+	for (int c = 0; c < nChannels; ++c)
+	{
+		const float* pData = pChannels[c];
+		for (int i = 0; i < nSamples; ++i)
+		{
+			const float fAbs = fabsf(pData[i]);
+			fPeak = fAbs > fPeak ? fAbs : fPeak;
+			fSumSquares += pData[i] * pData[i];
+		}
+	}
+
+	update(fPeak, fSumSquares, nChannels, nSamples);
+}
+
+void CLevelMeter::process(const double* const* pChannels, int nChannels, int nSamples)
+{
+	if (nSamples <= 0 || nChannels <= 0)
+		return;
+
+	// the meter only shows float precision, so the block is measured in float as well
+	float fPeak = 0;
+	float fSumSquares = 0;
+	for (int c = 0; c < nChannels; ++c)
+	{
+		const double* pData = pChannels[c];
+		for (int i = 0; i < nSamples; ++i)
+		{
+			const float fSample = (float)pData[i];
+			const float fAbs = fabsf(fSample);
+			fPeak = fAbs > fPeak ? fAbs : fPeak;
+			fSumSquares += fSample * fSample;
+		}
+	}
+
+	update(fPeak, fSumSquares, nChannels, nSamples);
+}
+
+void CLevelMeter::update(float fPeak, float fSumSquares, int nChannels, int nSamples)
+{
+	// one-pole over the block means, so the time constant holds whatever the block size
+	const float fBlockMeanSquare = fSumSquares / (float)(nSamples * nChannels);
+	const float fCoeff = expf(-1000.0f * (float)nSamples / (RMS_TIME_MSEC * m_fSampleRate));
+	m_fMeanSquare = fBlockMeanSquare + fCoeff * (m_fMeanSquare - fBlockMeanSquare);
+	if (m_fMeanSquare < FLT_MIN_PLUS)
+		m_fMeanSquare = 0;
+
+	storeMax(m_fPeak, fPeak);
+	m_fRMS.store(sqrtf(m_fMeanSquare), std::memory_order_relaxed);
+}
+
+CGainReductionMeter::CGainReductionMeter(void)
+	: m_fMinGain(1.0f)
+{
+}
+
+CGainReductionMeter::~CGainReductionMeter(void)
+{
+}
+
+void CGainReductionMeter::push(float fMinGain)
+{
+	storeMin(m_fMinGain, fMinGain);
+}
+
+CGainHistory::CGainHistory(void)
+	: m_uWritten(0)
+{
+	m_nBucketSize = 441;
+	reset();
+}
+
+CGainHistory::~CGainHistory(void)
+{
+}
+
+void CGainHistory::init(float fSampleRate)
+{
+	m_nBucketSize = (int)(BUCKET_MSEC * 0.001f * fSampleRate + 0.5f);
+	m_nBucketSize = m_nBucketSize < 1 ? 1 : m_nBucketSize;
+	reset();
+}
+
+void CGainHistory::reset()
+{
+	for (int i = 0; i < HISTORY_SIZE; ++i)
+	{
+		m_MinGain[i].store(1.0f, std::memory_order_relaxed);
+		m_MaxGain[i].store(1.0f, std::memory_order_relaxed);
+	}
+
+	m_nBucketFill = 0;
+	m_fBucketMin = 1.0;
+	m_fBucketMax = 0.0;
+	m_uWritten.store(0, std::memory_order_release);
+}
+
+void CGainHistory::push(float fMinGain, float fMaxGain, int nSamples)
+{
+	// a block longer than a bucket fills several with the same range
+	while (nSamples > 0)
+	{
+		const int n = nSamples < m_nBucketSize - m_nBucketFill ? nSamples : m_nBucketSize - m_nBucketFill;
+		m_fBucketMin = fMinGain < m_fBucketMin ? fMinGain : m_fBucketMin;
+		m_fBucketMax = fMaxGain > m_fBucketMax ? fMaxGain : m_fBucketMax;
+		m_nBucketFill += n;
+		nSamples -= n;
+
+		if (m_nBucketFill == m_nBucketSize)
+		{
+			const unsigned int uWritten = m_uWritten.load(std::memory_order_relaxed);
+			const int nIndex = (int)(uWritten & (HISTORY_SIZE - 1));
+			m_MinGain[nIndex].store(m_fBucketMin, std::memory_order_relaxed);
+			m_MaxGain[nIndex].store(m_fBucketMax, std::memory_order_relaxed);
+			m_uWritten.store(uWritten + 1, std::memory_order_release);
+
+			m_nBucketFill = 0;
+			m_fBucketMin = 1.0;
+			m_fBucketMax = 0.0;
+		}
+	}
+}
+
+int CGainHistory::read(float* pMinGain, float* pMaxGain, int nCount) const
+{
+	const unsigned int uWritten = getNumWritten();
+	unsigned int uCount = nCount < HISTORY_SIZE ? (unsigned int)nCount : HISTORY_SIZE;
+	uCount = uCount < uWritten ? uCount : uWritten;
+
+	// the writer would have to lap the ring during this copy to tear a bucket
+	for (unsigned int i = 0; i < uCount; ++i)
+	{
+		const int nIndex = (int)((uWritten - uCount + i) & (HISTORY_SIZE - 1));
+		pMinGain[i] = m_MinGain[nIndex].load(std::memory_order_relaxed);
+		pMaxGain[i] = m_MaxGain[nIndex].load(std::memory_order_relaxed);
+	}
+
+	return (int)uCount;
+}
@@ -0,0 +1,103 @@
+/*
+==============================================================================
+
+LevelMeter.h
+Author: Filipe Borato
+
+==============================================================================
+*/
+#pragma once
+
+#include "EnvelopeDetector.h"
+#include <atomic>
+
+// per-block level summary handed from the audio thread to the editor. The audio thread
+// only stores into atomics, the editor reads them on its METER_UPDATE_INTERVAL_MSEC
+// timer; there is no lock and nothing is ever queued
+class CLevelMeter
+{
+public:
+	CLevelMeter(void);
+	~CLevelMeter(void);
+
+	// RMS integration time, 300 ms as on a VU
+	static constexpr float RMS_TIME_MSEC = 300.0f;
+
+	void init(float fSampleRate);
+	void reset();
+
+	// audio thread: folds nSamples of every channel into the peak and the RMS
+	void process(const float* const* pChannels, int nChannels, int nSamples);
+	void process(const double* const* pChannels, int nChannels, int nSamples);
+
+	// editor: highest peak since the previous call, linear; restarts the peak
+	float readPeak() { return m_fPeak.exchange(0.0f); }
+	// editor: the running RMS, linear
+	float getRMS() const { return m_fRMS.load(); }
+
+protected:
+	std::atomic<float> m_fPeak;
+	std::atomic<float> m_fRMS;
+
+	float m_fSampleRate;
+	float m_fMeanSquare; // audio thread only
+
+	// folds one block's peak and sum of squares into the readings
+	void update(float fPeak, float fSumSquares, int nChannels, int nSamples);
+};
+
+// deepest gain reduction since the editor last looked
+class CGainReductionMeter
+{
+public:
+	CGainReductionMeter(void);
+	~CGainReductionMeter(void);
+
+	void reset() { m_fMinGain.store(1.0f); }
+
+	// audio thread: the smallest linear gain of a block, make up gain excluded
+	void push(float fMinGain);
+
+	// editor: smallest gain since the previous call, linear (1 = no reduction)
+	float read() { return m_fMinGain.exchange(1.0f); }
+
+protected:
+	std::atomic<float> m_fMinGain;
+};
+
+// min/max decimated gain history for the scrolling display. The audio thread folds its
+// blocks into buckets of BUCKET_MSEC and writes each finished bucket into a ring; the
+// editor copies out the newest buckets and never sees full-rate data
+class CGainHistory
+{
+public:
+	CGainHistory(void);
+	~CGainHistory(void);
+
+	static const int HISTORY_SIZE = 1024; // buckets, a power of two
+	static constexpr float BUCKET_MSEC = 10.0f;
+
+	void init(float fSampleRate);
+	void reset();
+
+	// audio thread: nSamples of base rate audio whose gains lay in [fMinGain, fMaxGain]
+	void push(float fMinGain, float fMaxGain, int nSamples);
+
+	// editor: buckets finished so far; changes only while audio runs
+	unsigned int getNumWritten() const { return m_uWritten.load(std::memory_order_acquire); }
+
+	// editor: the newest nCount (at most HISTORY_SIZE) buckets, oldest first; returns how
+	// many there were
+	int read(float* pMinGain, float* pMaxGain, int nCount) const;
+
+protected:
+	std::atomic<float> m_MinGain[HISTORY_SIZE];
+	std::atomic<float> m_MaxGain[HISTORY_SIZE];
+	std::atomic<unsigned int> m_uWritten;
+
+	// the bucket being filled, audio thread only
+	int m_nBucketSize;
+	int m_nBucketFill;
+	float m_fBucketMin;
+	float m_fBucketMax;
+};
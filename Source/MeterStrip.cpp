@@ -0,0 +1,132 @@
+/*
+==============================================================================
+
+MeterStrip.cpp
+Author: Filipe Borato
+
+==============================================================================
+*/
+
+#include "MeterStrip.h"
+
+namespace
+{
+	const int CAPTION_HEIGHT = 14;
+	const int BAR_GAP = 4;
+	enum { INPUT_BAR, OUTPUT_BAR, GAIN_REDUCTION_BAR };
+}
+
+MeterStrip::MeterStrip(CLevelMeter& input, CLevelMeter& output, CGainReductionMeter& gain_reduction)
+	: input_(input)
+	, output_(output)
+	, gain_reduction_(gain_reduction)
+{
+	bars_[INPUT_BAR].caption = "In";
+	bars_[OUTPUT_BAR].caption = "Out";
+	bars_[GAIN_REDUCTION_BAR].caption = "GR";
+	bars_[GAIN_REDUCTION_BAR].peak_db = 0;
+
+	setOpaque(true);
+	startTimer((int)METER_UPDATE_INTERVAL_MSEC);
+}
+
+MeterStrip::~MeterStrip()
+{
+	stopTimer();
+}
+
+void MeterStrip::resized()
+{
+	const int bar_width = (getWidth() - 2 * BAR_GAP) / 3;
+	for (int i = 0; i < 3; ++i)
+		bars_[i].area = { i * (bar_width + BAR_GAP), 0, bar_width, getHeight() - CAPTION_HEIGHT };
+
+	// empty until the next tick works out the real values
+	for (int i = INPUT_BAR; i <= OUTPUT_BAR; ++i)
+		bars_[i].peak_y = bars_[i].rms_y = bars_[i].area.getBottom();
+	bars_[GAIN_REDUCTION_BAR].peak_y = bars_[GAIN_REDUCTION_BAR].area.getY();
+}
+
+int MeterStrip::levelToY(const Bar& bar, float db) const
+{
+	const float proportion = jlimit(0.0f, 1.0f, (db - METER_MIN_DB) / (METER_MAX_DB - METER_MIN_DB));
+	return bar.area.getBottom() - roundToInt(proportion * bar.area.getHeight());
+}
+
+int MeterStrip::reductionToY(const Bar& bar, float db) const
+{
+	const float proportion = jlimit(0.0f, 1.0f, -db / GAIN_REDUCTION_DB);
+	return bar.area.getY() + roundToInt(proportion * bar.area.getHeight());
+}
+
+void MeterStrip::updateLevelBar(Bar& bar, CLevelMeter& meter, float fall_db)
+{
+	// the peak jumps up at once and falls back slowly, the RMS is already smooth
+	const float peak_db = Decibels::gainToDecibels(meter.readPeak(), METER_MIN_DB);
+	bar.peak_db = jmax(peak_db, bar.peak_db - fall_db, METER_MIN_DB);
+	bar.rms_db = Decibels::gainToDecibels(meter.getRMS(), METER_MIN_DB);
+
+	const int peak_y = levelToY(bar, bar.peak_db);
+	const int rms_y = levelToY(bar, bar.rms_db);
+	if (peak_y != bar.peak_y || rms_y != bar.rms_y)
+	{
+		bar.peak_y = peak_y;
+		bar.rms_y = rms_y;
+		repaint(bar.area);
+	}
+}
+
+void MeterStrip::timerCallback()
+{
+	const float fall_db = FALL_DB_PER_SECOND * METER_UPDATE_INTERVAL_MSEC * 0.001f;
+
+	updateLevelBar(bars_[INPUT_BAR], input_, fall_db);
+	updateLevelBar(bars_[OUTPUT_BAR], output_, fall_db);
+
+	// the deepest reduction shows at once and recovers at the fall rate
+	Bar& bar = bars_[GAIN_REDUCTION_BAR];
+	const float reduction_db = Decibels::gainToDecibels(gain_reduction_.read(), -(float)GAIN_REDUCTION_DB);
+	bar.peak_db = jmin(reduction_db, bar.peak_db + fall_db, 0.0f);
+
+	const int peak_y = reductionToY(bar, bar.peak_db);
+	if (peak_y != bar.peak_y)
+	{
+		bar.peak_y = peak_y;
+		repaint(bar.area);
+	}
+}
+
+void MeterStrip::paint(Graphics& g)
+{
+	g.fillAll(getLookAndFeel().findColour(ResizableWindow::backgroundColourId));
+
+	for (int i = 0; i < 3; ++i)
+	{
+		const Bar& bar = bars_[i];
+		if (!g.clipRegionIntersects(bar.area.withHeight(getHeight())))
+			continue;
+
+		g.setColour(Colour(0xff1c1c1c));
+		g.fillRect(bar.area);
+
+		if (i == GAIN_REDUCTION_BAR)
+		{
+			g.setColour(Colour(0xffd08a3c));
+			g.fillRect(bar.area.withBottom(jmax(bar.area.getY(), bar.peak_y)));
+		}
+		else
+		{
+			g.setColour(Colour(0xff6f9f6f));
+			g.fillRect(bar.area.withTop(jmin(bar.area.getBottom(), bar.rms_y)));
+
+			// a hairline at the peak, red once it is over 0 dB
+			g.setColour(bar.peak_db > 0 ? Colours::red : Colour(0xffd4d4d4));
+			g.fillRect(bar.area.getX(), jmin(bar.peak_y, bar.area.getBottom() - 1), bar.area.getWidth(), 1);
+		}
+
+		g.setColour(Colour(0xffb9b9b9));
+		g.setFont(Font(11.0f, Font::plain).withTypefaceStyle("Regular"));
+		g.drawFittedText(bar.caption, bar.area.getX() - BAR_GAP / 2, bar.area.getBottom(),
+			bar.area.getWidth() + BAR_GAP, CAPTION_HEIGHT, Justification::centred, 1);
+	}
+}
@@ -0,0 +1,55 @@
+/*
+==============================================================================
+
+MeterStrip.h
+Author: Filipe Borato
+
+==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "LevelMeter.h"
+
+// Input, output and gain reduction bars for the editor. Every METER_UPDATE_INTERVAL_MSEC
+// the strip reads the processor's meters, applies the fall-back here on the message
+// thread, and repaints only the bars whose drawn pixels changed. It is opaque, so a
+// meter tick never repaints the editor behind it.
+class MeterStrip : public Component, private Timer
+{
+public:
+	static const int METER_MAX_DB = 6;        // top of the level bars
+	static const int GAIN_REDUCTION_DB = 24;  // bottom of the gain reduction bar
+	static const int FALL_DB_PER_SECOND = 20; // peaks and the reduction let go at this rate
+
+	MeterStrip(CLevelMeter& input, CLevelMeter& output, CGainReductionMeter& gain_reduction);
+	~MeterStrip();
+
+	void paint(Graphics& g) override;
+	void resized() override;
+
+private:
+	struct Bar
+	{
+		String caption;
+		juce::Rectangle<int> area; // the bar, without its caption
+		float peak_db = METER_MIN_DB;
+		float rms_db = METER_MIN_DB;
+		int peak_y = -1; // what was painted last
+		int rms_y = -1;
+	};
+
+	void timerCallback() override;
+	// y of a level bar for db, or of the gain reduction bar's lower edge
+	int levelToY(const Bar& bar, float db) const;
+	int reductionToY(const Bar& bar, float db) const;
+	void updateLevelBar(Bar& bar, CLevelMeter& meter, float fall_db);
+
+	CLevelMeter& input_;
+	CLevelMeter& output_;
+	CGainReductionMeter& gain_reduction_;
+
+	Bar bars_[3]; // in, out, gain reduction
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MeterStrip)
+};
@@ -0,0 +1,325 @@
+/*
+==============================================================================
+
+MultibandCompressor.cpp
+Author: Filipe Borato
+
+==============================================================================
+*/
+
+#include "MultibandCompressor.h"
+
+namespace
+{
+	const double PI = 3.14159265358979323846;
+}
+
+void CBiquad::setLowPass(float fFrequency, float fSampleRate, float fQ)
+{
+	const double w0 = 2.0 * PI * fFrequency / fSampleRate;
+	const double cosw = cos(w0);
+	const double alpha = sin(w0) / (2.0 * fQ);
+	const double a0 = 1.0 + alpha;
+
+	b0 = (float)((1.0 - cosw) / 2.0 / a0);
+	b1 = (float)((1.0 - cosw) / a0);
+	b2 = b0;
+	a1 = (float)(-2.0 * cosw / a0);
+	a2 = (float)((1.0 - alpha) / a0);
+}
+
+void CBiquad::setHighPass(float fFrequency, float fSampleRate, float fQ)
+{
+	const double w0 = 2.0 * PI * fFrequency / fSampleRate;
+	const double cosw = cos(w0);
+	const double alpha = sin(w0) / (2.0 * fQ);
+	const double a0 = 1.0 + alpha;
+
+	b0 = (float)((1.0 + cosw) / 2.0 / a0);
+	b1 = (float)(-(1.0 + cosw) / a0);
+	b2 = b0;
+	a1 = (float)(-2.0 * cosw / a0);
+	a2 = (float)((1.0 - alpha) / a0);
+}
+
+void CBiquad::setAllPass(float fFrequency, float fSampleRate, float fQ)
+{
+	const double w0 = 2.0 * PI * fFrequency / fSampleRate;
+	const double cosw = cos(w0);
+	const double alpha = sin(w0) / (2.0 * fQ);
+	const double a0 = 1.0 + alpha;
+
+	b0 = (float)((1.0 - alpha) / a0);
+	b1 = (float)(-2.0 * cosw / a0);
+	b2 = 1.0f;
+	a1 = b1;
+	a2 = b0;
+}
+
+void CBiquad::process(const float* pInput, float* pOutput, int nSamples)
+{
+	float s1 = z1;
+	float s2 = z2;
+	for (int i = 0; i < nSamples; ++i)
+	{
+		const float x = pInput[i];
+		const float y = b0 * x + s1;
+		s1 = b1 * x - a1 * y + s2;
+		s2 = b2 * x - a2 * y;
+		pOutput[i] = y;
+	}
+	z1 = s1;
+	z2 = s2;
+}
+
+void CLinkwitzRiley::set(float fFrequency, float fSampleRate)
+{
+	for (int i = 0; i < 2; ++i)
+	{
+		lowPass[i].setLowPass(fFrequency, fSampleRate, BUTTERWORTH_Q);
+		highPass[i].setHighPass(fFrequency, fSampleRate, BUTTERWORTH_Q);
+	}
+}
+
+void CLinkwitzRiley::reset()
+{
+	for (int i = 0; i < 2; ++i)
+	{
+		lowPass[i].reset();
+		highPass[i].reset();
+	}
+}
+
+CMultibandCompressor::CMultibandCompressor(void)
+{
+	m_nBands = 3;
+	m_fSampleRate = 44100;
+	m_fLow = 200;
+	m_fMid = 1500;
+	m_fHigh = 6000;
+	m_nLookaheadFrames = 0;
+	m_fMinGain = 1.0;
+	m_fMaxGain = 1.0;
+}
+
+CMultibandCompressor::~CMultibandCompressor(void)
+{
+}
+
+void CMultibandCompressor::init(int nChannels, int nMaxSamples, int nMaxDelay)
+{
+	m_Channels.resize(nChannels);
+	for (int c = 0; c < nChannels; ++c)
+	{
+		m_Channels[c].bands.assign(nMaxSamples * MAX_BANDS, 0.0f);
+		m_Channels[c].delay.init(nMaxDelay * MAX_BANDS, nMaxSamples * MAX_BANDS);
+	}
+
+	setLookahead(m_nLookaheadFrames);
+
+	m_Key.assign(nMaxSamples * MAX_BANDS, 0.0f);
+	updateCrossovers();
+	reset();
+}
+
+void CMultibandCompressor::reset()
+{
+	for (size_t c = 0; c < m_Channels.size(); ++c)
+	{
+		Channel& channel = m_Channels[c];
+		channel.lowSplit.reset();
+		channel.midSplit.reset();
+		channel.highSplit.reset();
+		channel.lowAllPass.reset();
+		channel.highAllPass.reset();
+		channel.delay.reset();
+
+		for (int b = 0; b < MAX_BANDS; ++b)
+		{
+			channel.envelopes[b] = 0;
+			channel.slowEnvelopes[b] = 0;
+		}
+	}
+}
+
+void CMultibandCompressor::setAutoRelease(bool b)
+{
+	if (b == m_Detector.getAutoRelease())
+		return;
+
+	m_Detector.setAutoRelease(b);
+
+	for (Channel& channel : m_Channels)
+		for (int band = 0; band < MAX_BANDS; ++band)
+			channel.slowEnvelopes[band] = channel.envelopes[band];
+}
+
+void CMultibandCompressor::setSampleRate(float fSampleRate)
+{
+	if (fSampleRate == m_fSampleRate)
+		return;
+
+	m_fSampleRate = fSampleRate;
+	updateCrossovers();
+}
+
+void CMultibandCompressor::setNumBands(int nBands)
+{
+	nBands = nBands < 3 ? 3 : (nBands > MAX_BANDS ? MAX_BANDS : nBands);
+	if (nBands == m_nBands)
+		return;
+
+	// the interleaving stride changes, so old band data and envelopes are meaningless
+	m_nBands = nBands;
+	setLookahead(m_nLookaheadFrames);
+	reset();
+}
+
+void CMultibandCompressor::setCrossovers(float fLow, float fMid, float fHigh)
+{
+	if (fLow == m_fLow && fMid == m_fMid && fHigh == m_fHigh)
+		return;
+
+	m_fLow = fLow;
+	m_fMid = fMid;
+	m_fHigh = fHigh;
+	updateCrossovers();
+}
+
+void CMultibandCompressor::setLookahead(int nSamples)
+{
+	// the delay runs on the interleaved band data, so one frame is m_nBands floats
+	m_nLookaheadFrames = nSamples;
+	for (size_t c = 0; c < m_Channels.size(); ++c)
+		m_Channels[c].delay.setDelay(nSamples * m_nBands);
+}
+
+void CMultibandCompressor::updateCrossovers()
+{
+	// keep every crossover below Nyquist
+	const float fMax = 0.45f * m_fSampleRate;
+	const float fLow = m_fLow < fMax ? m_fLow : fMax;
+	const float fMid = m_fMid < fMax ? m_fMid : fMax;
+	const float fHigh = m_fHigh < fMax ? m_fHigh : fMax;
+
+	for (size_t c = 0; c < m_Channels.size(); ++c)
+	{
+		Channel& channel = m_Channels[c];
+		channel.lowSplit.set(fLow, m_fSampleRate);
+		channel.midSplit.set(fMid, m_fSampleRate);
+		channel.highSplit.set(fHigh, m_fSampleRate);
+		channel.lowAllPass.setAllPass(fLow, m_fSampleRate, BUTTERWORTH_Q);
+		channel.highAllPass.setAllPass(fHigh, m_fSampleRate, BUTTERWORTH_Q);
+	}
+}
+
+void CMultibandCompressor::split(Channel& channel, const float* pInput, int nSamples)
+{
+	float* pBands = &channel.bands[0];
+
+	// every branch goes through the allpass of the splits it doesn't take part in, so
+	// the bands sum back to a flat (allpass) response
+	if (m_nBands == 3)
+	{
+		for (int i = 0; i < nSamples; ++i, pBands += 3)
+		{
+			float fLow, fHigh;
+			channel.lowSplit.split(pInput[i], fLow, fHigh);
+			pBands[0] = channel.highAllPass.process(fLow);
+			channel.highSplit.split(fHigh, pBands[1], pBands[2]);
+		}
+	}
+	else
+	{
+		for (int i = 0; i < nSamples; ++i, pBands += 4)
+		{
+			float fLow, fHigh;
+			channel.midSplit.split(pInput[i], fLow, fHigh);
+			channel.lowSplit.split(channel.highAllPass.process(fLow), pBands[0], pBands[1]);
+			channel.highSplit.split(channel.lowAllPass.process(fHigh), pBands[2], pBands[3]);
+		}
+	}
+}
+
+void CMultibandCompressor::process(float* const* pChannels, int nChannels, int nSamples, UINT uLinkMode,
+	const CGainComputer& gainComputer, float fMakeUpGain)
+{
+	const int nBands = m_nBands;
+	const int nValues = nSamples * nBands;
+	float* pKey = &m_Key[0];
+	float fMinGain = 1.0;
+	float fMaxGain = 0.0;
+
+	for (int c = 0; c < nChannels; ++c)
+		split(m_Channels[c], pChannels[c], nSamples);
+
+	if (uLinkMode != 0 && nChannels > 1)
+	{
+		// one envelope and one gain per band and frame, shared by the channels; folded in
+		// one channel at a time, each a single pass over the interleaved bands
+		const float* pFirst = &m_Channels[0].bands[0];
+		for (int i = 0; i < nValues; ++i)
+			pKey[i] = fabsf(pFirst[i]);
+
+		for (int c = 1; c < nChannels; ++c)
+		{
+			const float* pBands = &m_Channels[c].bands[0];
+			if (uLinkMode != 2 && uLinkMode != 3)
+			{
+				for (int i = 0; i < nValues; ++i)
+				{
+					const float fBand = fabsf(pBands[i]);
+					pKey[i] = pKey[i] > fBand ? pKey[i] : fBand;
+				}
+			}
+			else
+			{
+				for (int i = 0; i < nValues; ++i)
+					pKey[i] += fabsf(pBands[i]);
+			}
+		}
+
+		if (uLinkMode == 2)
+		{
+			const float fScale = 1.0f / (float)nChannels;
+			for (int i = 0; i < nValues; ++i)
+				pKey[i] *= fScale;
+		}
+
+		m_Detector.detectLanes(pKey, pKey, nSamples, nBands, m_Channels[0].envelopes, m_Channels[0].slowEnvelopes);
+		gainComputer.computeBlock(pKey, pKey, nValues, 1.0);
+	}
+
+	for (int c = 0; c < nChannels; ++c)
+	{
+		Channel& channel = m_Channels[c];
+		float* pBands = &channel.bands[0];
+
+		if (uLinkMode == 0 || nChannels == 1)
+		{
+			m_Detector.detectLanes(pBands, pKey, nSamples, nBands, channel.envelopes, channel.slowEnvelopes);
+			gainComputer.computeBlock(pKey, pKey, nValues, 1.0);
+		}
+
+		// the detector has seen the undelayed bands; the gains land on the delayed ones
+		channel.delay.process(pBands, nValues);
+
+		float* pOutput = pChannels[c];
+		for (int i = 0; i < nSamples; ++i)
+		{
+			const float* pFrameBands = pBands + i * nBands;
+			const float* pFrameGains = pKey + i * nBands;
+			float fSum = 0;
+			for (int b = 0; b < nBands; ++b)
+			{
+				fSum += pFrameBands[b] * pFrameGains[b];
+				fMinGain = pFrameGains[b] < fMinGain ? pFrameGains[b] : fMinGain;
+				fMaxGain = pFrameGains[b] > fMaxGain ? pFrameGains[b] : fMaxGain;
+			}
+			pOutput[i] = fMakeUpGain * fSum;
+		}
+	}
+
+	m_fMinGain = fMinGain;
+	m_fMaxGain = fMaxGain;
+}
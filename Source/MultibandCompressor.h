@@ -0,0 +1,129 @@
+/*
+==============================================================================
+
+MultibandCompressor.h
+Author: Filipe Borato
+
+==============================================================================
+*/
+#pragma once
+
+#include "EnvelopeDetector.h"
+#include "GainComputer.h"
+#include "DelayLine.h"
+#include <vector>
+
+const float BUTTERWORTH_Q = 0.70710678118f;
+
+// transposed direct form II biquad, RBJ cookbook designs
+struct CBiquad
+{
+	float b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+	float z1 = 0, z2 = 0;
+
+	void setLowPass(float fFrequency, float fSampleRate, float fQ);
+	void setHighPass(float fFrequency, float fSampleRate, float fQ);
+	void setAllPass(float fFrequency, float fSampleRate, float fQ);
+	void reset() { z1 = z2 = 0; }
+
+	inline float process(float x)
+	{
+		const float y = b0 * x + z1;
+		z1 = b1 * x - a1 * y + z2;
+		z2 = b2 * x - a2 * y;
+		return y;
+	}
+
+	// nSamples of pInput into pOutput, which may be pInput; the state stays in registers
+	void process(const float* pInput, float* pOutput, int nSamples);
+};
+
+// 4th order Linkwitz-Riley split (two Butterworth sections per side); low + high sums to
+// the 2nd order allpass that setAllPass() with the same frequency produces
+struct CLinkwitzRiley
+{
+	CBiquad lowPass[2];
+	CBiquad highPass[2];
+
+	void set(float fFrequency, float fSampleRate);
+	void reset();
+
+	inline void split(float x, float& fLow, float& fHigh)
+	{
+		fLow = lowPass[1].process(lowPass[0].process(x));
+		fHigh = highPass[1].process(highPass[0].process(x));
+	}
+};
+
+const int MAX_BANDS = 4;
+
+// 3 or 4 band compressor on the existing detector and gain computer. The crossovers write
+// every band of a frame next to each other (band data is frame-interleaved), so detection,
+// dB conversion, the gain curve and the band gains all run over one contiguous block with
+// the bands side by side instead of one pass over the buffer per band
+class CMultibandCompressor
+{
+public:
+	CMultibandCompressor(void);
+	~CMultibandCompressor(void);
+
+	// allocates everything for nChannels of up to nMaxSamples (working rate) and nMaxDelay
+	// samples of lookahead
+	void init(int nChannels, int nMaxSamples, int nMaxDelay);
+	void reset();
+
+	void setSampleRate(float fSampleRate);
+	void setNumBands(int nBands); // 3 or 4
+	int getNumBands() const { return m_nBands; }
+
+	// 3 bands split at fLow and fHigh, 4 bands at all three; frequencies must be ascending
+	void setCrossovers(float fLow, float fMid, float fHigh);
+
+	void setLookahead(int nSamples);
+
+	// one detector's coefficients are shared by all bands, each band keeps its own envelope
+	CEnvelopeDetector& getDetector() { return m_Detector; }
+
+	// the detector's auto release, with the bands' slow envelopes starting where they are
+	void setAutoRelease(bool b);
+
+	// uLinkMode as CompressorEngine::STEREO_LINK_*: 0 = off, 1 = max, 2 = mean, 3 = sum
+	void process(float* const* pChannels, int nChannels, int nSamples, UINT uLinkMode,
+		const CGainComputer& gainComputer, float fMakeUpGain);
+
+	// smallest and largest band gain of the last process() call, make up gain excluded;
+	// for metering
+	float getMinGain() const { return m_fMinGain; }
+	float getMaxGain() const { return m_fMaxGain; }
+
+protected:
+	struct Channel
+	{
+		CLinkwitzRiley lowSplit;
+		CLinkwitzRiley midSplit;
+		CLinkwitzRiley highSplit;
+		CBiquad lowAllPass;  // phase of the low split, for the bands above it
+		CBiquad highAllPass; // phase of the high split, for the bands below it
+
+		float envelopes[MAX_BANDS];
+		float slowEnvelopes[MAX_BANDS]; // auto release
+		CDelayLine delay;
+		std::vector<float> bands; // nSamples * m_nBands, frame-interleaved
+	};
+
+	void updateCrossovers();
+	void split(Channel& channel, const float* pInput, int nSamples);
+
+	std::vector<Channel> m_Channels;
+	std::vector<float> m_Key;
+	CEnvelopeDetector m_Detector;
+
+	int m_nBands;
+	int m_nLookaheadFrames;
+	float m_fSampleRate;
+	float m_fLow;
+	float m_fMid;
+	float m_fHigh;
+	float m_fMinGain;
+	float m_fMaxGain;
+};
@@ -0,0 +1,243 @@
+/*
+==============================================================================
+
+Oversampler.cpp
+Author: Filipe Borato
+
+==============================================================================
+*/
+
+#include "Oversampler.h"
+#include <assert.h>
+
+namespace
+{
+	// first stage (base <-> 2x): the steep one, passband to ~0.45 fs at ~70dB rejection
+	const int STAGE1_TAPS = 95;
+	const float STAGE1_BETA = 6.76f;
+
+	// second stage (2x <-> 4x): only has to reject around 1.5 fs, so it can be short
+	const int STAGE2_TAPS = 19;
+	const float STAGE2_BETA = 6.76f;
+
+	// a 4k + 3 tap half-band delays (4k + 2) / 2 samples each way, so the stage 2 round trip
+	// is k + 1/2 base rate samples. One 2x rate sample of padding between the stages makes
+	// the 4x latency a whole number of base rate samples
+	const int STAGE2_PAD = 1;
+
+	// zeroth order modified Bessel function, for the Kaiser window
+	double besselI0(double x)
+	{
+		double sum = 1.0, term = 1.0;
+		for (int k = 1; k < 32; ++k)
+		{
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum += term;
+		}
+		return sum;
+	}
+}
+
+CHalfBandFilter::CHalfBandFilter(void)
+{
+	m_nTaps = 3;
+}
+
+CHalfBandFilter::~CHalfBandFilter(void)
+{
+}
+
+void CHalfBandFilter::init(int nTaps, float fKaiserBeta, int nMaxInputSamples)
+{
+	m_nTaps = nTaps;
+
+	// Kaiser windowed sinc with its cutoff at a quarter of the higher rate; only the
+	// even taps are kept, normalised so the filter has unity gain at DC
+	const int nCentre = (nTaps - 1) / 2;
+	const double pi = 3.14159265358979323846;
+	const double dBetaNorm = besselI0(fKaiserBeta);
+
+	m_EvenTaps.assign((nTaps + 1) / 2, 0.0f);
+	double dSum = 0.0;
+	for (int i = 0; i < (int)m_EvenTaps.size(); ++i)
+	{
+		const int n = 2 * i - nCentre; // odd, so never the centre tap
+		const double x = 0.5 * pi * n;
+		const double r = (double)n / nCentre;
+		const double dWindow = besselI0(fKaiserBeta * sqrt(1.0 - r * r)) / dBetaNorm;
+		m_EvenTaps[i] = (float)(0.5 * sin(x) / x * dWindow);
+		dSum += m_EvenTaps[i];
+	}
+
+	for (int i = 0; i < (int)m_EvenTaps.size(); ++i)
+		m_EvenTaps[i] = (float)(m_EvenTaps[i] * 0.5 / dSum);
+
+	// big enough for either direction: up needs (taps + 1) / 2 - 1 history samples next to
+	// nMaxInputSamples, down needs taps - 1 next to 2 * nMaxInputSamples
+	m_Buffer.assign(nTaps - 1 + 2 * nMaxInputSamples, 0.0f);
+}
+
+void CHalfBandFilter::reset()
+{
+	std::fill(m_Buffer.begin(), m_Buffer.end(), 0.0f);
+}
+
+void CHalfBandFilter::upsample(const float* pInput, float* pOutput, int nSamples)
+{
+	const int nEven = (int)m_EvenTaps.size();
+	const int nHistory = nEven - 1;
+	const int nDelay = (m_nTaps - 3) / 4; // centre tap position in input samples
+	const float* pTaps = &m_EvenTaps[0];
+	float* pBuffer = &m_Buffer[0];
+
+	memcpy(pBuffer + nHistory, pInput, nSamples * sizeof(float));
+
+	for (int k = 0; k < nSamples; ++k)
+	{
+		// newest sample at pX[nHistory]; the zero-stuffing gain of 2 is applied here
+		const float* pX = pBuffer + k;
+		float fSum = 0.0f;
+		for (int i = 0; i < nEven; ++i)
+			fSum += pTaps[i] * pX[nHistory - i];
+
+		pOutput[2 * k] = 2.0f * fSum;
+		pOutput[2 * k + 1] = pX[nHistory - nDelay]; // 2 * 0.5 * x
+	}
+
+	memmove(pBuffer, pBuffer + nSamples, nHistory * sizeof(float));
+}
+
+void CHalfBandFilter::downsample(const float* pInput, float* pOutput, int nSamples)
+{
+	const int nEven = (int)m_EvenTaps.size();
+	const int nHistory = m_nTaps - 1;
+	const int nCentre = (m_nTaps - 1) / 2;
+	const float* pTaps = &m_EvenTaps[0];
+	float* pBuffer = &m_Buffer[0];
+
+	memcpy(pBuffer + nHistory, pInput, 2 * nSamples * sizeof(float));
+
+	for (int k = 0; k < nSamples; ++k)
+	{
+		// newest sample at pX[nHistory]; only the even outputs are computed
+		const float* pX = pBuffer + 2 * k;
+		float fSum = 0.5f * pX[nHistory - nCentre];
+		for (int i = 0; i < nEven; ++i)
+			fSum += pTaps[i] * pX[nHistory - 2 * i];
+
+		pOutput[k] = fSum;
+	}
+
+	memmove(pBuffer, pBuffer + 2 * nSamples, nHistory * sizeof(float));
+}
+
+COversampler::COversampler(void)
+{
+	m_nFactorLog2 = 0;
+}
+
+COversampler::~COversampler(void)
+{
+}
+
+void COversampler::init(int nChannels, int nMaxSamples)
+{
+	m_Channels.resize(nChannels);
+
+	for (int c = 0; c < nChannels; ++c)
+	{
+		Channel& channel = m_Channels[c];
+		channel.up[0].init(STAGE1_TAPS, STAGE1_BETA, nMaxSamples);
+		channel.down[0].init(STAGE1_TAPS, STAGE1_BETA, nMaxSamples);
+		channel.up[1].init(STAGE2_TAPS, STAGE2_BETA, 2 * nMaxSamples);
+		channel.down[1].init(STAGE2_TAPS, STAGE2_BETA, 2 * nMaxSamples);
+		channel.stage.assign(2 * nMaxSamples, 0.0f);
+		channel.pad.assign(STAGE2_PAD, 0.0f);
+		channel.nPadPos = 0;
+		channel.data.assign((1 << MAX_FACTOR_LOG2) * nMaxSamples, 0.0f);
+	}
+}
+
+void COversampler::setFactorLog2(int nFactorLog2)
+{
+	nFactorLog2 = nFactorLog2 < 0 ? 0 : (nFactorLog2 > MAX_FACTOR_LOG2 ? MAX_FACTOR_LOG2 : nFactorLog2);
+	if (nFactorLog2 == m_nFactorLog2)
+		return;
+
+	m_nFactorLog2 = nFactorLog2;
+	reset();
+}
+
+float COversampler::getLatency(int nFactorLog2) const
+{
+	if (nFactorLog2 == 0 || m_Channels.empty())
+		return 0.0;
+
+	// each stage adds its up and down group delay at its own rate
+	const Channel& channel = m_Channels[0];
+	float fLatency = (channel.up[0].getLatency() + channel.down[0].getLatency()) / 2.0f;
+	if (nFactorLog2 > 1)
+		fLatency += (channel.up[1].getLatency() + channel.down[1].getLatency()) / 4.0f + STAGE2_PAD / 2.0f;
+
+	// the dry path and the host's delay compensation can only be whole samples
+	assert(fLatency == floorf(fLatency));
+	return fLatency;
+}
+
+float* COversampler::upsample(int nChannel, const float* pInput, int nSamples)
+{
+	Channel& channel = m_Channels[nChannel];
+
+	if (m_nFactorLog2 == 1)
+	{
+		channel.up[0].upsample(pInput, &channel.data[0], nSamples);
+	}
+	else
+	{
+		channel.up[0].upsample(pInput, &channel.stage[0], nSamples);
+		channel.up[1].upsample(&channel.stage[0], &channel.data[0], 2 * nSamples);
+	}
+
+	return &channel.data[0];
+}
+
+void COversampler::downsample(int nChannel, float* pOutput, int nSamples)
+{
+	Channel& channel = m_Channels[nChannel];
+
+	if (m_nFactorLog2 == 1)
+	{
+		channel.down[0].downsample(&channel.data[0], pOutput, nSamples);
+	}
+	else
+	{
+		channel.down[1].downsample(&channel.data[0], &channel.stage[0], 2 * nSamples);
+
+		// STAGE2_PAD samples of delay at 2x, see getLatency()
+		float* pStage = &channel.stage[0];
+		for (int i = 0; i < 2 * nSamples; ++i)
+		{
+			const float fDelayed = channel.pad[channel.nPadPos];
+			channel.pad[channel.nPadPos] = pStage[i];
+			pStage[i] = fDelayed;
+			channel.nPadPos = (channel.nPadPos + 1) % STAGE2_PAD;
+		}
+
+		channel.down[0].downsample(&channel.stage[0], pOutput, nSamples);
+	}
+}
+
+void COversampler::reset()
+{
+	for (size_t c = 0; c < m_Channels.size(); ++c)
+	{
+		for (int s = 0; s < MAX_FACTOR_LOG2; ++s)
+		{
+			m_Channels[c].up[s].reset();
+			m_Channels[c].down[s].reset();
+		}
+
+		std::fill(m_Channels[c].pad.begin(), m_Channels[c].pad.end(), 0.0f);
+		m_Channels[c].nPadPos = 0;
+	}
+}
@@ -0,0 +1,87 @@
+/*
+==============================================================================
+
+Oversampler.h
+Author: Filipe Borato
+
+==============================================================================
+*/
+#pragma once
+
+#include "EnvelopeDetector.h"
+#include <vector>
+
+// linear phase half-band FIR for 2x interpolation or decimation. Every other tap of a
+// half-band filter is zero and the centre tap is 0.5, so the polyphase form only has to
+// evaluate the (nTaps + 1) / 2 even taps; the other phase is a plain delay
+class CHalfBandFilter
+{
+public:
+	CHalfBandFilter(void);
+	~CHalfBandFilter(void);
+
+	// nTaps must be 4k + 3; nMaxInputSamples is the largest block process() will see.
+	// All memory is allocated here
+	void init(int nTaps, float fKaiserBeta, int nMaxInputSamples);
+	void reset();
+
+	// 2x interpolation: nSamples in, 2 * nSamples out
+	void upsample(const float* pInput, float* pOutput, int nSamples);
+
+	// 2x decimation: 2 * nSamples in, nSamples out
+	void downsample(const float* pInput, float* pOutput, int nSamples);
+
+	// group delay in samples at the higher rate
+	int getLatency() const { return (m_nTaps - 1) / 2; }
+
+protected:
+	int m_nTaps;
+	std::vector<float> m_EvenTaps; // h[0], h[2], ... h[nTaps - 1]
+	std::vector<float> m_Buffer;   // history followed by the current block
+};
+
+// 2x or 4x oversampling as a cascade of half-band stages, one set per channel
+class COversampler
+{
+public:
+	COversampler(void);
+	~COversampler(void);
+
+	// allocate everything for up to 4x on nChannels channels of nMaxSamples base rate samples
+	void init(int nChannels, int nMaxSamples);
+
+	// 0 = off, 1 = 2x, 2 = 4x; clears the filter state when it changes
+	void setFactorLog2(int nFactorLog2);
+	int getFactorLog2() const { return m_nFactorLog2; }
+	int getFactor() const { return 1 << m_nFactorLog2; }
+
+	// round trip (up + down) delay in base rate samples, now or at another factor; always
+	// a whole number
+	float getLatency() const { return getLatency(m_nFactorLog2); }
+	float getLatency(int nFactorLog2) const;
+
+	// upsamples nSamples of pInput into the channel's buffer and returns it
+	// (getFactor() * nSamples long). Only valid while oversampling is on
+	float* upsample(int nChannel, const float* pInput, int nSamples);
+
+	// decimates the channel's buffer back down to nSamples at pOutput
+	void downsample(int nChannel, float* pOutput, int nSamples);
+
+	void reset();
+
+	static const int MAX_FACTOR_LOG2 = 2;
+
+protected:
+	struct Channel
+	{
+		CHalfBandFilter up[MAX_FACTOR_LOG2];
+		CHalfBandFilter down[MAX_FACTOR_LOG2];
+		std::vector<float> stage; // 2x intermediate for the 4x cascade
+		std::vector<float> pad;   // delay between the 4x down stages, see getLatency()
+		int nPadPos = 0;
+		std::vector<float> data;  // the oversampled signal
+	};
+
+	std::vector<Channel> m_Channels;
+	int m_nFactorLog2;
+};
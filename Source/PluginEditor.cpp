@@ -11,85 +11,189 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
-#include "API_Set_File_Upload.h"
 #include "Downloader.h"
+#include "BatchRenderer.h"
 
 //==============================================================================
 CompreezorAudioProcessorEditor::CompreezorAudioProcessorEditor (CompreezorAudioProcessor& p)
     : AudioProcessorEditor (&p), processor (p)
 {
-	bool DigitalAnalogue; //Digital/Analogue style compression
 	addAndMakeVisible(DetGainSlider = new Slider("Det Gain"));
-	DetGainSlider->setRange(-12, 12, 0.01 );
-	DetGainSlider->setValue(processor.DetGain);
 	DetGainSlider->setSliderStyle(Slider::RotaryVerticalDrag);
 	DetGainSlider->setTextBoxStyle(Slider::TextBoxLeft, false, 80, 20);
 	DetGainSlider->setColour(Slider::thumbColourId, Colour(0xffb5b5b5));
-	DetGainSlider->addListener(this);
-	DetGainSlider->setSkewFactorFromMidPoint(0.5);
 
 	addAndMakeVisible(ThresholdSlider = new Slider("Threshold"));
-	ThresholdSlider->setRange(-60, 0, 0.01);
-	ThresholdSlider->setValue(processor.Threshold);
 	ThresholdSlider->setSliderStyle(Slider::RotaryVerticalDrag);
 	ThresholdSlider->setTextBoxStyle(Slider::TextBoxLeft, false, 80, 20);
 	ThresholdSlider->setColour(Slider::thumbColourId, Colour(0xffb5b5b5));
-	ThresholdSlider->addListener(this);
-	ThresholdSlider->setSkewFactor(2);
 
 	addAndMakeVisible(AttackTimeSlider = new Slider("Attack Time"));
-	AttackTimeSlider->setRange(0.02, 300, 0.01);
-	AttackTimeSlider->setValue(processor.AttackTime);
 	AttackTimeSlider->setSliderStyle(Slider::RotaryVerticalDrag);
 	AttackTimeSlider->setTextBoxStyle(Slider::TextBoxLeft, false, 80, 20);
 	AttackTimeSlider->setColour(Slider::thumbColourId, Colour(0xffb5b5b5));
-	AttackTimeSlider->addListener(this);
-	AttackTimeSlider->setSkewFactor(0.5);
 
 
 	addAndMakeVisible(ReleaseTimeSlider = new Slider("Release Time"));
-	ReleaseTimeSlider->setRange(10, 5000, 0.01);
-	ReleaseTimeSlider->setValue(processor.ReleaseTime);
 	ReleaseTimeSlider->setSliderStyle(Slider::RotaryVerticalDrag);
 	ReleaseTimeSlider->setTextBoxStyle(Slider::TextBoxLeft, false, 80, 20);
 	ReleaseTimeSlider->setColour(Slider::thumbColourId, Colour(0xffb5b5b5));
-	ReleaseTimeSlider->addListener(this);
-	ReleaseTimeSlider->setSkewFactor(0.5);
 
 	addAndMakeVisible(RatioSlider = new Slider("Ratio"));
-	RatioSlider->setRange(1, 20, 0.01);
-	RatioSlider->setValue(processor.Ratio);
 	RatioSlider->setSliderStyle(Slider::RotaryVerticalDrag);
 	RatioSlider->setTextBoxStyle(Slider::TextBoxLeft, false, 80, 20);
 	RatioSlider->setColour(Slider::thumbColourId, Colour(0xffb5b5b5));
-	RatioSlider->addListener(this);
 	
 
 	addAndMakeVisible(OutputGainSlider = new Slider("Makeup Gain"));
-	OutputGainSlider->setRange(0, 40, 0.01);
-	OutputGainSlider->setValue(processor.OutputGain);
 	OutputGainSlider->setSliderStyle(Slider::RotaryVerticalDrag);
 	OutputGainSlider->setTextBoxStyle(Slider::TextBoxLeft, false, 80, 20);
 	OutputGainSlider->setColour(Slider::thumbColourId, Colour(0xffb5b5b5));
-	OutputGainSlider->addListener(this);
 
 
 	addAndMakeVisible(KneeWidthSlider = new Slider("Knee Width"));
-	KneeWidthSlider->setRange(0, 20, 0.01);
-	KneeWidthSlider->setValue(processor.KneeWidth);
 	KneeWidthSlider->setSliderStyle(Slider::RotaryVerticalDrag);
 	KneeWidthSlider->setTextBoxStyle(Slider::TextBoxLeft, false, 80, 20);
 	KneeWidthSlider->setColour(Slider::thumbColourId, Colour(0xffb5b5b5));
-	KneeWidthSlider->addListener(this);
+
+	addAndMakeVisible(StereoLinkBox = new ComboBox("Stereo Link"));
+	StereoLinkBox->addItem("Off", CompressorEngine::STEREO_LINK_OFF + 1);
+	StereoLinkBox->addItem("Max", CompressorEngine::STEREO_LINK_MAX + 1);
+	StereoLinkBox->addItem("Mean", CompressorEngine::STEREO_LINK_MEAN + 1);
+	StereoLinkBox->addItem("Sum", CompressorEngine::STEREO_LINK_SUM + 1);
+
+	addAndMakeVisible(OversamplingBox = new ComboBox("Oversampling"));
+	OversamplingBox->addItem("Off", 1);
+	OversamplingBox->addItem("2x", 2);
+	OversamplingBox->addItem("4x", 3);
+
+	addAndMakeVisible(LookaheadSlider = new Slider("Lookahead"));
+	LookaheadSlider->setSliderStyle(Slider::LinearHorizontal);
+	LookaheadSlider->setTextBoxStyle(Slider::TextBoxRight, false, 60, 20);
+	LookaheadSlider->setColour(Slider::thumbColourId, Colour(0xffb5b5b5));
+
+	addAndMakeVisible(BandsBox = new ComboBox("Bands"));
+	BandsBox->addItem("Off", 1);
+	BandsBox->addItem("3 Bands", 2);
+	BandsBox->addItem("4 Bands", 3);
+
+	addAndMakeVisible(LowCrossoverSlider = new Slider("Low Crossover"));
+	LowCrossoverSlider->setSliderStyle(Slider::LinearBar);
+	LowCrossoverSlider->setColour(Slider::thumbColourId, Colour(0xffb5b5b5));
+
+	addAndMakeVisible(MidCrossoverSlider = new Slider("Mid Crossover"));
+	MidCrossoverSlider->setSliderStyle(Slider::LinearBar);
+	MidCrossoverSlider->setColour(Slider::thumbColourId, Colour(0xffb5b5b5));
+
+	addAndMakeVisible(HighCrossoverSlider = new Slider("High Crossover"));
+	HighCrossoverSlider->setSliderStyle(Slider::LinearBar);
+	HighCrossoverSlider->setColour(Slider::thumbColourId, Colour(0xffb5b5b5));
+
+	addAndMakeVisible(ExternalKeyButton = new ToggleButton("External"));
+
+	addAndMakeVisible(AutoReleaseButton = new ToggleButton("Auto Release"));
+
+	addAndMakeVisible(KeyHighPassSlider = new Slider("Key High-Pass"));
+	KeyHighPassSlider->setSliderStyle(Slider::LinearBar);
+	KeyHighPassSlider->setColour(Slider::thumbColourId, Colour(0xffb5b5b5));
+
+	addAndMakeVisible(MixSlider = new Slider("Mix"));
+	MixSlider->setSliderStyle(Slider::LinearHorizontal);
+	MixSlider->setTextBoxStyle(Slider::TextBoxRight, false, 60, 20);
+	MixSlider->setColour(Slider::thumbColourId, Colour(0xffb5b5b5));
 
 	//addAndMakeVisible(DigitalAnalogueButton = new ToggleButton("Digital/Analogue"));
 	//DigitalAnalogueButton->addListener(this);
-	addAndMakeVisible(UploadButton = new TextButton("Upload"));
+
+	// ranges, skews and values come from the parameters
+	DetGainAttachment = new SliderAttachment(processor.parameters, "DetGain", *DetGainSlider);
+	ThresholdAttachment = new SliderAttachment(processor.parameters, "Threshold", *ThresholdSlider);
+	AttackTimeAttachment = new SliderAttachment(processor.parameters, "AttackTime", *AttackTimeSlider);
+	ReleaseTimeAttachment = new SliderAttachment(processor.parameters, "ReleaseTime", *ReleaseTimeSlider);
+	RatioAttachment = new SliderAttachment(processor.parameters, "Ratio", *RatioSlider);
+	OutputGainAttachment = new SliderAttachment(processor.parameters, "OutputGain", *OutputGainSlider);
+	KneeWidthAttachment = new SliderAttachment(processor.parameters, "KneeWidth", *KneeWidthSlider);
+	StereoLinkAttachment = new ComboBoxAttachment(processor.parameters, "StereoLink", *StereoLinkBox);
+	OversamplingAttachment = new ComboBoxAttachment(processor.parameters, "Oversampling", *OversamplingBox);
+	LookaheadAttachment = new SliderAttachment(processor.parameters, "Lookahead", *LookaheadSlider);
+	BandsAttachment = new ComboBoxAttachment(processor.parameters, "Bands", *BandsBox);
+	LowCrossoverAttachment = new SliderAttachment(processor.parameters, "LowCrossover", *LowCrossoverSlider);
+	MidCrossoverAttachment = new SliderAttachment(processor.parameters, "MidCrossover", *MidCrossoverSlider);
+	HighCrossoverAttachment = new SliderAttachment(processor.parameters, "HighCrossover", *HighCrossoverSlider);
+	ExternalKeyAttachment = new ButtonAttachment(processor.parameters, "ExternalKey", *ExternalKeyButton);
+	KeyHighPassAttachment = new SliderAttachment(processor.parameters, "KeyHighPass", *KeyHighPassSlider);
+	AutoReleaseAttachment = new ButtonAttachment(processor.parameters, "AutoRelease", *AutoReleaseButton);
+	MixAttachment = new SliderAttachment(processor.parameters, "Mix", *MixSlider);
+
+	addAndMakeVisible(UploadButton = new TextButton("Split"));
 	UploadButton->addListener(this);
 
-	addAndMakeVisible(DownloadButton = new TextButton("DonwloadToDesktop"));
+	addAndMakeVisible(DownloadButton = new TextButton("Download Stems"));
 	DownloadButton->addListener(this);
 
+	addAndMakeVisible(CaptureButton = new TextButton(processor.isCapturing() ? "Stop Capture" : "Capture"));
+	CaptureButton->addListener(this);
+
+	addAndMakeVisible(FlacUploadButton = new ToggleButton("Upload as FLAC"));
+	FlacUploadButton->setToggleState(processor.UploadAsFlac, dontSendNotification);
+	FlacUploadButton->addListener(this);
+
+	addAndMakeVisible(StemBox = new ComboBox("Stems"));
+	StemBox->setTextWhenNoChoicesAvailable("No stems yet");
+	StemBox->addListener(this);
+
+	addAndMakeVisible(PreviewButton = new TextButton(processor.isPreviewing() ? "Stop" : "Play"));
+	PreviewButton->addListener(this);
+	updateStemBox();
+
+	addAndMakeVisible(BatchButton = new TextButton("Batch Render"));
+	BatchButton->addListener(this);
+
+	addAndMakeVisible(ServerEditor = new TextEditor("Split Server"));
+	ServerEditor->setText(processor.getSplitServer(), dontSendNotification);
+	ServerEditor->onTextChange = [this] { processor.setSplitServer(ServerEditor->getText()); };
+
+	addAndMakeVisible(QueueSplitButton = new TextButton("Queue Split"));
+	QueueSplitButton->addListener(this);
+
+	addAndMakeVisible(ClearJobsButton = new TextButton("Clear Finished"));
+	ClearJobsButton->addListener(this);
+
+	addAndMakeVisible(MonitorButton = new ToggleButton("Measure Timing"));
+	MonitorButton->setToggleState(processor.m_Monitor.isEnabled(), dontSendNotification);
+	MonitorButton->addListener(this);
+
+	addAndMakeVisible(MonitorReportButton = new TextButton("Timing Report"));
+	MonitorReportButton->addListener(this);
+
+	addAndMakeVisible(PresetBox = new ComboBox("Presets"));
+	PresetBox->setTextWhenNoChoicesAvailable("No presets yet");
+	PresetBox->addListener(this);
+	updatePresetBox();
+
+	addAndMakeVisible(SavePresetButton = new TextButton("Save Preset"));
+	SavePresetButton->addListener(this);
+
+	addAndMakeVisible(ProcessStemsButton = new TextButton("Process Stems"));
+	ProcessStemsButton->addListener(this);
+
+	addAndMakeVisible(JobsView = new TextEditor("Split Jobs"));
+	JobsView->setMultiLine(true);
+	JobsView->setReadOnly(true);
+	JobsView->setCaretVisible(false);
+	updateJobsView();
+
+	// the meters repaint themselves on their own timer, the editor is never repainted for them
+	addAndMakeVisible(Meters = new MeterStrip(processor.m_Engine.m_InputMeter, processor.m_Engine.m_OutputMeter,
+		processor.m_Engine.m_GainReductionMeter));
+	addAndMakeVisible(GainView = new GainDisplay(processor.parameters, processor.m_Engine.m_GainHistory));
+	setOpaque(true);
+
+#if COMPREEZOR_USE_OPENGL
+	// composites the editor and its children on the GPU; still only dirty areas are redrawn
+	OpenGL.attachTo(*this);
+#endif
+
 	//drawable1 = Drawable::createFromImageData(BinaryData::brushedMetalSHRUNK_jpg, BinaryData::brushedMetalSHRUNK_jpgSize);
 
 	//cachedImage_brushedMetalShrunk_jpg_1 = ImageCache::getFromMemory(brushedMetalShrunk_jpg, brushedMetalShrunk_jpgSize);
@@ -98,7 +202,10 @@ CompreezorAudioProcessorEditor::CompreezorAudioProcessorEditor (CompreezorAudioP
 	//[UserPreSize]
 	//[/UserPreSize]
 
-	setSize(880, 310);
+	setSize(880, 758);
+
+	// the jobs run in the processor, the list is only polled for display
+	startTimerHz(2);
 
 
 	//[Constructor] You can add your own custom stuff here..
@@ -110,6 +217,30 @@ CompreezorAudioProcessorEditor::CompreezorAudioProcessorEditor (CompreezorAudioP
 
 CompreezorAudioProcessorEditor::~CompreezorAudioProcessorEditor()
 {
+	stopTimer();
+#if COMPREEZOR_USE_OPENGL
+	OpenGL.detach();
+#endif
+
+	DetGainAttachment = nullptr;
+	ThresholdAttachment = nullptr;
+	AttackTimeAttachment = nullptr;
+	ReleaseTimeAttachment = nullptr;
+	RatioAttachment = nullptr;
+	OutputGainAttachment = nullptr;
+	KneeWidthAttachment = nullptr;
+	StereoLinkAttachment = nullptr;
+	OversamplingAttachment = nullptr;
+	LookaheadAttachment = nullptr;
+	BandsAttachment = nullptr;
+	LowCrossoverAttachment = nullptr;
+	MidCrossoverAttachment = nullptr;
+	HighCrossoverAttachment = nullptr;
+	ExternalKeyAttachment = nullptr;
+	KeyHighPassAttachment = nullptr;
+	AutoReleaseAttachment = nullptr;
+	MixAttachment = nullptr;
+
 	DetGainSlider = nullptr;
 	ThresholdSlider = nullptr;
 	AttackTimeSlider = nullptr;
@@ -117,14 +248,62 @@ CompreezorAudioProcessorEditor::~CompreezorAudioProcessorEditor()
 	RatioSlider = nullptr;
 	OutputGainSlider = nullptr;
 	KneeWidthSlider = nullptr;
+	StereoLinkBox = nullptr;
+	OversamplingBox = nullptr;
+	LookaheadSlider = nullptr;
+	BandsBox = nullptr;
+	LowCrossoverSlider = nullptr;
+	MidCrossoverSlider = nullptr;
+	HighCrossoverSlider = nullptr;
+	ExternalKeyButton = nullptr;
+	KeyHighPassSlider = nullptr;
+	AutoReleaseButton = nullptr;
+	MixSlider = nullptr;
 	//DigitalAnalogueButton = nullptr;
 	//drawable1 = nullptr;
 	UploadButton = nullptr;
 	DownloadButton = nullptr;
+	CaptureButton = nullptr;
+	FlacUploadButton = nullptr;
+	StemBox = nullptr;
+	PreviewButton = nullptr;
+	BatchButton = nullptr;
+	ServerEditor = nullptr;
+	QueueSplitButton = nullptr;
+	ClearJobsButton = nullptr;
+	JobsView = nullptr;
+	MonitorButton = nullptr;
+	MonitorReportButton = nullptr;
+	PresetBox = nullptr;
+	SavePresetButton = nullptr;
+	ProcessStemsButton = nullptr;
+	Meters = nullptr;
+	GainView = nullptr;
+	DownloadProgressBar = nullptr;
+	ActiveDownload = nullptr;
 }
 
 //==============================================================================
 void CompreezorAudioProcessorEditor::paint (Graphics& g)
+{
+	// the labels never change, so they are drawn once at the display's pixel scale and
+	// every repaint after that is a single image blit
+	const float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+	const int width = roundToInt(getWidth() * scale);
+	const int height = roundToInt(getHeight() * scale);
+
+	if (BackgroundImage.getWidth() != width || BackgroundImage.getHeight() != height)
+	{
+		BackgroundImage = Image(Image::RGB, jmax(1, width), jmax(1, height), false);
+		Graphics imageGraphics(BackgroundImage);
+		imageGraphics.addTransform(AffineTransform::scale(scale));
+		paintBackground(imageGraphics);
+	}
+
+	g.drawImage(BackgroundImage, getLocalBounds().toFloat());
+}
+
+void CompreezorAudioProcessorEditor::paintBackground(Graphics& g)
 {
 	// (Our component is opaque, so we must completely fill the background with a solid colour)
 	g.fillAll(getLookAndFeel().findColour(ResizableWindow::backgroundColourId));
@@ -235,6 +414,116 @@ void CompreezorAudioProcessorEditor::paint (Graphics& g)
 		g.drawText(text, x, y, width, height,
 			Justification::centred, true);
 	}
+
+	{
+		int x = 36, y = 312, width = 120, height = 30;
+		String text(TRANS("Stereo Link"));
+		Colour fillColour = Colour(0xffb9b9b9);
+		g.setColour(fillColour);
+		g.setFont(Font(17.0f, Font::plain).withTypefaceStyle("Regular"));
+		g.drawText(text, x, y, width, height,
+			Justification::centredRight, true);
+	}
+
+	{
+		int x = 272, y = 312, width = 120, height = 30;
+		String text(TRANS("Oversampling"));
+		Colour fillColour = Colour(0xffb9b9b9);
+		g.setColour(fillColour);
+		g.setFont(Font(17.0f, Font::plain).withTypefaceStyle("Regular"));
+		g.drawText(text, x, y, width, height,
+			Justification::centredRight, true);
+	}
+
+	{
+		int x = 508, y = 312, width = 100, height = 30;
+		String text(TRANS("Lookahead"));
+		Colour fillColour = Colour(0xffb9b9b9);
+		g.setColour(fillColour);
+		g.setFont(Font(17.0f, Font::plain).withTypefaceStyle("Regular"));
+		g.drawText(text, x, y, width, height,
+			Justification::centredRight, true);
+	}
+
+	{
+		int x = 36, y = 350, width = 120, height = 30;
+		String text(TRANS("Bands"));
+		Colour fillColour = Colour(0xffb9b9b9);
+		g.setColour(fillColour);
+		g.setFont(Font(17.0f, Font::plain).withTypefaceStyle("Regular"));
+		g.drawText(text, x, y, width, height,
+			Justification::centredRight, true);
+	}
+
+	{
+		int x = 272, y = 350, width = 120, height = 30;
+		String text(TRANS("Crossovers"));
+		Colour fillColour = Colour(0xffb9b9b9);
+		g.setColour(fillColour);
+		g.setFont(Font(17.0f, Font::plain).withTypefaceStyle("Regular"));
+		g.drawText(text, x, y, width, height,
+			Justification::centredRight, true);
+	}
+
+	{
+		int x = 272, y = 388, width = 120, height = 30;
+		String text(TRANS("Stems"));
+		Colour fillColour = Colour(0xffb9b9b9);
+		g.setColour(fillColour);
+		g.setFont(Font(17.0f, Font::plain).withTypefaceStyle("Regular"));
+		g.drawText(text, x, y, width, height,
+			Justification::centredRight, true);
+	}
+
+	{
+		int x = 36, y = 426, width = 120, height = 30;
+		String text(TRANS("Split Server"));
+		Colour fillColour = Colour(0xffb9b9b9);
+		g.setColour(fillColour);
+		g.setFont(Font(17.0f, Font::plain).withTypefaceStyle("Regular"));
+		g.drawText(text, x, y, width, height,
+			Justification::centredRight, true);
+	}
+
+	{
+		int x = 36, y = 684, width = 120, height = 30;
+		String text(TRANS("Sidechain"));
+		Colour fillColour = Colour(0xffb9b9b9);
+		g.setColour(fillColour);
+		g.setFont(Font(17.0f, Font::plain).withTypefaceStyle("Regular"));
+		g.drawText(text, x, y, width, height,
+			Justification::centredRight, true);
+	}
+
+	{
+		int x = 272, y = 684, width = 120, height = 30;
+		String text(TRANS("Key High-Pass"));
+		Colour fillColour = Colour(0xffb9b9b9);
+		g.setColour(fillColour);
+		g.setFont(Font(17.0f, Font::plain).withTypefaceStyle("Regular"));
+		g.drawText(text, x, y, width, height,
+			Justification::centredRight, true);
+	}
+
+	{
+		int x = 616, y = 684, width = 40, height = 30;
+		String text(TRANS("Mix"));
+		Colour fillColour = Colour(0xffb9b9b9);
+		g.setColour(fillColour);
+		g.setFont(Font(17.0f, Font::plain).withTypefaceStyle("Regular"));
+		g.drawText(text, x, y, width, height,
+			Justification::centredRight, true);
+	}
+
+	{
+		int x = 36, y = 718, width = 120, height = 30;
+		String text(TRANS("Preset"));
+		Colour fillColour = Colour(0xffb9b9b9);
+		g.setColour(fillColour);
+		g.setFont(Font(17.0f, Font::plain).withTypefaceStyle("Regular"));
+		g.drawText(text, x, y, width, height,
+			Justification::centredRight, true);
+	}
 }
 
 void CompreezorAudioProcessorEditor::resized()
@@ -248,71 +537,110 @@ void CompreezorAudioProcessorEditor::resized()
 	RatioSlider->setBounds(56, 184, 160, 112);
 	OutputGainSlider->setBounds(256, 184, 160, 112);
 	KneeWidthSlider->setBounds(464, 184, 160, 112);
+	StereoLinkBox->setBounds(164, 315, 100, 24);
+	OversamplingBox->setBounds(400, 315, 100, 24);
+	LookaheadSlider->setBounds(616, 315, 100, 24);
+	BandsBox->setBounds(164, 353, 100, 24);
+	LowCrossoverSlider->setBounds(400, 353, 100, 24);
+	MidCrossoverSlider->setBounds(508, 353, 100, 24);
+	HighCrossoverSlider->setBounds(616, 353, 100, 24);
+	ExternalKeyButton->setBounds(164, 687, 100, 24);
+	KeyHighPassSlider->setBounds(400, 687, 208, 24);
+	AutoReleaseButton->setBounds(728, 315, 120, 24);
+	MixSlider->setBounds(664, 687, 200, 24);
 	//DigitalAnalogueButton->setBounds(680, 224, 150, 24);
-	UploadButton->setBounds(656, 210, 160, 25);
+	UploadButton->setBounds(656, 210, 78, 25);
+	CaptureButton->setBounds(738, 210, 78, 25);
 	DownloadButton->setBounds(656, 255, 160, 25);
+	BatchButton->setBounds(728, 353, 120, 24);
+	FlacUploadButton->setBounds(36, 391, 160, 24);
+	StemBox->setBounds(400, 391, 208, 24);
+	PreviewButton->setBounds(616, 391, 100, 24);
+	ServerEditor->setBounds(164, 429, 300, 24);
+	QueueSplitButton->setBounds(472, 429, 120, 24);
+	ClearJobsButton->setBounds(600, 429, 120, 24);
+	JobsView->setBounds(36, 462, 808, 96);
+	MonitorButton->setBounds(728, 391, 120, 24);
+	MonitorReportButton->setBounds(728, 429, 116, 24);
+	PresetBox->setBounds(164, 721, 300, 24);
+	SavePresetButton->setBounds(472, 721, 120, 24);
+	ProcessStemsButton->setBounds(728, 721, 120, 24);
+	Meters->setBounds(826, 56, 48, 240);
+	GainView->setBounds(36, 570, 808, 108);
+
+	// redrawn at the new size on the next paint
+	BackgroundImage = Image();
 }
 
-void CompreezorAudioProcessorEditor::sliderValueChanged(Slider* sliderThatWasMoved)
+void CompreezorAudioProcessorEditor::timerCallback()
 {
-	//[UsersliderValueChanged_Pre]
-	//[/UsersliderValueChanged_Pre]
+	updateJobsView();
+	updatePresetBox();
+}
 
-	if (sliderThatWasMoved == DetGainSlider)
+void CompreezorAudioProcessorEditor::updatePresetBox()
+{
+	// the bank scans in the background, so the list fills in on a later tick
+	const StringArray names = processor.getPresetNames();
+	if (names != PresetNames)
 	{
-		//[UserSliderCode_slider] -- add your slider handling code here..
-		//[/UserSliderCode_slider]
+		PresetNames = names;
+		PresetBox->clear(dontSendNotification);
+		PresetBox->addItemList(PresetNames, 1);
+	}
 
-		processor.DetGain = pow(10.0, DetGainSlider->getValue() / 20.0);
+	if (PresetNames.size() > 0 && PresetBox->getSelectedItemIndex() != processor.getCurrentProgram())
+		PresetBox->setSelectedItemIndex(processor.getCurrentProgram(), dontSendNotification);
+}
 
+void CompreezorAudioProcessorEditor::updateJobsView()
+{
+	String text;
+	for (const SplitJobQueue::JobInfo& job : processor.m_SplitJobs.getJobs())
+	{
+		text << job.file.getFileName() << "  " << SplitJobQueue::getStateName(job.state);
+		if (job.progress >= 0 && job.state != SplitJobQueue::State::done && job.state != SplitJobQueue::State::failed)
+			text << " " << roundToInt(job.progress * 100.0) << "%";
+		if (job.message.isNotEmpty())
+			text << "  " << job.message;
+		text << newLine;
+
+		// the stems of a streaming split can be auditioned as soon as the first segment is back
+		if (job.id == processor.StemJobId && job.stems != processor.StemFiles)
+		{
+			processor.StemFiles = job.stems;
+			updateStemBox();
+		}
 	}
 
-	else if (sliderThatWasMoved == ThresholdSlider)
-	{
-		//[UserSliderCode_slider2] -- add your slider handling code here..
-		//[/UserSliderCode_slider2]
-		processor.Threshold = ThresholdSlider->getValue();
+	if (text != JobsView->getText())
+		JobsView->setText(text, false);
+}
 
+void CompreezorAudioProcessorEditor::updateStemBox()
+{
+	StemBox->clear(dontSendNotification);
+	for (int i = 0; i < processor.StemFiles.size(); ++i)
+		StemBox->addItem(processor.StemFiles[i].getFileName(), i + 1);
 
-	}
+	if (processor.StemFiles.size() > 0)
+		StemBox->setSelectedItemIndex(0, dontSendNotification);
+}
 
-	else if (sliderThatWasMoved == AttackTimeSlider)
-	{
-		//[UserSliderCode_slider3] -- add your slider handling code here..
-		//[/UserSliderCode_slider3]
-		processor.AttackTime = AttackTimeSlider->getValue();
-		processor.m_LeftDetector.setAttackTime(AttackTimeSlider->getValue());
-	}
+void CompreezorAudioProcessorEditor::comboBoxChanged(ComboBox* comboBoxThatHasChanged)
+{
+	if (comboBoxThatHasChanged == PresetBox)
+		processor.loadPreset(PresetBox->getSelectedItemIndex());
 
-	else if (sliderThatWasMoved == ReleaseTimeSlider)
+	// picking another stem while one plays switches the preview over to it
+	if (comboBoxThatHasChanged == StemBox && processor.isPreviewing())
 	{
-		//[UserSliderCode_slider4] -- add your slider handling code here..
-		//[/UserSliderCode_slider4]
-		processor.ReleaseTime = ReleaseTimeSlider->getValue();
-		processor.m_LeftDetector.setReleaseTime(ReleaseTimeSlider->getValue());
-	}
-	else if (sliderThatWasMoved == RatioSlider)
-	{
-		//[UserSliderCode_slider5] -- add your slider handling code here..
-		//[/UserSliderCode_slider5]
-		processor.Ratio = RatioSlider->getValue();
+		const int stem = StemBox->getSelectedItemIndex();
+		if (isPositiveAndBelow(stem, processor.StemFiles.size()))
+			processor.startPreview(processor.StemFiles[stem]);
 
+		PreviewButton->setButtonText(processor.isPreviewing() ? "Stop" : "Play");
 	}
-	else if (sliderThatWasMoved == OutputGainSlider)
-	{
-		//[UserSliderCode_slider6] -- add your slider handling code here..
-		//[/UserSliderCode_slider6]
-		processor.OutputGain = pow(10.0, OutputGainSlider->getValue() / 20.0);
-	}
-	else if (sliderThatWasMoved == KneeWidthSlider)
-	{
-		//[UserSliderCode_slider7] -- add your slider handling code here..
-		//[/UserSliderCode_slider7]
-		processor.KneeWidth = KneeWidthSlider->getValue();
-	}
-
-	//[UsersliderValueChanged_Post]
-	//[/UsersliderValueChanged_Post]
 }
 
 void CompreezorAudioProcessorEditor::buttonClicked(Button* buttonThatWasClicked)
@@ -329,58 +657,199 @@ void CompreezorAudioProcessorEditor::buttonClicked(Button* buttonThatWasClicked)
 
 	if (buttonThatWasClicked == UploadButton)
 	{
-		//URL Url("http://127.0.0.1:5000/upload");
-
-		String host_name = "http://127.0.0.1:5000/";
 		FileChooser chooser("Select audio file for Upload and Split...",
 							{},
 							"*.wav; *.mp3; *.aiff");
 
-		if (chooser.browseForFileToOpen())                                          
+		if (chooser.browseForFileToOpen())
 		{
-			File file = chooser.getResult();
-
-			API_Set_File_Upload file_upload(file, host_name);
-			if (file_upload.runThread())
+			FileChooser folderChooser("Select the folder for the separated stems...",
+				File::getSpecialLocation(File::userDesktopDirectory).getChildFile("Separate"));
+			if (folderChooser.browseForDirectory())
 			{
-				DBG("Finished uploading file " + file.getFileName());
+				// streamed in segments; StemBox fills in as the server separates them
+				const File file = chooser.getResult();
+				processor.StemJobId = processor.m_SplitJobs.addJob(file,
+					File(folderChooser.getResult()).getChildFile(file.getFileNameWithoutExtension()),
+					processor.getSplitServer(), processor.UploadAsFlac, true);
+
+				updateJobsView();
 			}
+		}
+	}
+	if (buttonThatWasClicked == DownloadButton)
+	{
+		// a second click cancels
+		if (ActiveDownload != nullptr)
+		{
+			ActiveDownload->cancel();
+			return;
+		}
+
+		FileChooser folderChooser("Select the folder for the separated stems...",
+			File::getSpecialLocation(File::userDesktopDirectory).getChildFile("Separate"));
+		if (!folderChooser.browseForDirectory())
+			return;
+
+		const File stemFolder(folderChooser.getResult());
+
+		// the zip is unpacked as it arrives, it is never stored
+		ActiveDownload = new Downloader(URL(processor.getSplitServer() + "/download"));
+		ActiveDownload->onFinish = [this, stemFolder](bool success)
+		{
+			if (success)
+				DBG("Extracted " + String(ActiveDownload->extractedFiles.size()) + " files to " + stemFolder.getFullPathName());
 			else
+				AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "Download failed", ActiveDownload->error);
+
+			processor.StemJobId.clear();
+			processor.StemFiles.clearQuick();
+			for (const File& file : ActiveDownload->extractedFiles)
+				if (file.hasFileExtension("wav;aif;aiff"))
+					processor.StemFiles.add(file);
+			updateStemBox();
+
+			DownloadButton->setButtonText("Download Stems");
+			DownloadProgressBar = nullptr;
+			ActiveDownload = nullptr;
+		};
+
+		addAndMakeVisible(DownloadProgressBar = new ProgressBar(ActiveDownload->progress));
+		DownloadProgressBar->setBounds(656, 284, 160, 20);
+		DownloadButton->setButtonText("Cancel Download");
+
+		ActiveDownload->downloadAndExtract(stemFolder);
+	}
+
+	if (buttonThatWasClicked == PreviewButton)
+	{
+		const int stem = StemBox->getSelectedItemIndex();
+		if (processor.isPreviewing())
+			processor.stopPreview();
+		else if (isPositiveAndBelow(stem, processor.StemFiles.size()))
+			processor.startPreview(processor.StemFiles[stem]);
+
+		PreviewButton->setButtonText(processor.isPreviewing() ? "Stop" : "Play");
+	}
+
+	if (buttonThatWasClicked == FlacUploadButton)
+		processor.UploadAsFlac = FlacUploadButton->getToggleState();
+
+	if (buttonThatWasClicked == CaptureButton)
+	{
+		// the processed output streams to the server while it plays, no bounce needed
+		if (processor.isCapturing())
+			processor.stopCapture();
+		else
+			processor.startCapture(processor.getSplitServer());
+
+		CaptureButton->setButtonText(processor.isCapturing() ? "Stop Capture" : "Capture");
+	}
+
+	if (buttonThatWasClicked == QueueSplitButton)
+	{
+		FileChooser chooser("Select audio files to split...",
+							{},
+							"*.wav; *.mp3; *.aiff");
+
+		if (chooser.browseForMultipleFilesToOpen())
+		{
+			FileChooser folderChooser("Select the folder for the separated stems...",
+				File::getSpecialLocation(File::userDesktopDirectory).getChildFile("Separate"));
+			if (folderChooser.browseForDirectory())
 			{
-				DBG("File upload was canceled by user");
+				// one stem folder per file, the jobs carry on in the background
+				const File stemFolder(folderChooser.getResult());
+				for (const File& file : chooser.getResults())
+					processor.m_SplitJobs.addJob(file, stemFolder.getChildFile(file.getFileNameWithoutExtension()),
+						processor.getSplitServer(), processor.UploadAsFlac);
+
+				updateJobsView();
 			}
-			
-			//auto* reader = formatManager.createReaderFor(file);                    
-
-			//if (reader != nullptr)
-			//{
-			/*Url.withFileToUpload("audio",
-				file,
-				"application/octet-stream"
-			);	*/	
-			//}			
-		}		
+		}
 	}
-	if (buttonThatWasClicked == DownloadButton)
-	{		
-		URL fileUrl("http://127.0.0.1:5000/download");
 
-		ScopedPointer<InputStream> fileStream = fileUrl.createInputStream(false);
-		File localFile(juce::File::getSpecialLocation(juce::File::userDesktopDirectory).getChildFile("Separate.zip"));
+	if (buttonThatWasClicked == ClearJobsButton)
+	{
+		processor.m_SplitJobs.removeFinishedJobs();
+		updateJobsView();
+	}
 
-		localFile.deleteFile();
+	if (buttonThatWasClicked == MonitorButton)
+		processor.m_Monitor.setEnabled(MonitorButton->getToggleState());
 
-		MemoryBlock mem(2048);
-		fileStream->readIntoMemoryBlock(mem);
-		FileOutputStream out(localFile);
+	if (buttonThatWasClicked == MonitorReportButton)
+	{
+		FileChooser chooser("Save the processBlock timing report...",
+			File::getSpecialLocation(File::userDesktopDirectory).getChildFile("Compreezor Timing.txt"),
+			"*.txt");
 
-		out.write(mem.getData(), mem.getSize());
+		if (chooser.browseForFileToSave(true) && !processor.m_Monitor.dumpReport(chooser.getResult()))
+			AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "Timing Report",
+				"Cannot write " + chooser.getResult().getFullPathName());
+	}
+
+	if (buttonThatWasClicked == SavePresetButton)
+	{
+		const File folder = PresetBank::getFolder();
+		folder.createDirectory();
+
+		FileChooser chooser("Save the current settings as a preset...", folder, "*.xml");
+		if (chooser.browseForFileToSave(true))
+		{
+			if (processor.savePreset(chooser.getResult().getFileNameWithoutExtension()))
+				updatePresetBox();
+			else
+				AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "Save Preset",
+					"Cannot write " + chooser.getResult().getFileName());
+		}
+	}
+
+	if (buttonThatWasClicked == BatchButton)
+	{
+		FileChooser chooser("Select audio files to compress...",
+							{},
+							"*.wav; *.aiff; *.aif");
+
+		if (chooser.browseForMultipleFilesToOpen())
+		{
+			Array<File> files = chooser.getResults();
+
+			FileChooser folderChooser("Select the output folder...");
+			if (folderChooser.browseForDirectory())
+			{
+				// every file is rendered with the current settings
+				BatchRenderer renderer(files, folderChooser.getResult(), processor.getEngineParameters());
+				renderer.runThread();
+
+				AlertWindow::showMessageBoxAsync(AlertWindow::InfoIcon, "Batch Render", renderer.getSummary());
+			}
+		}
+	}
+
+	if (buttonThatWasClicked == ProcessStemsButton)
+	{
+		if (processor.StemFiles.isEmpty())
+		{
+			AlertWindow::showMessageBoxAsync(AlertWindow::InfoIcon, "Process Stems",
+				"Split a file first, its stems are processed here.");
+			return;
+		}
+
+		FileChooser folderChooser("Select the folder for the processed stems...");
+		if (folderChooser.browseForDirectory())
+		{
+			// each stem through its own chain, all at once, then summed into Mix.wav
+			Array<CompressorEngine::Parameters> params;
+			for (const File& stem : processor.StemFiles)
+				params.add(processor.getStemParameters(stem));
 
-		/*URL zipUrl("http://127.0.0.1:5000/download");
-		InputStream* urlStream = zipUrl.createInputStream(false);
-		ZipFile zipFile(urlStream, true);
-		zipFile.uncompressTo(File::getSpecialLocation(File::userDesktopDirectory));*/
+			const File outputFolder(folderChooser.getResult());
+			BatchRenderer renderer(processor.StemFiles, outputFolder, params, outputFolder.getChildFile("Mix.wav"));
+			renderer.runThread();
 
+			AlertWindow::showMessageBoxAsync(AlertWindow::InfoIcon, "Process Stems", renderer.getSummary());
+		}
 	}
 
 	//[UserbuttonClicked_Post]
@@ -13,13 +13,21 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "PluginProcessor.h"
+#include "MeterStrip.h"
+#include "GainDisplay.h"
 
+struct Downloader;
+
+// draws the editor through an OpenGLContext; 0 falls back to the software renderer
+#ifndef COMPREEZOR_USE_OPENGL
+#define COMPREEZOR_USE_OPENGL 1
+#endif
 
 //==============================================================================
 /**
 */
-class CompreezorAudioProcessorEditor : public AudioProcessorEditor, public Slider::Listener,
-	public Button::Listener
+class CompreezorAudioProcessorEditor : public AudioProcessorEditor, public Button::Listener,
+	public ComboBox::Listener, private Timer
 {
 public:
     CompreezorAudioProcessorEditor (CompreezorAudioProcessor&);
@@ -28,8 +36,14 @@ public:
     //==============================================================================
     void paint (Graphics&) override;
     void resized() override;
-	void sliderValueChanged(Slider* sliderThatWasMoved) override;
 	void buttonClicked(Button* buttonThatWasClicked) override;
+	void comboBoxChanged(ComboBox* comboBoxThatHasChanged) override;
+	// fills StemBox from processor.StemFiles
+	void updateStemBox();
+	// one line per job in processor.m_SplitJobs
+	void updateJobsView();
+	// fills PresetBox when the preset list changed and follows the current preset
+	void updatePresetBox();
 	// Binary resources:
 	static const char* brushedMetalShrunk_jpg;
 	static const int brushedMetalShrunk_jpgSize;
@@ -40,18 +54,82 @@ public:
 	ScopedPointer<Slider> RatioSlider;
 	ScopedPointer<Slider> OutputGainSlider;
 	ScopedPointer<Slider> KneeWidthSlider;
+	ScopedPointer<ComboBox> StereoLinkBox;
+	ScopedPointer<ComboBox> OversamplingBox;
+	ScopedPointer<Slider> LookaheadSlider;
+	ScopedPointer<ComboBox> BandsBox;
+	ScopedPointer<Slider> LowCrossoverSlider;
+	ScopedPointer<Slider> MidCrossoverSlider;
+	ScopedPointer<Slider> HighCrossoverSlider;
+	ScopedPointer<ToggleButton> ExternalKeyButton;
+	ScopedPointer<Slider> KeyHighPassSlider;
+	ScopedPointer<ToggleButton> AutoReleaseButton;
+	ScopedPointer<Slider> MixSlider;
 	//ScopedPointer<ToggleButton> DigitalAnalogueButton;
 	//ScopedPointer<Drawable> drawable1;
 	ScopedPointer<TextButton> UploadButton;
 	ScopedPointer<TextButton> DownloadButton;
+	ScopedPointer<TextButton> CaptureButton;
+	ScopedPointer<ToggleButton> FlacUploadButton;
+	ScopedPointer<ComboBox> StemBox;
+	ScopedPointer<TextButton> PreviewButton;
+	ScopedPointer<TextButton> BatchButton;
+	ScopedPointer<TextEditor> ServerEditor;
+	ScopedPointer<TextButton> QueueSplitButton;
+	ScopedPointer<TextButton> ClearJobsButton;
+	ScopedPointer<TextEditor> JobsView;
+	ScopedPointer<ToggleButton> MonitorButton;
+	ScopedPointer<TextButton> MonitorReportButton;
+	ScopedPointer<ComboBox> PresetBox;
+	ScopedPointer<TextButton> SavePresetButton;
+	ScopedPointer<TextButton> ProcessStemsButton;
+	StringArray PresetNames; // what PresetBox shows
+	ScopedPointer<MeterStrip> Meters;
+	ScopedPointer<GainDisplay> GainView;
+	ScopedPointer<Downloader> ActiveDownload;      // runs in the background while the editor is open
+	ScopedPointer<ProgressBar> DownloadProgressBar; // watches ActiveDownload, so it goes first
 	ScopedPointer<URL> Url;
 
+	typedef AudioProcessorValueTreeState::SliderAttachment SliderAttachment;
+	typedef AudioProcessorValueTreeState::ComboBoxAttachment ComboBoxAttachment;
+	typedef AudioProcessorValueTreeState::ButtonAttachment ButtonAttachment;
+
+	// these bind the controls to processor.parameters; they must go before the controls do
+	ScopedPointer<SliderAttachment> DetGainAttachment;
+	ScopedPointer<SliderAttachment> ThresholdAttachment;
+	ScopedPointer<SliderAttachment> AttackTimeAttachment;
+	ScopedPointer<SliderAttachment> ReleaseTimeAttachment;
+	ScopedPointer<SliderAttachment> RatioAttachment;
+	ScopedPointer<SliderAttachment> OutputGainAttachment;
+	ScopedPointer<SliderAttachment> KneeWidthAttachment;
+	ScopedPointer<ComboBoxAttachment> StereoLinkAttachment;
+	ScopedPointer<ComboBoxAttachment> OversamplingAttachment;
+	ScopedPointer<SliderAttachment> LookaheadAttachment;
+	ScopedPointer<ComboBoxAttachment> BandsAttachment;
+	ScopedPointer<SliderAttachment> LowCrossoverAttachment;
+	ScopedPointer<SliderAttachment> MidCrossoverAttachment;
+	ScopedPointer<SliderAttachment> HighCrossoverAttachment;
+	ScopedPointer<ButtonAttachment> ExternalKeyAttachment;
+	ScopedPointer<SliderAttachment> KeyHighPassAttachment;
+	ScopedPointer<ButtonAttachment> AutoReleaseAttachment;
+	ScopedPointer<SliderAttachment> MixAttachment;
+
 
 private:
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     CompreezorAudioProcessor& processor;
 
+	void timerCallback() override;
+
+	// the static labels, into BackgroundImage
+	void paintBackground(Graphics& g);
+	Image BackgroundImage; // empty until the first paint at the current size
+
+#if COMPREEZOR_USE_OPENGL
+	OpenGLContext OpenGL;
+#endif
+
 	
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CompreezorAudioProcessorEditor)
@@ -11,6 +11,7 @@ Author: Filipe Borato
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "CaptureUploader.h"
 
 
 //==============================================================================
@@ -20,16 +21,87 @@ CompreezorAudioProcessor::CompreezorAudioProcessor()
 #if ! JucePlugin_IsMidiEffect
 #if ! JucePlugin_IsSynth
 		.withInput("Input", AudioChannelSet::stereo(), true)
+		.withInput("Sidechain", AudioChannelSet::stereo(), false)
 #endif
 		.withOutput("Output", AudioChannelSet::stereo(), true)
 #endif
-	)
+	),
+#else
+	:
 #endif
+	parameters(*this, nullptr, "PARAMETERS", createParameterLayout())
 {
+	m_pDetGain = parameters.getRawParameterValue("DetGain");
+	m_pThreshold = parameters.getRawParameterValue("Threshold");
+	m_pAttackTime = parameters.getRawParameterValue("AttackTime");
+	m_pReleaseTime = parameters.getRawParameterValue("ReleaseTime");
+	m_pRatio = parameters.getRawParameterValue("Ratio");
+	m_pOutputGain = parameters.getRawParameterValue("OutputGain");
+	m_pKneeWidth = parameters.getRawParameterValue("KneeWidth");
+	m_pStereoLink = parameters.getRawParameterValue("StereoLink");
+	m_pOversampling = parameters.getRawParameterValue("Oversampling");
+	m_pLookahead = parameters.getRawParameterValue("Lookahead");
+	m_pBands = parameters.getRawParameterValue("Bands");
+	m_pLowCrossover = parameters.getRawParameterValue("LowCrossover");
+	m_pMidCrossover = parameters.getRawParameterValue("MidCrossover");
+	m_pHighCrossover = parameters.getRawParameterValue("HighCrossover");
+	m_pExternalKey = parameters.getRawParameterValue("ExternalKey");
+	m_pKeyHighPass = parameters.getRawParameterValue("KeyHighPass");
+	m_pAutoRelease = parameters.getRawParameterValue("AutoRelease");
+	m_pMix = parameters.getRawParameterValue("Mix");
+
+	m_Presets->addChangeListener(this);
 }
 
 CompreezorAudioProcessor::~CompreezorAudioProcessor()
 {
+	m_Presets->removeChangeListener(this);
+}
+
+AudioProcessorValueTreeState::ParameterLayout CompreezorAudioProcessor::createParameterLayout()
+{
+	// same ranges and skews the editor's sliders always had
+	NormalisableRange<float> detGainRange(-12, 12, 0.01);
+	detGainRange.setSkewForCentre(0.5);
+
+	AudioProcessorValueTreeState::ParameterLayout layout;
+	layout.add(std::make_unique<AudioParameterFloat>("DetGain", "Input Gain", detGainRange, 0.0f, "dB"),
+		std::make_unique<AudioParameterFloat>("Threshold", "Threshold",
+			NormalisableRange<float>(-60, 0, 0.01, 2), 0.0f, "dB"),
+		std::make_unique<AudioParameterFloat>("AttackTime", "Attack Time",
+			NormalisableRange<float>(0.02, 300, 0.01, 0.5), 10.0f, "ms"),
+		std::make_unique<AudioParameterFloat>("ReleaseTime", "Release Time",
+			NormalisableRange<float>(10, 5000, 0.01, 0.5), 200.0f, "ms"),
+		std::make_unique<AudioParameterFloat>("Ratio", "Ratio",
+			NormalisableRange<float>(1, 20, 0.01), 4.0f),
+		std::make_unique<AudioParameterFloat>("OutputGain", "Makeup Gain",
+			NormalisableRange<float>(0, 40, 0.01), 0.0f, "dB"),
+		std::make_unique<AudioParameterFloat>("KneeWidth", "Knee Width",
+			NormalisableRange<float>(0, 20, 0.01), 0.0f, "dB"),
+		std::make_unique<AudioParameterChoice>("StereoLink", "Stereo Link",
+			StringArray { "Off", "Max", "Mean", "Sum" }, 1),
+		std::make_unique<AudioParameterChoice>("Oversampling", "Oversampling",
+			StringArray { "Off", "2x", "4x" }, 0),
+		std::make_unique<AudioParameterFloat>("Lookahead", "Lookahead",
+			NormalisableRange<float>(0, CompressorEngine::MAX_LOOKAHEAD_MSEC, 0.1), 0.0f, "ms"),
+		std::make_unique<AudioParameterChoice>("Bands", "Bands",
+			StringArray { "Off", "3 Bands", "4 Bands" }, 0),
+		std::make_unique<AudioParameterFloat>("LowCrossover", "Low Crossover",
+			NormalisableRange<float>(20, 500, 1, 0.5), 200.0f, "Hz"),
+		std::make_unique<AudioParameterFloat>("MidCrossover", "Mid Crossover",
+			NormalisableRange<float>(500, 4000, 1, 0.5), 1500.0f, "Hz"),
+		std::make_unique<AudioParameterFloat>("HighCrossover", "High Crossover",
+			NormalisableRange<float>(4000, 16000, 1, 0.5), 6000.0f, "Hz"),
+		std::make_unique<AudioParameterBool>("ExternalKey", "External Sidechain", false),
+		std::make_unique<AudioParameterFloat>("KeyHighPass", "Key High-Pass",
+			NormalisableRange<float>(CompressorEngine::KEY_HIGH_PASS_OFF_HZ, 2000, 1, 0.5), CompressorEngine::KEY_HIGH_PASS_OFF_HZ, String(),
+			AudioProcessorParameter::genericParameter,
+			[](float fValue, int) { return fValue <= CompressorEngine::KEY_HIGH_PASS_OFF_HZ ? String("Off") : String(roundToInt(fValue)) + " Hz"; },
+			[](const String& text) { return text.startsWithIgnoreCase("off") ? CompressorEngine::KEY_HIGH_PASS_OFF_HZ : text.getFloatValue(); }),
+		std::make_unique<AudioParameterBool>("AutoRelease", "Auto Release", false),
+		std::make_unique<AudioParameterFloat>("Mix", "Mix",
+			NormalisableRange<float>(0, 100, 0.1), 100.0f, "%"));
+	return layout;
 }
 
 //==============================================================================
@@ -72,87 +144,86 @@ double CompreezorAudioProcessor::getTailLengthSeconds() const
 
 int CompreezorAudioProcessor::getNumPrograms()
 {
-	return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-				// so this should be at least 1, even if you're not really implementing programs.
+	// NB: some hosts don't cope very well if you tell them there are 0 programs,
+	// so this should be at least 1, even if you're not really implementing programs.
+	return jmax(1, m_Presets->getNames().size());
 }
 
 int CompreezorAudioProcessor::getCurrentProgram()
 {
-	return 0;
+	return m_nCurrentPreset;
 }
 
 void CompreezorAudioProcessor::setCurrentProgram(int index)
 {
+	loadPreset(index);
 }
 
 const String CompreezorAudioProcessor::getProgramName(int index)
 {
-	return {};
+	const StringArray names = m_Presets->getNames();
+	return isPositiveAndBelow(index, names.size()) ? names[index] : String("Default");
 }
 
 void CompreezorAudioProcessor::changeProgramName(int index, const String& newName)
 {
 }
 
-float CompreezorAudioProcessor::calcCompressorGain(float fDetectorValue, float fThreshold,
-	float fRatio, float fKneeWidth, bool bLimit)
-{
-	// slope variable
-	float CS = 1.0 - 1.0 / fRatio; // [ Eq. 13.1 ]
-								   // limiting is infinite ratio thus CS->1.0
-								   //if (bLimit)
-								   //CS = 1;
-
-								   // soft-knee with detection value in range?
-	if (fKneeWidth > 0 && fDetectorValue > (fThreshold - fKneeWidth / 2.0) &&
-		fDetectorValue < fThreshold + fKneeWidth / 2.0)
-	{
-		// setup for Lagrange
-		double x[2];
-		double y[2];
-		x[0] = fThreshold - fKneeWidth / 2.0;
-		x[1] = fThreshold + fKneeWidth / 2.0;
-		x[1] = min(0, x[1]); // top limit is 0dBFS
-		y[0] = 0; // CS = 0 for 1:1 ratio
-		y[1] = CS; // current CS
-
-				   // interpolate & overwrite CS
-		CS = lagrpol(&x[0], &y[0], 2, fDetectorValue);
-	}
-	// compute gain; threshold and detection values are in dB
-	float yG = CS * (fThreshold - fDetectorValue); // [ Eq. 13.1 ]
-												   // clamp; this allows ratios of 1:1 to still operate
-	yG = min(0, yG);
-
-	// convert back to linear
-	return pow(10.0, yG / 20.0);
-}
 
 //==============================================================================
 void CompreezorAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
 	// Use this method as the place to do any pre-playback
 	// initialisation that you need..
-	// init the envelope detectors
-	// set all params at once with this function; see function definition
+	// the engine sets up everything per channel for the main bus and never goes beyond it
+	m_Engine.prepare(sampleRate, samplesPerBlock, getMainBusNumInputChannels(), getEngineParameters());
+	setLatencySamples(m_Engine.getLatencySamples());
+
+	const int nMaxBlockSize = m_Engine.getMaxBlockSize();
+	m_CaptureBuffer.setSize(m_Engine.getNumChannels(), nMaxBlockSize);
+	m_PreviewBuffer.setSize(2, nMaxBlockSize);
+	const SpinLock::ScopedLockType previewLock(m_PreviewLock);
+	if (m_Preview != nullptr)
+		m_Preview->prepareToPlay(nMaxBlockSize, sampleRate);
+}
 
-	
+CompressorEngine::Parameters CompreezorAudioProcessor::getEngineParameters() const
+{
+	CompressorEngine::Parameters params;
+	params.detGain = *m_pDetGain;
+	params.threshold = *m_pThreshold;
+	params.attackTime = *m_pAttackTime;
+	params.releaseTime = *m_pReleaseTime;
+	params.ratio = *m_pRatio;
+	params.outputGain = *m_pOutputGain;
+	params.kneeWidth = *m_pKneeWidth;
+	params.stereoLink = roundToInt(*m_pStereoLink);
+	params.oversampling = roundToInt(*m_pOversampling);
+	params.lookahead = *m_pLookahead;
+	params.bands = roundToInt(*m_pBands);
+	params.lowCrossover = *m_pLowCrossover;
+	params.midCrossover = *m_pMidCrossover;
+	params.highCrossover = *m_pHighCrossover;
+	params.externalKey = *m_pExternalKey > 0.5f;
+	params.keyHighPass = *m_pKeyHighPass;
+	params.autoRelease = *m_pAutoRelease > 0.5f;
+	params.mix = *m_pMix;
+	return params;
+}
 
-	if (DigitalAnalogue == true) //Digit
-	{
-		m_LeftDetector.init((float)getSampleRate(), AttackTime = 0.0, ReleaseTime,
-			false, DETECT_MODE_RMS, true);
-		m_RightDetector.init((float)getSampleRate(), AttackTime,
-			ReleaseTime, false, DETECT_MODE_RMS, true);
-	}
-	else
-	{
-		m_LeftDetector.init((float)getSampleRate(), AttackTime = 0.0, ReleaseTime,
-			true, DETECT_MODE_RMS, true);
-		m_RightDetector.init((float)getSampleRate(), AttackTime,
-			ReleaseTime, true, DETECT_MODE_RMS, true);
-	}
+CompressorEngine::Parameters CompreezorAudioProcessor::getStemParameters(const File& stemFile)
+{
+	// a preset that is still being parsed counts as missing; the current values it is
+	// applied over fill in what it doesn't have, as applyPreset() does
+	const CompressorEngine::Parameters current = getEngineParameters();
+	const int index = getPresetNames().indexOf(stemFile.getFileNameWithoutExtension(), true);
+	const ValueTree preset = index >= 0 ? m_Presets->getPreset(index) : ValueTree();
+	return preset.isValid() ? CompressorEngine::Parameters::fromState(preset, current) : current;
+}
 
+void CompreezorAudioProcessor::handleAsyncUpdate()
+{
+	setLatencySamples(m_Engine.getLatencySamples());
 }
 
 void CompreezorAudioProcessor::releaseResources()
@@ -168,16 +239,23 @@ bool CompreezorAudioProcessor::isBusesLayoutSupported(const BusesLayout& layouts
 	ignoreUnused(layouts);
 	return true;
 #else
-	// This is the place where you check if the layout is supported.
-	// In this template code we only support mono or stereo.
-	if (layouts.getMainOutputChannelSet() != AudioChannelSet::mono()
-		&& layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
+	// any layout up to MAX_CHANNELS, from mono to 7.1.4 and beyond
+	const AudioChannelSet main = layouts.getMainOutputChannelSet();
+	if (main.isDisabled() || main.size() > MAX_CHANNELS)
 		return false;
 
 	// This checks if the input layout matches the output layout
 #if ! JucePlugin_IsSynth
 	if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
 		return false;
+
+	// the sidechain is optional, mono or stereo whatever the main layout
+	if (layouts.inputBuses.size() > 1)
+	{
+		const AudioChannelSet key = layouts.getChannelSet(true, 1);
+		if (!key.isDisabled() && key != AudioChannelSet::mono() && key != AudioChannelSet::stereo())
+			return false;
+	}
 #endif
 
 	return true;
@@ -185,13 +263,67 @@ bool CompreezorAudioProcessor::isBusesLayoutSupported(const BusesLayout& layouts
 }
 #endif
 
+namespace
+{
+	// the stem preview is float; these mix it into either sample type
+	inline void addSamples(float* pSamples, const float* pSource, int numSamples)
+	{
+		FloatVectorOperations::add(pSamples, pSource, numSamples);
+	}
+
+	inline void addSamples(double* pSamples, const float* pSource, int numSamples)
+	{
+		for (int i = 0; i < numSamples; ++i)
+			pSamples[i] += pSource[i];
+	}
+
+	template <typename DestType, typename SourceType>
+	inline void copySamples(DestType* pDest, const SourceType* pSource, int numSamples)
+	{
+		for (int i = 0; i < numSamples; ++i)
+			pDest[i] = (DestType)pSource[i];
+	}
+}
+
 void CompreezorAudioProcessor::processBlock(AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
+{
+	const RealtimeMonitor::ScopedBlock monitorBlock(m_Monitor, buffer.getNumSamples(), getSampleRate());
+	process(buffer);
+}
+
+void CompreezorAudioProcessor::processBlock(AudioBuffer<double>& buffer, MidiBuffer& midiMessages)
+{
+	const RealtimeMonitor::ScopedBlock monitorBlock(m_Monitor, buffer.getNumSamples(), getSampleRate());
+	process(buffer);
+}
+
+void CompreezorAudioProcessor::processBlockBypassed(AudioSampleBuffer& buffer, MidiBuffer&)
+{
+	bypass(buffer);
+}
+
+void CompreezorAudioProcessor::processBlockBypassed(AudioBuffer<double>& buffer, MidiBuffer&)
+{
+	bypass(buffer);
+}
+
+
+template <typename SampleType>
+void CompreezorAudioProcessor::bypass(AudioBuffer<SampleType>& buffer)
+{
+	AudioBuffer<SampleType> mainBus = getBusBuffer(buffer, true, 0);
+	m_Engine.processBypassed(mainBus);
+
+	for (int i = getTotalNumInputChannels(); i < getTotalNumOutputChannels(); ++i)
+		buffer.clear(i, 0, buffer.getNumSamples());
+}
+
+template <typename SampleType>
+void CompreezorAudioProcessor::process(AudioBuffer<SampleType>& buffer)
 {
 	ScopedNoDenormals noDenormals;
 	const int totalNumInputChannels = getTotalNumInputChannels();
 	const int totalNumOutputChannels = getTotalNumOutputChannels();
-	float fInputGain = pow(10.0, DetGain / 20.0);
-	float fOutputGain = pow(10.0, OutputGain / 20.0);
 
 	// In case we have more outputs than inputs, this code clears any output
 	// channels that didn't contain input data, (because these aren't
@@ -202,29 +334,161 @@ void CompreezorAudioProcessor::processBlock(AudioSampleBuffer& buffer, MidiBuffe
 	for (int i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
 		buffer.clear(i, 0, buffer.getNumSamples());
 
-	// This is the place where you'd normally do the guts of your plugin's
-	// audio processing...
-	for (int channel = 0; channel < totalNumInputChannels; ++channel)
+	// the parameters once per block, then the main bus through the compressor, keyed by the
+	// sidechain bus when the host has enabled it
+	m_Engine.setParameters(getEngineParameters());
+
+	AudioBuffer<SampleType> mainBus = getBusBuffer(buffer, true, 0);
+	const AudioBuffer<SampleType> keyBus = getBusCount(true) > 1 && getChannelCountOfBus(true, 1) > 0
+		? getBusBuffer(buffer, true, 1) : AudioBuffer<SampleType>();
+	m_Engine.process(mainBus, keyBus);
+
+	// oversampling and lookahead move the latency; the host hears of it from the message thread
+	if (m_Engine.getLatencySamples() != getLatencySamples())
+		triggerAsyncUpdate();
+
+	const int numSamples = buffer.getNumSamples();
+	const int numChannels = jmin(getMainBusNumInputChannels(), m_Engine.getNumChannels());
+	const int chunkSize = m_Engine.getMaxBlockSize();
+
+	// the capture gets the processed block; while startCapture()/stopCapture() swap the
+	// uploader the lock is taken and that block simply isn't captured
+	if (numChannels > 0)
 	{
-		float* channelData = buffer.getWritePointer(channel);
-		for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
-		{       // ..do something to the data...			    
-
-			channelData[sample] = channelData[sample] * DetGain;
-			// detect left channel
-			float fLeftDetector = m_LeftDetector.detect(channelData[sample]);
-			// gain calc
-			float fGn;
-			// branch
-			//if (m_uProcessorType == COMP) //always true for this project
-			fGn = calcCompressorGain(fLeftDetector, Threshold, Ratio,
-				KneeWidth, false);
-			// form output and apply make up gain
-			channelData[sample] = fGn*channelData[sample] * OutputGain;
+		const SpinLock::ScopedTryLockType captureLock(m_CaptureLock);
+		if (captureLock.isLocked() && m_Capture != nullptr)
+			pushCapture(buffer, numChannels);
+	}
+
+	// the stem preview is mixed in last, it isn't compressed or captured
+	const SpinLock::ScopedTryLockType previewLock(m_PreviewLock);
+	if (previewLock.isLocked() && m_Preview != nullptr && numChannels > 0 && chunkSize > 0)
+	{
+		for (int start = 0; start < numSamples; start += chunkSize)
+		{
+			const int n = jmin(numSamples - start, chunkSize);
+			m_Preview->getNextAudioBlock(AudioSourceChannelInfo(&m_PreviewBuffer, 0, n));
+			for (int channel = 0; channel < jmin(numChannels, 2); ++channel)
+				addSamples(buffer.getWritePointer(channel, start), m_PreviewBuffer.getReadPointer(channel), n);
 		}
 	}
 }
 
+void CompreezorAudioProcessor::pushCapture(const AudioBuffer<float>& buffer, int numChannels)
+{
+	m_Capture->push(buffer.getArrayOfReadPointers(), numChannels, buffer.getNumSamples());
+}
+
+void CompreezorAudioProcessor::pushCapture(const AudioBuffer<double>& buffer, int numChannels)
+{
+	// the FLAC encoder takes float; converted a chunk at a time in the scratch buffer
+	const int nMaxBlockSize = m_Engine.getMaxBlockSize();
+	for (int start = 0; start < buffer.getNumSamples(); start += nMaxBlockSize)
+	{
+		const int n = jmin(buffer.getNumSamples() - start, nMaxBlockSize);
+		for (int channel = 0; channel < numChannels; ++channel)
+			copySamples(m_CaptureBuffer.getWritePointer(channel), buffer.getReadPointer(channel, start), n);
+
+		m_Capture->push(m_CaptureBuffer.getArrayOfReadPointers(), numChannels, n);
+	}
+}
+
+bool CompreezorAudioProcessor::startPreview(const File& stemFile)
+{
+	stopPreview();
+
+	// only WAV and AIFF can be memory-mapped
+	std::unique_ptr<MemoryMappedAudioFormatReader> reader;
+	if (stemFile.hasFileExtension("wav"))
+		reader.reset(WavAudioFormat().createMemoryMappedReader(stemFile));
+	else if (stemFile.hasFileExtension("aif;aiff"))
+		reader.reset(AiffAudioFormat().createMemoryMappedReader(stemFile));
+
+	if (reader == nullptr || !reader->mapEntireFile())
+		return false;
+
+	// mapping doesn't read anything in; touch every page here, so the audio thread never
+	// faults on a stem that isn't in the OS cache yet
+	const int bytesPerFrame = jmax(1, (int)reader->numChannels * (int)reader->bitsPerSample / 8);
+	const int64 samplesPerPage = jmax(1, PREVIEW_PAGE_BYTES / bytesPerFrame);
+	for (int64 sample = 0; sample < reader->lengthInSamples; sample += samplesPerPage)
+		reader->touchSample(sample);
+	if (reader->lengthInSamples > 0)
+		reader->touchSample(reader->lengthInSamples - 1);
+
+	const double fileSampleRate = reader->sampleRate;
+	std::unique_ptr<AudioFormatReaderSource> source(new AudioFormatReaderSource(reader.release(), true));
+	std::unique_ptr<AudioTransportSource> transport(new AudioTransportSource());
+
+	// the transport resamples to the session rate; no read-ahead thread, the file is in memory
+	// and paged in
+	transport->setSource(source.get(), 0, nullptr, fileSampleRate, 2);
+	transport->prepareToPlay(jmax(1, m_Engine.getMaxBlockSize()), getSampleRate() > 0 ? getSampleRate() : m_Engine.getSampleRate());
+	transport->start();
+
+	const SpinLock::ScopedLockType previewLock(m_PreviewLock);
+	m_PreviewSource = std::move(source);
+	m_Preview = std::move(transport);
+	return true;
+}
+
+void CompreezorAudioProcessor::stopPreview()
+{
+	std::unique_ptr<AudioTransportSource> transport;
+	std::unique_ptr<AudioFormatReaderSource> source;
+	{
+		const SpinLock::ScopedLockType previewLock(m_PreviewLock);
+		transport = std::move(m_Preview);
+		source = std::move(m_PreviewSource);
+	}
+
+	if (transport != nullptr)
+		transport->setSource(nullptr);
+}
+
+void CompreezorAudioProcessor::startCapture(const String& hostName)
+{
+	stopCapture();
+
+	const double sampleRate = getSampleRate() > 0 ? getSampleRate() : m_Engine.getSampleRate();
+	std::unique_ptr<CaptureUploader> capture(new CaptureUploader(hostName, sampleRate,
+		jlimit(1, 2, getTotalNumOutputChannels())));
+	capture->start();
+
+	const SpinLock::ScopedLockType captureLock(m_CaptureLock);
+	m_Capture = std::move(capture);
+}
+
+void CompreezorAudioProcessor::stopCapture()
+{
+	std::unique_ptr<CaptureUploader> capture;
+	{
+		const SpinLock::ScopedLockType captureLock(m_CaptureLock);
+		capture = std::move(m_Capture);
+	}
+
+	if (capture != nullptr)
+	{
+		// it finishes its upload on its own thread; deleting it before that would block the
+		// message thread, so timerCallback() deletes it once it is done
+		capture->stop();
+		m_FinishingCaptures.push_back(std::move(capture));
+		startTimer(CAPTURE_CLEANUP_INTERVAL_MS);
+	}
+}
+
+void CompreezorAudioProcessor::timerCallback()
+{
+	m_FinishingCaptures.erase(std::remove_if(m_FinishingCaptures.begin(), m_FinishingCaptures.end(),
+		[](const std::unique_ptr<CaptureUploader>& capture) { return capture->isFinished(); }),
+		m_FinishingCaptures.end());
+
+	if (m_FinishingCaptures.empty())
+		stopTimer();
+}
+
+
+
 //==============================================================================
 bool CompreezorAudioProcessor::hasEditor() const
 {
@@ -239,15 +503,127 @@ AudioProcessorEditor* CompreezorAudioProcessor::createEditor()
 //==============================================================================
 void CompreezorAudioProcessor::getStateInformation(MemoryBlock& destData)
 {
-	// You should use this method to store your parameters in the memory block.
-	// You could do that either as raw data, or use the XML or ValueTree classes
-	// as intermediaries to make it easy to save and load complex data.
+	// the parameter tree holds every control, the Split settings and the job list
+	ValueTree state = parameters.copyState();
+	state.setProperty("UploadAsFlac", UploadAsFlac, nullptr);
+
+	ValueTree jobs = m_SplitJobs.toValueTree();
+	state.removeChild(state.getChildWithName(jobs.getType()), nullptr);
+	state.appendChild(jobs, nullptr);
+
+	// binary, not XML: no text to format or parse, so sessions with many instances load fast
+	destData.reset();
+	MemoryOutputStream stream(destData, false);
+	stream.writeInt(STATE_MAGIC);
+	stream.writeInt(STATE_VERSION);
+	state.writeToStream(stream);
 }
 
 void CompreezorAudioProcessor::setStateInformation(const void* data, int sizeInBytes)
 {
-	// You should use this method to restore your parameters from this memory block,
-	// whose contents will have been created by the getStateInformation() call.
+	ValueTree state;
+
+	MemoryInputStream stream(data, (size_t)jmax(0, sizeInBytes), false);
+	if (sizeInBytes >= 8 && stream.readInt() == STATE_MAGIC)
+	{
+		// versions only ever add properties, which an older build simply ignores
+		stream.readInt();
+		state = ValueTree::readFromStream(stream);
+	}
+	else
+	{
+		std::unique_ptr<XmlElement> xml(getXmlFromBinary(data, sizeInBytes));
+		if (xml != nullptr)
+			state = ValueTree::fromXml(*xml);
+	}
+
+	if (state.hasType(parameters.state.getType()))
+	{
+		parameters.replaceState(state);
+
+		UploadAsFlac = parameters.state.getProperty("UploadAsFlac", true);
+		m_SplitJobs.restore(parameters.state.getChildWithName("SPLITJOBS"), getSplitServer(), UploadAsFlac);
+	}
+}
+
+void CompreezorAudioProcessor::loadPreset(int index)
+{
+	const StringArray names = m_Presets->getNames();
+	if (!isPositiveAndBelow(index, names.size()))
+		return;
+
+	m_nCurrentPreset = index;
+
+	const ValueTree preset = m_Presets->getPreset(index);
+	if (preset.isValid())
+	{
+		m_PendingPreset.clear();
+		applyPreset(preset);
+	}
+	else
+	{
+		m_PendingPreset = names[index];
+	}
+}
+
+bool CompreezorAudioProcessor::savePreset(const String& name)
+{
+	if (!m_Presets->savePreset(name, createPreset()))
+		return false;
+
+	m_nCurrentPreset = jmax(0, m_Presets->getNames().indexOf(File::createLegalFileName(name)));
+	return true;
+}
+
+ValueTree CompreezorAudioProcessor::createPreset()
+{
+	ValueTree preset("PRESET");
+	const ValueTree state = parameters.copyState();
+	for (int i = 0; i < state.getNumChildren(); ++i)
+		if (state.getChild(i).hasType("PARAM"))
+			preset.appendChild(state.getChild(i).createCopy(), nullptr);
+	return preset;
+}
+
+void CompreezorAudioProcessor::applyPreset(const ValueTree& preset)
+{
+	for (int i = 0; i < preset.getNumChildren(); ++i)
+	{
+		const ValueTree param = preset.getChild(i);
+		if (RangedAudioParameter* parameter = parameters.getParameter(param["id"].toString()))
+			parameter->setValueNotifyingHost(parameter->convertTo0to1((float)param["value"]));
+	}
+}
+
+void CompreezorAudioProcessor::changeListenerCallback(ChangeBroadcaster*)
+{
+	const StringArray names = m_Presets->getNames();
+
+	if (m_PendingPreset.isNotEmpty())
+	{
+		const int index = names.indexOf(m_PendingPreset);
+		if (index < 0)
+			m_PendingPreset.clear(); // gone from the folder meanwhile
+		else
+			loadPreset(index);
+	}
+
+	if (names.size() != m_nNumPresets)
+	{
+		m_nNumPresets = names.size();
+		m_nCurrentPreset = jmin(m_nCurrentPreset, jmax(0, m_nNumPresets - 1));
+		updateHostDisplay();
+	}
+}
+
+String CompreezorAudioProcessor::getSplitServer() const
+{
+	return parameters.state.getProperty("SplitServer", "http://127.0.0.1:5000").toString().trimCharactersAtEnd("/");
+}
+
+void CompreezorAudioProcessor::setSplitServer(const String& hostName)
+{
+	parameters.state.setProperty("SplitServer", hostName.trim().trimCharactersAtEnd("/"), nullptr);
 }
 
 //==============================================================================
@@ -256,3 +632,4 @@ AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
 	return new CompreezorAudioProcessor();
 }
+
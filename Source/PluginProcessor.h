@@ -12,12 +12,17 @@
 #pragma once
 
 #include "../JuceLibraryCode/JuceHeader.h"
-#include "EnvelopeDetector.h"
+#include "CompressorEngine.h"
+#include "SplitJobQueue.h"
+#include "RealtimeMonitor.h"
+#include "PresetBank.h"
+
+class CaptureUploader;
 
 //==============================================================================
 /**
 */
-class CompreezorAudioProcessor  : public AudioProcessor
+class CompreezorAudioProcessor  : public AudioProcessor, private AsyncUpdater, private ChangeListener, private Timer
 {
 public:
     //==============================================================================
@@ -32,6 +37,11 @@ public:
    #endif
 
     void processBlock (AudioSampleBuffer&, MidiBuffer&) override;
+    void processBlock (AudioBuffer<double>&, MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override { return true; }
+
+    void processBlockBypassed (AudioSampleBuffer&, MidiBuffer&) override;
+    void processBlockBypassed (AudioBuffer<double>&, MidiBuffer&) override;
 
     //==============================================================================
     AudioProcessorEditor* createEditor() override;
@@ -58,26 +68,141 @@ public:
 
 	bool GUIActive;
 
-	float DetGain=1;  //Input Gain in dB
-	float Threshold=0; //Compressor Threshold
-	float AttackTime=10; //Attack Time in Milliseconds
-	float ReleaseTime=200; //Release Time in Milliseconds
-	float Ratio=4; //Compression Ratio
-	float OutputGain=1; //Output Gain in dB
-	float KneeWidth=0; //Compressor Knee Width
-	bool DigitalAnalogue; //Digital/Analogue style compression
-
-
-	UINT DETECT_MODE_PEAK = 0;
-	UINT DETECT_MODE_MS = 1;
-	UINT DETECT_MODE_RMS = 2;
-
-	CEnvelopeDetector  m_LeftDetector;
-	CEnvelopeDetector m_RightDetector;
+	// the controls live here; the editor attaches to them and the audio thread reads
+	// them once per block, so neither side ever touches the other's state directly
+	//   DetGain     - Input Gain in dB
+	//   Threshold   - Compressor Threshold in dB
+	//   AttackTime  - Attack Time in Milliseconds
+	//   ReleaseTime - Release Time in Milliseconds
+	//   Ratio       - Compression Ratio
+	//   OutputGain  - Makeup Gain in dB
+	//   KneeWidth   - Compressor Knee Width in dB
+	//   StereoLink  - channel link mode (CompressorEngine::STEREO_LINK_*), over every channel of the layout
+	//   Oversampling - detector and gain stage rate: Off, 2x, 4x
+	//   Lookahead   - audio delay ahead of the detector in Milliseconds
+	//   Bands       - multiband mode: Off, 3 Bands, 4 Bands
+	//   LowCrossover, MidCrossover, HighCrossover - band split frequencies in Hz;
+	//                 3 bands split at Low and High, 4 bands at all three
+	//   ExternalKey - single band detection from the sidechain bus
+	//   KeyHighPass - detector input high-pass in Hz, Off at the bottom of the range
+	//   AutoRelease - program dependent release, short peaks let go faster
+	//   Mix         - compressed share of the output in %, the rest is the delayed dry signal
+	AudioProcessorValueTreeState parameters;
+
+	bool UploadAsFlac = true; //transcode uploads to FLAC on the way to the Split server
+
+	// main bus channels; any layout up to this many is accepted
+	static const int MAX_CHANNELS = CompressorEngine::MAX_CHANNELS;
+
+	// the compressor itself; its meters are what the editor shows, read on the editor's timer
+	CompressorEngine m_Engine;
+
+	// the current parameter values, as the engine takes them
+	CompressorEngine::Parameters getEngineParameters() const;
+	// what a stem is processed with: the preset named like the stem file (vocals.wav ->
+	// "Vocals"), otherwise the current values. message thread only
+	CompressorEngine::Parameters getStemParameters(const File& stemFile);
+
+	// processBlock timing against the block deadline, off until the editor enables it
+	RealtimeMonitor m_Monitor;
+
+	// records the processed output and streams it to the Split server at hostName while
+	// it plays; message thread only
+	void startCapture(const String& hostName);
+	void stopCapture();
+	bool isCapturing() const { return m_Capture != nullptr; }
+
+	// plays a separated stem into the output, after the compressor, for auditioning; the
+	// file is memory-mapped and paged in before it plays, so the audio thread never waits on
+	// the disk; that read is what a long stem waits for here. message thread only
+	bool startPreview(const File& stemFile);
+	void stopPreview();
+	bool isPreviewing() const { return m_Preview != nullptr; }
+
+	Array<File> StemFiles; // what the last split download extracted
+	String StemJobId; // the streaming split StemFiles follows, empty when none
+
+	// Split server endpoint, kept in the plugin state; without a trailing slash
+	String getSplitServer() const;
+	void setSplitServer(const String& hostName);
+
+	// queued upload -> separate -> download jobs; saved with the plugin state
+	SplitJobQueue m_SplitJobs;
+
+	// presets: the XML files of the PresetBank every instance shares; they are also the
+	// host's programs. message thread only
+	StringArray getPresetNames() { return m_Presets->getNames(); }
+	// applies the preset now if it is parsed already, otherwise as soon as the bank has it
+	void loadPreset(int index);
+	// the current parameter values as a preset called name
+	bool savePreset(const String& name);
 
 private:
+	static AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+
+	// both processBlock()s: the main bus through m_Engine, then the capture and the preview
+	template <typename SampleType>
+	void process(AudioBuffer<SampleType>& buffer);
+	// both processBlockBypassed()s: the engine's dry path, delayed by the reported latency
+	template <typename SampleType>
+	void bypass(AudioBuffer<SampleType>& buffer);
+
+	// reports the engine latency to the host from the message thread
+	void handleAsyncUpdate() override;
+
+	// the session state is this header followed by the ValueTree in its binary form;
+	// older sessions were XML (copyXmlToBinary) and still load
+	static const int STATE_MAGIC = 0x5a504d43; // "CMPZ"
+	static const int STATE_VERSION = 1;
+
+	// every parameter as <PARAM id value/>, the way the parameter tree stores them
+	ValueTree createPreset();
+	// sets the parameters a preset has through the host; the others keep their values
+	void applyPreset(const ValueTree& preset);
+	// a preset loadPreset() waited for has been parsed, or the preset list changed
+	void changeListenerCallback(ChangeBroadcaster* source) override;
+
+	SharedResourcePointer<PresetBank> m_Presets;
+	int m_nCurrentPreset = 0;
+	String m_PendingPreset; // name of the preset to apply once parsed
+	int m_nNumPresets = 0;  // what the host was last told
+
+	float* m_pDetGain;
+	float* m_pThreshold;
+	float* m_pAttackTime;
+	float* m_pReleaseTime;
+	float* m_pRatio;
+	float* m_pOutputGain;
+	float* m_pKneeWidth;
+	float* m_pStereoLink;
+	float* m_pOversampling;
+	float* m_pLookahead;
+	float* m_pBands;
+	float* m_pLowCrossover;
+	float* m_pMidCrossover;
+	float* m_pHighCrossover;
+	float* m_pExternalKey;
+	float* m_pKeyHighPass;
+	float* m_pAutoRelease;
+	float* m_pMix;
+
+	void pushCapture(const AudioBuffer<float>& buffer, int numChannels);
+	void pushCapture(const AudioBuffer<double>& buffer, int numChannels);
+	AudioSampleBuffer m_CaptureBuffer; // float copy of a double block for the capture
+	std::unique_ptr<CaptureUploader> m_Capture;          // fed by processBlock
+	std::vector<std::unique_ptr<CaptureUploader>> m_FinishingCaptures; // stopped, still uploading their tails
+	SpinLock m_CaptureLock; // the audio thread only ever tries it
+
+	// deletes the finishing captures that are done; runs while there are any
+	void timerCallback() override;
+	static const int CAPTURE_CLEANUP_INTERVAL_MS = 500;
+
+	std::unique_ptr<AudioFormatReaderSource> m_PreviewSource;
+	std::unique_ptr<AudioTransportSource> m_Preview;
+	AudioSampleBuffer m_PreviewBuffer;
+	SpinLock m_PreviewLock; // as m_CaptureLock
+	static const int PREVIEW_PAGE_BYTES = 4096; // the smallest page size startPreview() touches in
+
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CompreezorAudioProcessor)
-		float calcCompressorGain(float fDetectorValue, float fThreshold, float fRatio,
-			float fKneeWidth, bool bLimit);
 };
@@ -0,0 +1,176 @@
+/*
+==============================================================================
+
+PresetBank.cpp
+Author: Filipe Borato
+
+==============================================================================
+*/
+
+#include "PresetBank.h"
+
+namespace
+{
+	const Identifier PRESET_TYPE("PRESET");
+	const Identifier VERSION_PROPERTY("version");
+	const char* const PRESET_PATTERN = "*.xml";
+}
+
+PresetBank::PresetBank()
+	: Thread("Preset Bank")
+{
+}
+
+PresetBank::~PresetBank()
+{
+	stopThread(2000);
+}
+
+File PresetBank::getFolder()
+{
+	return File::getSpecialLocation(File::userApplicationDataDirectory)
+		.getChildFile("CompressorAndSplit").getChildFile("Presets");
+}
+
+StringArray PresetBank::getNames()
+{
+	const ScopedLock l(m_Lock);
+	if (!m_bScanned && !m_bScanRequested)
+	{
+		m_bScanRequested = true;
+		startThread();
+		notify();
+	}
+	return m_Names;
+}
+
+ValueTree PresetBank::getPreset(int index)
+{
+	const ScopedLock l(m_Lock);
+	if (!isPositiveAndBelow(index, m_Files.size()))
+		return {};
+
+	const File file = m_Files[index];
+	if (m_Cache.contains(file.getFullPathName()))
+		return m_Cache[file.getFullPathName()];
+
+	m_Pending.addIfNotAlreadyThere(file);
+	startThread();
+	notify();
+	return {};
+}
+
+bool PresetBank::savePreset(const String& name, const ValueTree& preset)
+{
+	const File file = getFolder().getChildFile(File::createLegalFileName(name) + ".xml");
+	if (!file.getParentDirectory().createDirectory())
+		return false;
+
+	ValueTree tree = preset.createCopy();
+	tree.setProperty(VERSION_PROPERTY, PRESET_VERSION, nullptr);
+
+	std::unique_ptr<XmlElement> xml(tree.createXml());
+	if (xml == nullptr || !xml->writeToFile(file, {}))
+		return false;
+
+	{
+		const ScopedLock l(m_Lock);
+		m_Cache.set(file.getFullPathName(), tree);
+
+		if (!m_Files.contains(file))
+		{
+			// keep the index in name order without a rescan
+			int index = 0;
+			while (index < m_Names.size() && m_Names[index].compareNatural(file.getFileNameWithoutExtension()) < 0)
+				++index;
+
+			m_Files.insert(index, file);
+			m_Names.insert(index, file.getFileNameWithoutExtension());
+		}
+	}
+
+	sendChangeMessage();
+	return true;
+}
+
+void PresetBank::refresh()
+{
+	const ScopedLock l(m_Lock);
+	m_bScanRequested = true;
+	startThread();
+	notify();
+}
+
+void PresetBank::run()
+{
+	while (!threadShouldExit())
+	{
+		bool bScan;
+		{
+			const ScopedLock l(m_Lock);
+			bScan = m_bScanRequested;
+			m_bScanRequested = false;
+		}
+
+		if (bScan)
+		{
+			scan();
+			sendChangeMessage();
+			continue;
+		}
+
+		// one preset at a time, so a scan that comes in meanwhile isn't held up
+		File file;
+		{
+			const ScopedLock l(m_Lock);
+			if (m_Pending.size() > 0)
+				file = m_Pending.removeAndReturn(0);
+		}
+
+		if (file == File())
+		{
+			wait(-1);
+			continue;
+		}
+
+		ValueTree preset;
+		std::unique_ptr<XmlElement> xml(XmlDocument::parse(file));
+		if (xml != nullptr && xml->hasTagName(PRESET_TYPE.toString()))
+			preset = ValueTree::fromXml(*xml);
+
+		// an unreadable file is cached as an empty preset, so it isn't parsed again
+		{
+			const ScopedLock l(m_Lock);
+			m_Cache.set(file.getFullPathName(), preset.isValid() ? preset : ValueTree(PRESET_TYPE));
+		}
+
+		sendChangeMessage();
+	}
+}
+
+void PresetBank::scan()
+{
+	Array<File> files = getFolder().findChildFiles(File::findFiles, false, PRESET_PATTERN);
+
+	struct NameOrder
+	{
+		static int compareElements(const File& first, const File& second)
+		{
+			return first.getFileNameWithoutExtension().compareNatural(second.getFileNameWithoutExtension());
+		}
+	};
+	NameOrder order;
+	files.sort(order);
+
+	StringArray names;
+	for (const File& file : files)
+		names.add(file.getFileNameWithoutExtension());
+
+	const ScopedLock l(m_Lock);
+	m_Files.swapWith(files);
+	m_Names.swapWith(names);
+	m_bScanned = true;
+
+	// presets edited on disk since are parsed again when next asked for
+	m_Cache.clear();
+}
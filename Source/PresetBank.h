@@ -0,0 +1,57 @@
+/*
+==============================================================================
+
+PresetBank.h
+Author: Filipe Borato
+
+==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+// The user's presets: one human-readable XML file each in the preset folder,
+//   <PRESET version="1"><PARAM id="Threshold" value="-18"/>...</PRESET>
+//
+// Shared by every instance through a SharedResourcePointer, so a session with hundreds
+// of instances scans the folder once. Nothing touches the disk until the index is first
+// asked for; the scan and the parsing run on the bank's thread, and a preset is parsed
+// the first time it is wanted and then kept. Callers only ever get the index or an
+// already parsed preset, so switching presets never waits on the disk. A change message
+// goes out whenever the index changes or a requested preset becomes available.
+class PresetBank : public ChangeBroadcaster, private Thread
+{
+public:
+	static const int PRESET_VERSION = 1;
+
+	PresetBank();
+	~PresetBank();
+
+	static File getFolder();
+
+	// the preset names, sorted; empty until the first scan is done (which this starts)
+	StringArray getNames();
+
+	// the parsed preset, or an invalid tree while it is loaded in the background
+	ValueTree getPreset(int index);
+
+	// writes preset as name.xml, replacing one with the same name; message thread
+	bool savePreset(const String& name, const ValueTree& preset);
+
+	// scan the folder again, e.g. after presets were copied in
+	void refresh();
+
+private:
+	void run() override;
+	void scan();
+
+	CriticalSection m_Lock;
+	Array<File> m_Files; // the index, in name order
+	StringArray m_Names;
+	HashMap<String, ValueTree> m_Cache; // parsed presets by full path
+	Array<File> m_Pending;               // wanted, not parsed yet
+	bool m_bScanned = false;
+	bool m_bScanRequested = false;
+
+	JUCE_DECLARE_NON_COPYABLE(PresetBank)
+};
@@ -0,0 +1,147 @@
+/*
+==============================================================================
+
+RealtimeMonitor.cpp
+Author: Filipe Borato
+
+==============================================================================
+*/
+
+#include "RealtimeMonitor.h"
+
+#if JUCE_DEBUG && COMPREEZOR_TRAP_AUDIO_THREAD_ALLOCATIONS
+namespace
+{
+	thread_local bool t_bInProcessBlock = false;
+	std::atomic<uint32> g_nAudioThreadAllocations { 0 };
+
+	void* allocate(std::size_t size)
+	{
+		if (t_bInProcessBlock)
+		{
+			++g_nAudioThreadAllocations;
+
+			// the assertion logs, and logging allocates
+			t_bInProcessBlock = false;
+			jassertfalse; // heap allocation on the audio thread
+			t_bInProcessBlock = true;
+		}
+
+		if (void* pMemory = std::malloc(size == 0 ? 1 : size))
+			return pMemory;
+
+		throw std::bad_alloc();
+	}
+}
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void operator delete(void* pMemory) noexcept { std::free(pMemory); }
+void operator delete[](void* pMemory) noexcept { std::free(pMemory); }
+void operator delete(void* pMemory, std::size_t) noexcept { std::free(pMemory); }
+void operator delete[](void* pMemory, std::size_t) noexcept { std::free(pMemory); }
+#endif
+
+RealtimeMonitor::RealtimeMonitor()
+{
+	reset();
+}
+
+void RealtimeMonitor::setEnabled(bool shouldBeEnabled)
+{
+	if (shouldBeEnabled && !isEnabled())
+		reset();
+
+	m_bEnabled.store(shouldBeEnabled);
+}
+
+void RealtimeMonitor::reset()
+{
+	m_nBlocks = 0;
+	m_nOverruns = 0;
+	m_fWorstLoad = 0;
+	for (std::atomic<uint32>& bin : m_LoadBins)
+		bin = 0;
+}
+
+RealtimeMonitor::ScopedBlock::ScopedBlock(RealtimeMonitor& monitor, int numSamples, double sampleRate)
+	: m_Monitor(monitor)
+	, m_nStartTicks(0)
+	, m_dDeadlineSeconds(sampleRate > 0 ? numSamples / sampleRate : 0)
+{
+#if JUCE_DEBUG && COMPREEZOR_TRAP_AUDIO_THREAD_ALLOCATIONS
+	t_bInProcessBlock = true;
+#endif
+
+	if (m_Monitor.isEnabled())
+		m_nStartTicks = Time::getHighResolutionTicks();
+}
+
+RealtimeMonitor::ScopedBlock::~ScopedBlock()
+{
+#if JUCE_DEBUG && COMPREEZOR_TRAP_AUDIO_THREAD_ALLOCATIONS
+	t_bInProcessBlock = false;
+#endif
+
+	if (m_nStartTicks != 0 && m_dDeadlineSeconds > 0)
+		m_Monitor.addBlock(Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - m_nStartTicks)
+			/ m_dDeadlineSeconds);
+}
+
+void RealtimeMonitor::addBlock(double loadRatio)
+{
+	const int bin = jmin(NUM_LOAD_BINS - 1, (int)(loadRatio * 100.0 / LOAD_BIN_PERCENT));
+	m_LoadBins[bin].fetch_add(1, std::memory_order_relaxed);
+	m_nBlocks.fetch_add(1, std::memory_order_relaxed);
+
+	if (loadRatio > 1.0)
+		m_nOverruns.fetch_add(1, std::memory_order_relaxed);
+
+	// single writer, so a plain compare is enough
+	if ((float)loadRatio > m_fWorstLoad.load(std::memory_order_relaxed))
+		m_fWorstLoad.store((float)loadRatio, std::memory_order_relaxed);
+}
+
+String RealtimeMonitor::getReport() const
+{
+	const uint32 numBlocks = m_nBlocks.load();
+	const uint32 numOverruns = m_nOverruns.load();
+
+	String report;
+	report << "Blocks: " << (int)numBlocks << newLine
+		<< "Overruns: " << (int)numOverruns;
+	if (numBlocks > 0)
+		report << " (" << String(100.0 * numOverruns / numBlocks, 3) << "%)";
+	report << newLine
+		<< "Worst block: " << String(100.0 * m_fWorstLoad.load(), 1) << "% of its deadline" << newLine;
+
+#if JUCE_DEBUG && COMPREEZOR_TRAP_AUDIO_THREAD_ALLOCATIONS
+	report << "Audio thread allocations: " << (int)getNumAudioThreadAllocations() << newLine;
+#endif
+
+	report << newLine << "Deadline load:" << newLine;
+	for (int bin = 0; bin < NUM_LOAD_BINS; ++bin)
+	{
+		const String range = bin == NUM_LOAD_BINS - 1
+			? String(bin * LOAD_BIN_PERCENT) + "%+"
+			: String(bin * LOAD_BIN_PERCENT) + "-" + String((bin + 1) * LOAD_BIN_PERCENT) + "%";
+		report << range.paddedLeft(' ', 9) << "  " << (int)m_LoadBins[bin].load() << newLine;
+	}
+
+	return report;
+}
+
+bool RealtimeMonitor::dumpReport(const File& file) const
+{
+	return file.replaceWithText("processBlock timing, " + Time::getCurrentTime().toString(true, true)
+		+ newLine + newLine + getReport());
+}
+
+uint32 RealtimeMonitor::getNumAudioThreadAllocations()
+{
+#if JUCE_DEBUG && COMPREEZOR_TRAP_AUDIO_THREAD_ALLOCATIONS
+	return g_nAudioThreadAllocations.load();
+#else
+	return 0;
+#endif
+}
@@ -0,0 +1,71 @@
+/*
+==============================================================================
+
+RealtimeMonitor.h
+Author: Filipe Borato
+
+==============================================================================
+*/
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+// debug builds only: replaces the global operator new/delete so that any heap allocation
+// made inside processBlock is counted and asserts. Off by default, it applies to the
+// whole plugin binary
+#ifndef COMPREEZOR_TRAP_AUDIO_THREAD_ALLOCATIONS
+#define COMPREEZOR_TRAP_AUDIO_THREAD_ALLOCATIONS 0
+#endif
+
+// Opt-in timing of processBlock against its deadline (numSamples / sampleRate).
+//
+// While enabled, every block's wall time goes into a histogram of deadline load in
+// LOAD_BIN_PERCENT steps, with the overruns and the worst block counted separately. All
+// of it is atomics written by the audio thread; the editor reads getReport() whenever it
+// likes. Disabled, a block costs one relaxed load.
+class RealtimeMonitor
+{
+public:
+	static const int LOAD_BIN_PERCENT = 10;
+	static const int NUM_LOAD_BINS = 16; // the last one takes everything from 150%
+
+	RealtimeMonitor();
+
+	// resets the counts when switched on; any thread
+	void setEnabled(bool shouldBeEnabled);
+	bool isEnabled() const { return m_bEnabled.load(std::memory_order_relaxed); }
+	void reset();
+
+	// times the block it is declared in; also marks the audio thread for the allocation trap
+	class ScopedBlock
+	{
+	public:
+		ScopedBlock(RealtimeMonitor& monitor, int numSamples, double sampleRate);
+		~ScopedBlock();
+
+	private:
+		RealtimeMonitor& m_Monitor;
+		int64 m_nStartTicks;
+		double m_dDeadlineSeconds;
+
+		JUCE_DECLARE_NON_COPYABLE(ScopedBlock)
+	};
+
+	// counts, histogram and worst block as text; dumpReport() writes it to a file
+	String getReport() const;
+	bool dumpReport(const File& file) const;
+
+	// heap allocations caught inside processBlock since start-up; always 0 without the trap
+	static uint32 getNumAudioThreadAllocations();
+
+private:
+	void addBlock(double loadRatio);
+
+	std::atomic<bool> m_bEnabled { false };
+	std::atomic<uint32> m_nBlocks { 0 };
+	std::atomic<uint32> m_nOverruns { 0 };
+	std::atomic<float> m_fWorstLoad { 0 };
+	std::atomic<uint32> m_LoadBins[NUM_LOAD_BINS];
+
+	JUCE_DECLARE_NON_COPYABLE(RealtimeMonitor)
+};
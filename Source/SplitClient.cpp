@@ -0,0 +1,272 @@
+/*
+==============================================================================
+
+SplitClient.cpp
+Author: Filipe Borato
+
+==============================================================================
+*/
+
+#include "SplitClient.h"
+#include "ChunkedUploadStream.h"
+#include "SplitConnection.h"
+
+class SplitClient::ChunkJob : public ThreadPoolJob
+{
+public:
+	ChunkJob(SplitClient& owner, const String& upload_id, int64 offset, int num_bytes, int64 total_bytes)
+		: ThreadPoolJob("Upload chunk")
+		, owner_(owner)
+		, upload_id_(upload_id)
+		, offset_(offset)
+		, num_bytes_(num_bytes)
+		, total_bytes_(total_bytes)
+	{
+	}
+
+	JobStatus runJob() override
+	{
+		// read only while the chunk is being sent
+		MemoryBlock data;
+		FileInputStream stream(owner_.file_to_upload_);
+		if (stream.failedToOpen() || !stream.setPosition(offset_)
+			|| stream.readIntoMemoryBlock(data, num_bytes_) != (size_t)num_bytes_)
+		{
+			response_ = "Cannot read " + owner_.file_to_upload_.getFileName();
+			finished_ = true;
+			return jobHasFinished;
+		}
+
+		for (int attempt = 0; attempt <= MAX_RETRIES && !shouldExit(); ++attempt)
+		{
+			if (attempt > 0)
+				Thread::sleep(250 << attempt);
+
+			if (postChunk(owner_.host_name_, upload_id_, owner_.file_to_upload_.getFileName(), offset_, data,
+				total_bytes_, status_code_, response_, &ChunkJob::ProgressCallback, this))
+			{
+				succeeded_ = true;
+				owner_.bytes_sent_ += num_bytes_;
+				break;
+			}
+
+			DBG("chunk at " + String(offset_) + " failed (" + String(status_code_) + "), attempt " + String(attempt + 1));
+		}
+
+		finished_ = true;
+		return jobHasFinished;
+	}
+
+	static bool ProgressCallback(void* context, int bytesSent, int totalBytes)
+	{
+		ignoreUnused(bytesSent, totalBytes);
+		return !static_cast<ChunkJob*>(context)->shouldExit();
+	}
+
+	SplitClient& owner_;
+	String upload_id_;
+	int64 offset_;
+	int num_bytes_;
+	int64 total_bytes_;
+
+	std::atomic<bool> finished_ { false };
+	bool succeeded_ = false;
+	int status_code_ = 0;
+	String response_;
+};
+
+SplitClient::SplitClient(const File& file_to_upload, const String& host_name, bool encode_flac)
+	: file_to_upload_(file_to_upload)
+	, host_name_(host_name.trimCharactersAtEnd("/"))
+	, encode_flac_(encode_flac)
+{
+}
+
+void SplitClient::upload(std::function<bool()> should_exit, std::function<void(double)> progress)
+{
+	if (!should_exit)
+		should_exit = [] { return false; };
+	if (!progress)
+		progress = [](double) {};
+
+	if (!file_to_upload_.existsAsFile())
+	{
+		setResponse(0, "Upload file does not exist.");
+		return;
+	}
+
+	if (encode_flac_)
+	{
+		uploadEncoded(should_exit, progress);
+		return;
+	}
+
+	const int64 total_bytes = file_to_upload_.getSize();
+	const String upload_id = String::toHexString((file_to_upload_.getFullPathName() + String(total_bytes)
+		+ String(file_to_upload_.getLastModificationTime().toMilliseconds())).hashCode64());
+
+	// whole chunks the server already has are not sent again
+	const int64 resume_offset = jlimit((int64)0, total_bytes, queryResumeOffset(host_name_, upload_id));
+	const int64 first_chunk = resume_offset / CHUNK_SIZE;
+	bytes_sent_ = first_chunk * CHUNK_SIZE;
+
+	// the jobs only hold offsets until they run, and the pool runs MAX_CHUNKS_IN_FLIGHT at a time
+	ThreadPool pool(MAX_CHUNKS_IN_FLIGHT);
+	OwnedArray<ChunkJob> chunks;
+	for (int64 offset = first_chunk * CHUNK_SIZE; offset < total_bytes; offset += CHUNK_SIZE)
+	{
+		chunks.add(new ChunkJob(*this, upload_id, offset, (int)jmin((int64)CHUNK_SIZE, total_bytes - offset), total_bytes));
+		pool.addJob(chunks.getLast(), false);
+	}
+
+	for (;;)
+	{
+		int num_finished = 0;
+		ChunkJob* failed = nullptr;
+		for (ChunkJob* chunk : chunks)
+		{
+			if (chunk->finished_)
+			{
+				++num_finished;
+				if (!chunk->succeeded_ && failed == nullptr)
+					failed = chunk;
+			}
+		}
+
+		progress(total_bytes > 0 ? (double)bytes_sent_.load() / total_bytes : 1.0);
+
+		if (failed != nullptr)
+		{
+			pool.removeAllJobs(true, TIMEOUT_MS);
+			setResponse(failed->status_code_, "Chunk at byte " + String(failed->offset_) + " failed: " + failed->response_);
+			return;
+		}
+
+		if (num_finished == chunks.size())
+			break;
+
+		if (should_exit())
+		{
+			pool.removeAllJobs(true, TIMEOUT_MS);
+			setResponse(0, "Upload was canceled.");
+			return;
+		}
+
+		Thread::sleep(50);
+	}
+
+	// the server assembles the chunks and answers for the whole upload
+	String response_str;
+	const int status_code = postComplete(host_name_, upload_id, file_to_upload_.getFileName(), total_bytes, response_str);
+	setResponse(status_code, response_str);
+}
+
+bool SplitClient::postChunk(const String& host_name, const String& upload_id, const String& file_name,
+	int64 offset, const MemoryBlock& data, int64 total_bytes, int& status_code, String& response,
+	URL::OpenStreamProgressCallback* callback, void* context)
+{
+	const String headers = "Content-Type: application/octet-stream\r\n"
+		"X-Upload-Id: " + upload_id + "\r\n"
+		"X-Upload-Name: " + URL::addEscapeChars(file_name, false) + "\r\n"
+		"Content-Range: bytes " + String(offset) + "-" + String(offset + (int64)data.getSize() - 1) + "/"
+		+ (total_bytes >= 0 ? String(total_bytes) : String("*")) + "\r\n";
+
+	URL url = URL(host_name + "/upload/chunk").withPOSTData(data);
+	SharedResourcePointer<SplitConnection> connection;
+	std::unique_ptr<InputStream> input(connection->open(url, true, headers, &status_code, callback, context));
+
+	response = input != nullptr ? input->readEntireStreamAsString() : String("no response");
+	return input != nullptr && status_code >= 200 && status_code < 300;
+}
+
+int SplitClient::postComplete(const String& host_name, const String& upload_id, const String& file_name,
+	int64 total_bytes, String& response, const String& content_hash)
+{
+	URL url = URL(host_name + "/upload/complete")
+		.withParameter("upload_id", upload_id)
+		.withParameter("filename", file_name)
+		.withParameter("size", String(total_bytes));
+	if (content_hash.isNotEmpty())
+		url = url.withParameter("hash", content_hash);
+
+	int status_code = 0;
+	SharedResourcePointer<SplitConnection> connection;
+	std::unique_ptr<InputStream> input(connection->open(url, true, {}, &status_code));
+	response = input != nullptr ? input->readEntireStreamAsString() : String("No response from " + host_name);
+	return status_code;
+}
+
+int64 SplitClient::queryResumeOffset(const String& host_name, const String& upload_id)
+{
+	// a server without the status endpoint, or an unknown id, starts from zero
+	int status_code = 0;
+	URL url = URL(host_name + "/upload/status").withParameter("upload_id", upload_id);
+	SharedResourcePointer<SplitConnection> connection;
+	std::unique_ptr<InputStream> input(connection->open(url, false, {}, &status_code));
+	if (input == nullptr || status_code != 200)
+		return 0;
+
+	return input->readEntireStreamAsString().trim().getLargeIntValue();
+}
+
+void SplitClient::uploadEncoded(const std::function<bool()>& should_exit, const std::function<void(double)>& progress)
+{
+	AudioFormatManager formats;
+	formats.registerBasicFormats();
+
+	std::unique_ptr<AudioFormatReader> reader(formats.createReaderFor(file_to_upload_));
+	if (reader == nullptr)
+	{
+		setResponse(0, "Cannot read " + file_to_upload_.getFileName());
+		return;
+	}
+
+	// FLAC carries 16 or 24 bits; float sources go up to 24
+	const int bits_per_sample = reader->bitsPerSample <= 16 ? 16 : 24;
+	const String file_name = file_to_upload_.getFileNameWithoutExtension() + ".flac";
+
+	ChunkedUploadStream* stream = new ChunkedUploadStream(host_name_, Uuid().toDashedString(), file_name);
+	stream->onComplete = [this](int status_code, const String& response_str) { setResponse(status_code, response_str); };
+
+	std::unique_ptr<AudioFormatWriter> writer(FlacAudioFormat().createWriterFor(stream, reader->sampleRate,
+		reader->numChannels, bits_per_sample, {}, FLAC_QUALITY));
+	if (writer == nullptr)
+	{
+		stream->cancel();
+		delete stream;
+		setResponse(0, "Cannot encode " + file_to_upload_.getFileName() + " as FLAC");
+		return;
+	}
+
+	AudioBuffer<float> buffer((int)reader->numChannels, ENCODE_BLOCK_SIZE);
+	for (int64 position = 0; position < reader->lengthInSamples; position += ENCODE_BLOCK_SIZE)
+	{
+		if (should_exit())
+		{
+			stream->cancel();
+			setResponse(0, "Upload was canceled.");
+			return;
+		}
+
+		const int num_samples = (int)jmin((int64)ENCODE_BLOCK_SIZE, reader->lengthInSamples - position);
+		reader->read(&buffer, 0, num_samples, position, true, true);
+		if (!writer->writeFromAudioSampleBuffer(buffer, 0, num_samples))
+		{
+			stream->cancel();
+			setResponse(0, "Chunk upload failed for " + file_name);
+			return;
+		}
+
+		progress((double)(position + num_samples) / reader->lengthInSamples);
+	}
+
+	// the final STREAMINFO goes out, then the stream completes the upload and sets the response
+	writer = nullptr;
+}
+
+void SplitClient::setResponse(int status_code, const String& response)
+{
+	ScopedLock l(response_lock_);
+	status_code_ = status_code;
+	response_ = response;
+}
@@ -0,0 +1,82 @@
+/*
+==============================================================================
+
+SplitClient.h
+Author: Filipe Borato
+
+==============================================================================
+*/
+#pragma once
+
+#include "HeadlessHeader.h"
+
+// Uploads a file to the Split server in fixed-size chunks streamed from disk.
+//
+//   GET  <host>/upload/status?upload_id=<id>  -> bytes already received (resume point)
+//   POST <host>/upload/chunk                  -> raw chunk bytes, with X-Upload-Id,
+//                                               X-Upload-Name and Content-Range headers
+//   POST <host>/upload/complete               -> upload_id, filename, size and, when known, the
+//                                               SHA-256 of the source audio; the reply is the response
+//
+// At most MAX_CHUNKS_IN_FLIGHT chunks are read and sent at once, so memory stays at
+// MAX_CHUNKS_IN_FLIGHT * CHUNK_SIZE whatever the file size, and a failed chunk is retried
+// on its own. The upload id comes from the file's path, size and modification time, so
+// uploading the same file again resumes where the server stopped.
+//
+// With encode_flac the file is decoded and transcoded to FLAC on the way instead, into a
+// ChunkedUploadStream, so encoding overlaps the transfer. That upload can't resume, the
+// encoded bytes only exist while they are sent.
+//
+// No UI: upload() runs on the caller's thread. The editor shows it in a progress window
+// (API_Set_File_Upload), render workers call it directly.
+class SplitClient
+{
+public:
+	static const int CHUNK_SIZE = 4 * 1024 * 1024;
+	static const int MAX_CHUNKS_IN_FLIGHT = 4;
+	static const int MAX_RETRIES = 3;
+	static const int TIMEOUT_MS = 30000;
+	static const int FLAC_QUALITY = 5;
+	static const int ENCODE_BLOCK_SIZE = 65536;
+
+	SplitClient(const File& file_to_upload, const String& host_name, bool encode_flac = false);
+
+	// the whole upload; should_exit is polled throughout and progress gets 0..1
+	void upload(std::function<bool()> should_exit = nullptr, std::function<void(double)> progress = nullptr);
+
+	// one POST of data to <host>/upload/chunk at offset; total_bytes < 0 while the size is
+	// still unknown. Shared with CaptureUploader, which streams the same protocol.
+	static bool postChunk(const String& host_name, const String& upload_id, const String& file_name,
+		int64 offset, const MemoryBlock& data, int64 total_bytes, int& status_code, String& response,
+		URL::OpenStreamProgressCallback* callback = nullptr, void* context = nullptr);
+
+	// asks the server to assemble the upload; returns the HTTP status and the reply in response.
+	// content_hash lets the server answer later requests for the same audio from its cache.
+	static int postComplete(const String& host_name, const String& upload_id, const String& file_name,
+		int64 total_bytes, String& response, const String& content_hash = {});
+
+	// bytes of upload_id the server already has; 0 for a new id or a server without the endpoint
+	static int64 queryResumeOffset(const String& host_name, const String& upload_id);
+
+	// HTTP status of the last request that decided the outcome, 0 if none was made
+	int getStatusCode() const { ScopedLock l(response_lock_); return status_code_; }
+	String getResponseString() const { ScopedLock l(response_lock_); return response_; }
+	bool succeeded() const { ScopedLock l(response_lock_); return status_code_ >= 200 && status_code_ < 300; }
+
+private:
+	class ChunkJob;
+
+	void uploadEncoded(const std::function<bool()>& should_exit, const std::function<void(double)>& progress);
+	void setResponse(int status_code, const String& response);
+
+	File file_to_upload_;
+	String host_name_;
+	bool encode_flac_;
+	std::atomic<int64> bytes_sent_ { 0 };
+
+	CriticalSection response_lock_;
+	int status_code_ = 0;
+	String response_;
+
+	JUCE_DECLARE_NON_COPYABLE(SplitClient)
+};
@@ -0,0 +1,119 @@
+/*
+==============================================================================
+
+SplitConnection.cpp
+Author: Filipe Borato
+
+==============================================================================
+*/
+
+#include "SplitConnection.h"
+
+// forwards to the URL stream and gives the host's slot back when deleted; it keeps the
+// shared connection alive for as long as it exists
+class SplitConnection::Stream : public InputStream
+{
+public:
+	Stream(InputStream* source, const String& host)
+		: source_(source)
+		, host_(host)
+	{
+	}
+
+	~Stream()
+	{
+		source_ = nullptr;
+		connection_->release(host_);
+	}
+
+	int64 getTotalLength() override { return source_->getTotalLength(); }
+	bool isExhausted() override { return source_->isExhausted(); }
+	int read(void* dest_buffer, int max_bytes_to_read) override { return source_->read(dest_buffer, max_bytes_to_read); }
+	int64 getPosition() override { return source_->getPosition(); }
+	bool setPosition(int64 new_position) override { return source_->setPosition(new_position); }
+
+private:
+	SharedResourcePointer<SplitConnection> connection_;
+	std::unique_ptr<InputStream> source_;
+	String host_;
+};
+
+void SplitConnection::setOptions(const Options& options)
+{
+	const ScopedLock l(lock_);
+	options_ = options;
+	options_.max_connections_per_host = jmax(1, options_.max_connections_per_host);
+	slot_freed_.signal();
+}
+
+SplitConnection::Options SplitConnection::getOptions() const
+{
+	const ScopedLock l(lock_);
+	return options_;
+}
+
+std::unique_ptr<InputStream> SplitConnection::open(const URL& url, bool post, const String& headers,
+	int* status_code, URL::OpenStreamProgressCallback* callback, void* context, int timeout_ms,
+	StringPairArray* response_headers)
+{
+	// the slots are counted in the shared instance, which the streams hand them back to
+	jassert(this == SharedResourcePointer<SplitConnection>().get());
+
+	if (status_code != nullptr)
+		*status_code = 0;
+
+	const String host = url.getDomain();
+	if (!acquire(host, callback, context))
+		return nullptr;
+
+	const Options options = getOptions();
+	String request_headers = headers;
+	// JUCE's socket code on Linux (without curl) makes one request per connection, it keeps its
+	// Connection: close
+   #if ! JUCE_LINUX || JUCE_USE_CURL
+	if (options.keep_alive && !headers.containsIgnoreCase("Connection:"))
+		request_headers << "Connection: keep-alive\r\n";
+   #endif
+
+	InputStream* source = url.createInputStream(post, callback, context, request_headers,
+		timeout_ms > 0 ? timeout_ms : options.request_timeout_ms, response_headers, status_code);
+	if (source == nullptr)
+	{
+		release(host);
+		return nullptr;
+	}
+
+	return std::unique_ptr<InputStream>(new Stream(source, host));
+}
+
+bool SplitConnection::acquire(const String& host, URL::OpenStreamProgressCallback* callback, void* context)
+{
+	for (;;)
+	{
+		{
+			const ScopedLock l(lock_);
+			const int num_open = open_per_host_[host];
+			if (num_open < options_.max_connections_per_host)
+			{
+				open_per_host_.set(host, num_open + 1);
+				return true;
+			}
+		}
+
+		// a canceled caller stops waiting; the callback is the same one the request would poll
+		if (callback != nullptr && !callback(context, 0, 0))
+			return false;
+
+		slot_freed_.wait(50);
+	}
+}
+
+void SplitConnection::release(const String& host)
+{
+	{
+		const ScopedLock l(lock_);
+		open_per_host_.set(host, jmax(0, open_per_host_[host] - 1));
+	}
+
+	slot_freed_.signal();
+}
@@ -0,0 +1,65 @@
+/*
+==============================================================================
+
+SplitConnection.h
+Author: Filipe Borato
+
+==============================================================================
+*/
+#pragma once
+
+#include "HeadlessHeader.h"
+
+// The one way requests reach the Split server: SplitClient, ChunkedUploadStream, the job
+// queue, SplitStream and Downloader all open their streams here. Use it through
+// SharedResourcePointer<SplitConnection>, so every thread of every instance shares it.
+//
+//   - requests ask for keep-alive, so the platform HTTP stacks that keep a connection
+//     cache (WinINet, curl) can reuse the TCP/TLS session of the previous request to the
+//     same host instead of setting up a new one
+//   - at most Options::max_connections_per_host requests to a host are open at once, the
+//     rest wait for a slot; a batch of jobs queues on the client instead of opening dozens
+//     of connections and being throttled by the server
+//   - every timeout comes from one Options, set once by the host application
+//
+// JUCE's URL streams can't share a socket across requests nor speak HTTP/2, so there is
+// no multiplexing here; a stream holds its slot until it is deleted.
+class SplitConnection
+{
+public:
+	struct Options
+	{
+		int request_timeout_ms = 30000;   // no data for this long fails a request
+		int long_poll_slack_ms = 10000;   // added to the wait of a long-poll
+		int max_connections_per_host = 6; // what browsers allow per host, too
+		bool keep_alive = true;
+	};
+
+	SplitConnection() {}
+
+	void setOptions(const Options& options);
+	Options getOptions() const;
+
+	// URL::createInputStream() through a slot of url's host; nullptr when the request could
+	// not be made, or when callback gave up while it waited for a slot. timeout_ms 0 means
+	// Options::request_timeout_ms
+	std::unique_ptr<InputStream> open(const URL& url, bool post, const String& headers = {},
+		int* status_code = nullptr, URL::OpenStreamProgressCallback* callback = nullptr, void* context = nullptr,
+		int timeout_ms = 0, StringPairArray* response_headers = nullptr);
+
+	// a long-poll that the server holds for up to wait_seconds
+	int getLongPollTimeout(int wait_seconds) const { return wait_seconds * 1000 + getOptions().long_poll_slack_ms; }
+
+private:
+	class Stream;
+
+	bool acquire(const String& host, URL::OpenStreamProgressCallback* callback, void* context);
+	void release(const String& host);
+
+	CriticalSection lock_;
+	Options options_;
+	HashMap<String, int> open_per_host_;
+	WaitableEvent slot_freed_;
+
+	JUCE_DECLARE_NON_COPYABLE(SplitConnection)
+};
@@ -0,0 +1,527 @@
+/*
+==============================================================================
+
+SplitJobQueue.cpp
+Author: Filipe Borato
+
+==============================================================================
+*/
+
+#include "SplitJobQueue.h"
+#include "SplitClient.h"
+#include "ChunkedUploadStream.h"
+#include "StreamingUnzip.h"
+#include "SplitStream.h"
+#include "SplitConnection.h"
+
+namespace
+{
+	const Identifier JOBS_TYPE("SPLITJOBS");
+	const Identifier JOB_TYPE("JOB");
+	const Identifier ID_PROPERTY("id");
+	const Identifier SERVER_ID_PROPERTY("serverId");
+	const Identifier HASH_PROPERTY("hash");
+	const Identifier FILE_PROPERTY("file");
+	const Identifier STEM_FOLDER_PROPERTY("stemFolder");
+	const Identifier STATE_PROPERTY("state");
+	const Identifier MESSAGE_PROPERTY("message");
+	const Identifier STREAMING_PROPERTY("streaming");
+
+	const int COPY_BLOCK_SIZE = 1024 * 1024;
+	const int MIN_POLL_INTERVAL_MS = 1000;
+}
+
+class SplitJobQueue::SplitJob : public ThreadPoolJob
+{
+public:
+	SplitJob(const JobInfo& info, StemCache& cache, const String& hostName, bool uploadAsFlac)
+		: ThreadPoolJob("Split " + info.file.getFileName())
+		, m_Cache(cache)
+		, m_Info(info)
+		, m_HostName(hostName.trimCharactersAtEnd("/"))
+		, m_bUploadAsFlac(uploadAsFlac)
+	{
+	}
+
+	JobInfo getInfo() const
+	{
+		const ScopedLock l(m_Lock);
+		return m_Info;
+	}
+
+	JobStatus runJob() override
+	{
+		// a job restored with a server id was uploaded in an earlier session
+		if (getInfo().serverId.isEmpty())
+		{
+			if (!hashAudio())
+				return finish();
+
+			if (useCachedStems())
+				return jobHasFinished;
+
+			if (!findOnServer())
+			{
+				// a server without the stream routes gets the whole file instead
+				const StreamResult result = getInfo().streaming ? stream() : StreamResult::unsupported;
+				if (result == StreamResult::done)
+					return complete();
+
+				if (result == StreamResult::failed || !upload())
+					return finish();
+			}
+		}
+
+		if (!waitForSeparation())
+			return finish();
+
+		if (!download())
+			return finish();
+
+		return complete();
+	}
+
+private:
+	enum class StreamResult { done, failed, unsupported };
+
+	JobStatus complete()
+	{
+		const JobInfo info = getInfo();
+		m_Cache.add(info.hash, info.stemFolder, info.stems);
+
+		setState(State::done, 1.0, String());
+		return jobHasFinished;
+	}
+
+	JobStatus finish()
+	{
+		if (shouldExit())
+			setState(State::queued, 0, "Stopped");
+		return jobHasFinished;
+	}
+
+	void setState(State state, double progress, const String& message)
+	{
+		const ScopedLock l(m_Lock);
+		m_Info.state = state;
+		m_Info.progress = progress;
+		m_Info.message = message;
+	}
+
+	void setProgress(double progress)
+	{
+		const ScopedLock l(m_Lock);
+		m_Info.progress = progress;
+	}
+
+	bool fail(const String& message)
+	{
+		setState(State::failed, 0, message);
+		return false;
+	}
+
+	bool hashAudio()
+	{
+		if (getInfo().hash.isNotEmpty())
+			return true;
+
+		setState(State::hashing, -1.0, String());
+		const String hash = StemCache::hashFile(getInfo().file);
+		if (hash.isEmpty())
+			return fail("Cannot read " + getInfo().file.getFileName());
+
+		const ScopedLock l(m_Lock);
+		m_Info.hash = hash;
+		return true;
+	}
+
+	// the same audio split before, by any job in any session: copy, don't send
+	bool useCachedStems()
+	{
+		const JobInfo info = getInfo();
+
+		File cachedFolder;
+		Array<File> cached;
+		if (!m_Cache.lookup(info.hash, cachedFolder, cached))
+			return false;
+
+		Array<File> stems;
+		for (const File& stem : cached)
+		{
+			const File target = info.stemFolder.getChildFile(stem.getRelativePathFrom(cachedFolder));
+			if (target != stem && !(target.getParentDirectory().createDirectory() && stem.copyFileTo(target)))
+				return false; // separate again rather than hand out half a set
+
+			stems.add(target);
+		}
+
+		{
+			const ScopedLock l(m_Lock);
+			m_Info.stems = stems;
+		}
+
+		setState(State::done, 1.0, "From the stem cache");
+		return true;
+	}
+
+	bool findOnServer()
+	{
+		const String hash = getInfo().hash;
+
+		int statusCode = 0;
+		URL url(m_HostName + "/cache/" + hash);
+		std::unique_ptr<InputStream> input(m_Connection->open(url, false, {}, &statusCode, &SplitJob::keepOpen, this));
+
+		// anything but a hit, including a server without the route, means upload
+		if (input == nullptr || statusCode != 200)
+			return false;
+
+		const String serverId = JSON::parse(input->readEntireStreamAsString()).getProperty("job_id", var()).toString();
+		if (serverId.isEmpty())
+			return false;
+
+		const ScopedLock l(m_Lock);
+		m_Info.serverId = serverId;
+		return true;
+	}
+
+	bool upload()
+	{
+		const JobInfo info = getInfo();
+		setState(State::uploading, 0, String());
+
+		int statusCode = 0;
+		String response;
+		const String fileName = m_bUploadAsFlac ? info.file.getFileNameWithoutExtension() + ".flac" : info.file.getFileName();
+
+		std::unique_ptr<ChunkedUploadStream> stream(new ChunkedUploadStream(m_HostName, info.id, fileName));
+		stream->setContentHash(info.hash);
+		stream->onComplete = [&statusCode, &response](int code, const String& reply)
+		{
+			statusCode = code;
+			response = reply;
+		};
+
+		// the stream completes the upload when it is deleted
+		const bool bWritten = m_bUploadAsFlac ? encodeFlac(info.file, stream) : copyFile(info.file, *stream);
+		if (!bWritten || shouldExit())
+		{
+			if (stream != nullptr)
+				stream->cancel();
+			stream = nullptr;
+			return shouldExit() ? false : fail("Cannot upload " + info.file.getFileName());
+		}
+		stream = nullptr;
+
+		if (statusCode < 200 || statusCode >= 300)
+			return fail("Upload failed (" + String(statusCode) + "): " + response);
+
+		const var reply = JSON::parse(response);
+		const String serverId = reply.getProperty("job_id", var()).toString();
+
+		const ScopedLock l(m_Lock);
+		m_Info.serverId = serverId.isNotEmpty() ? serverId : info.id;
+		return true;
+	}
+
+	StreamResult stream()
+	{
+		const JobInfo info = getInfo();
+		setState(State::streaming, 0, String());
+
+		SplitStream splitStream(info.file, info.stemFolder, m_HostName, m_bUploadAsFlac);
+		splitStream.setContentHash(info.hash);
+
+		const Result result = splitStream.run([this] { return shouldExit(); },
+			[this](double progress) { setProgress(progress); },
+			[this](const Array<File>& stems)
+			{
+				const ScopedLock l(m_Lock);
+				m_Info.stems = stems;
+			});
+
+		if (result.wasOk())
+			return StreamResult::done;
+
+		if (splitStream.wasUnsupported())
+			return StreamResult::unsupported;
+
+		if (!shouldExit())
+			fail(result.getErrorMessage());
+		return StreamResult::failed;
+	}
+
+	bool copyFile(const File& file, ChunkedUploadStream& stream)
+	{
+		FileInputStream input(file);
+		if (input.failedToOpen())
+			return false;
+
+		HeapBlock<char> buffer(COPY_BLOCK_SIZE);
+		const int64 total = input.getTotalLength();
+		while (!input.isExhausted() && !shouldExit())
+		{
+			const int numRead = input.read(buffer, COPY_BLOCK_SIZE);
+			if (numRead <= 0)
+				break;
+
+			if (!stream.write(buffer, (size_t)numRead))
+				return false;
+
+			setProgress(total > 0 ? (double)input.getPosition() / total : 0);
+		}
+
+		return input.isExhausted();
+	}
+
+	// the writer takes over the stream, so it is released here once the writer exists
+	bool encodeFlac(const File& file, std::unique_ptr<ChunkedUploadStream>& stream)
+	{
+		AudioFormatManager formats;
+		formats.registerBasicFormats();
+
+		std::unique_ptr<AudioFormatReader> reader(formats.createReaderFor(file));
+		if (reader == nullptr)
+			return false;
+
+		ChunkedUploadStream* output = stream.get();
+		std::unique_ptr<AudioFormatWriter> writer(FlacAudioFormat().createWriterFor(output, reader->sampleRate,
+			reader->numChannels, reader->bitsPerSample <= 16 ? 16 : 24, {}, SplitClient::FLAC_QUALITY));
+		if (writer == nullptr)
+			return false;
+		stream.release();
+
+		AudioBuffer<float> buffer((int)reader->numChannels, SplitClient::ENCODE_BLOCK_SIZE);
+		for (int64 position = 0; position < reader->lengthInSamples; position += buffer.getNumSamples())
+		{
+			if (shouldExit())
+			{
+				output->cancel();
+				return false;
+			}
+
+			const int numSamples = (int)jmin((int64)buffer.getNumSamples(), reader->lengthInSamples - position);
+			reader->read(&buffer, 0, numSamples, position, true, true);
+			if (!writer->writeFromAudioSampleBuffer(buffer, 0, numSamples))
+			{
+				output->cancel();
+				return false;
+			}
+
+			setProgress((double)(position + numSamples) / reader->lengthInSamples);
+		}
+
+		// the final STREAMINFO goes out, then the stream completes the upload
+		writer = nullptr;
+		return true;
+	}
+
+	bool waitForSeparation()
+	{
+		const String serverId = getInfo().serverId;
+		setState(State::separating, 0, String());
+
+		int nFailures = 0;
+		while (!shouldExit())
+		{
+			const uint32 pollStart = Time::getMillisecondCounter();
+
+			// the server holds the request up to POLL_WAIT_SECONDS while nothing changes
+			int statusCode = 0;
+			URL url = URL(m_HostName + "/jobs/" + URL::addEscapeChars(serverId, false) + "/status")
+				.withParameter("wait", String(POLL_WAIT_SECONDS));
+			std::unique_ptr<InputStream> input(m_Connection->open(url, false, {}, &statusCode, &SplitJob::keepOpen, this,
+				m_Connection->getLongPollTimeout(POLL_WAIT_SECONDS)));
+
+			if (input != nullptr && statusCode == 200)
+			{
+				nFailures = 0;
+				const var reply = JSON::parse(input->readEntireStreamAsString());
+				const String state = reply.getProperty("state", var()).toString();
+
+				if (state == "done")
+					return true;
+
+				if (state == "failed")
+					return fail("Separation failed: " + reply.getProperty("error", var()).toString());
+
+				setProgress((double)reply.getProperty("progress", 0.0));
+			}
+			else if (++nFailures > SplitClient::MAX_RETRIES)
+			{
+				return fail("Lost the job on the server (" + String(statusCode) + ")");
+			}
+
+			// a server without long-polling answers at once; don't hammer it
+			while (!shouldExit() && Time::getMillisecondCounter() - pollStart < (uint32)(MIN_POLL_INTERVAL_MS << jmin(nFailures, 4)))
+				Thread::sleep(50);
+		}
+
+		return false;
+	}
+
+	bool download()
+	{
+		const JobInfo info = getInfo();
+		setState(State::downloading, -1.0, String());
+
+		int statusCode = 0;
+		URL url(m_HostName + "/jobs/" + URL::addEscapeChars(info.serverId, false) + "/download");
+		std::unique_ptr<InputStream> input(m_Connection->open(url, false, {}, &statusCode, &SplitJob::keepOpen, this));
+
+		if (input == nullptr || statusCode != 200)
+			return fail("Download failed (" + String(statusCode) + ")");
+
+		InputStream& stream = *input;
+		const int64 total = stream.getTotalLength();
+		Array<File> stems;
+
+		const Result result = StreamingUnzip::extract(stream, info.stemFolder, stems, [this, &stream, total]
+		{
+			if (total > 0)
+				setProgress((double)stream.getPosition() / total);
+			return !shouldExit();
+		});
+
+		{
+			const ScopedLock l(m_Lock);
+			m_Info.stems.addArray(stems);
+		}
+
+		return result.wasOk() || shouldExit() ? result.wasOk() : fail(result.getErrorMessage());
+	}
+
+	static bool keepOpen(void* context, int, int)
+	{
+		return !static_cast<SplitJob*>(context)->shouldExit();
+	}
+
+	StemCache& m_Cache;
+	SharedResourcePointer<SplitConnection> m_Connection;
+	CriticalSection m_Lock;
+	JobInfo m_Info;
+	String m_HostName;
+	bool m_bUploadAsFlac;
+};
+
+//==============================================================================
+SplitJobQueue::SplitJobQueue()
+	: m_Pool(MAX_CONCURRENT_JOBS)
+{
+}
+
+SplitJobQueue::~SplitJobQueue()
+{
+	cancelAll();
+}
+
+String SplitJobQueue::addJob(const File& file, const File& stemFolder, const String& hostName, bool uploadAsFlac,
+	bool streaming)
+{
+	JobInfo info;
+	info.id = Uuid().toDashedString();
+	info.file = file;
+	info.stemFolder = stemFolder;
+	info.streaming = streaming;
+
+	startJob(new SplitJob(info, m_Cache, hostName, uploadAsFlac));
+	return info.id;
+}
+
+void SplitJobQueue::startJob(SplitJob* job)
+{
+	m_Jobs.add(job);
+	m_Pool.addJob(job, false);
+}
+
+void SplitJobQueue::removeFinishedJobs()
+{
+	for (int i = m_Jobs.size(); --i >= 0;)
+	{
+		const State state = m_Jobs[i]->getInfo().state;
+		if ((state == State::done || state == State::failed) && !m_Pool.contains(m_Jobs[i]))
+			m_Jobs.remove(i);
+	}
+}
+
+void SplitJobQueue::cancelAll()
+{
+	m_Pool.removeAllJobs(true, SplitClient::TIMEOUT_MS);
+}
+
+Array<SplitJobQueue::JobInfo> SplitJobQueue::getJobs() const
+{
+	Array<JobInfo> jobs;
+	for (SplitJob* job : m_Jobs)
+		jobs.add(job->getInfo());
+	return jobs;
+}
+
+String SplitJobQueue::getStateName(State state)
+{
+	switch (state)
+	{
+	case State::queued:      return "queued";
+	case State::hashing:     return "hashing";
+	case State::uploading:   return "uploading";
+	case State::separating:  return "separating";
+	case State::downloading: return "downloading";
+	case State::streaming:   return "streaming";
+	case State::done:        return "done";
+	case State::failed:      return "failed";
+	}
+
+	return {};
+}
+
+ValueTree SplitJobQueue::toValueTree() const
+{
+	ValueTree tree(JOBS_TYPE);
+	for (const JobInfo& info : getJobs())
+	{
+		ValueTree job(JOB_TYPE);
+		job.setProperty(ID_PROPERTY, info.id, nullptr);
+		job.setProperty(SERVER_ID_PROPERTY, info.serverId, nullptr);
+		job.setProperty(HASH_PROPERTY, info.hash, nullptr);
+		job.setProperty(FILE_PROPERTY, info.file.getFullPathName(), nullptr);
+		job.setProperty(STEM_FOLDER_PROPERTY, info.stemFolder.getFullPathName(), nullptr);
+		job.setProperty(STATE_PROPERTY, getStateName(info.state), nullptr);
+		job.setProperty(MESSAGE_PROPERTY, info.message, nullptr);
+		job.setProperty(STREAMING_PROPERTY, info.streaming, nullptr);
+		tree.appendChild(job, nullptr);
+	}
+	return tree;
+}
+
+void SplitJobQueue::restore(const ValueTree& tree, const String& hostName, bool uploadAsFlac)
+{
+	cancelAll();
+	m_Jobs.clear();
+
+	if (!tree.hasType(JOBS_TYPE))
+		return;
+
+	for (int i = 0; i < tree.getNumChildren(); ++i)
+	{
+		const ValueTree job = tree.getChild(i);
+
+		JobInfo info;
+		info.id = job[ID_PROPERTY].toString();
+		info.serverId = job[SERVER_ID_PROPERTY].toString();
+		info.hash = job[HASH_PROPERTY].toString();
+		info.file = File(job[FILE_PROPERTY].toString());
+		info.stemFolder = File(job[STEM_FOLDER_PROPERTY].toString());
+		info.message = job[MESSAGE_PROPERTY].toString();
+		info.streaming = job[STREAMING_PROPERTY];
+
+		const String state = job[STATE_PROPERTY].toString();
+		info.state = state == "done" ? State::done : (state == "failed" ? State::failed : State::queued);
+
+		// finished jobs are only listed; the rest carry on, polling if they were uploaded
+		SplitJob* splitJob = new SplitJob(info, m_Cache, hostName, uploadAsFlac);
+		if (info.state == State::queued)
+			startJob(splitJob);
+		else
+			m_Jobs.add(splitJob);
+	}
+}
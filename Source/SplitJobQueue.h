@@ -0,0 +1,84 @@
+/*
+==============================================================================
+
+SplitJobQueue.h
+Author: Filipe Borato
+
+==============================================================================
+*/
+#pragma once
+
+#include "HeadlessHeader.h"
+#include "StemCache.h"
+
+// Background upload -> separate -> download jobs for the Split server.
+//
+// Each job uploads its file with the chunk protocol (see SplitClient), long-polls
+//   GET <host>/jobs/<id>/status?wait=<seconds>  -> {"state": "queued|running|done|failed",
+//                                                   "progress": 0..1, "error": "..."}
+// and unzips GET <host>/jobs/<id>/download into its stem folder as it streams in. The
+// server's job id comes from the /upload/complete reply ({"job_id": "..."}); a plain reply
+// means the upload id is the job id.
+//
+// Before anything is sent the file is hashed. Stems already in the local StemCache are
+// copied over without touching the network, and
+//   GET <host>/cache/<hash>  -> 200 {"job_id": "..."} when the server has separated it before
+// skips the upload and the separation, leaving only the download.
+//
+// A streaming job sends the file in segments instead and gets each segment's stems back as
+// soon as they are separated (see SplitStream), so its stems grow while the rest of the
+// file is still on its way. A server without the streaming routes gets the whole file.
+//
+// At most MAX_CONCURRENT_JOBS run at once, the rest wait in the pool. Nothing here blocks
+// the message thread: the editor reads getJobs() snapshots. The job list goes into the
+// plugin state, so a reloaded session picks up polling where it left off.
+class SplitJobQueue
+{
+public:
+	static const int MAX_CONCURRENT_JOBS = 2;
+	static const int POLL_WAIT_SECONDS = 20;
+
+	enum class State { queued, hashing, uploading, separating, downloading, streaming, done, failed };
+
+	struct JobInfo
+	{
+		String id;       // ours, stable across sessions
+		String serverId; // the server's, once uploaded
+		String hash;     // SHA-256 of file, once hashed
+		File file;
+		File stemFolder;
+		State state = State::queued;
+		double progress = 0;
+		String message;
+		Array<File> stems; // grows segment by segment while streaming
+		bool streaming = false;
+	};
+
+	SplitJobQueue();
+	~SplitJobQueue();
+
+	// message thread only; returns the new job's id
+	String addJob(const File& file, const File& stemFolder, const String& hostName, bool uploadAsFlac,
+		bool streaming = false);
+	void removeFinishedJobs();
+	void cancelAll();
+
+	Array<JobInfo> getJobs() const;
+
+	static String getStateName(State state);
+
+	// the whole list, for the plugin state; restore() requeues every unfinished job
+	ValueTree toValueTree() const;
+	void restore(const ValueTree& tree, const String& hostName, bool uploadAsFlac);
+
+private:
+	class SplitJob;
+
+	void startJob(SplitJob* job);
+
+	StemCache m_Cache; // shared by the jobs, it locks itself
+	OwnedArray<SplitJob> m_Jobs; // owned here, the pool only runs them
+	ThreadPool m_Pool;
+
+	JUCE_DECLARE_NON_COPYABLE(SplitJobQueue)
+};
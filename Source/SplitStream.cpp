@@ -0,0 +1,312 @@
+/*
+==============================================================================
+
+SplitStream.cpp
+Author: Filipe Borato
+
+==============================================================================
+*/
+
+#include "SplitStream.h"
+#include "SplitClient.h"
+#include "StreamingUnzip.h"
+#include "SplitConnection.h"
+
+namespace
+{
+	const int COPY_BLOCK_SIZE = 65536;
+
+	bool keepOpen(void* context, int, int)
+	{
+		const std::function<bool()>& should_exit = *static_cast<const std::function<bool()>*>(context);
+		return !should_exit();
+	}
+}
+
+SplitStream::SplitStream(const File& file_to_split, const File& stem_folder, const String& host_name, bool encode_flac)
+	: file_to_split_(file_to_split)
+	, stem_folder_(stem_folder)
+	, host_name_(host_name.trimCharactersAtEnd("/"))
+	, encode_flac_(encode_flac)
+{
+	formats_.registerBasicFormats();
+}
+
+SplitStream::~SplitStream()
+{
+	close();
+}
+
+Result SplitStream::run(std::function<bool()> should_exit, std::function<void(double)> progress,
+	std::function<void(const Array<File>&)> on_stems)
+{
+	should_exit_ = should_exit ? should_exit : [] { return false; };
+	if (!progress)
+		progress = [](double) {};
+	if (!on_stems)
+		on_stems = [](const Array<File>&) {};
+
+	std::unique_ptr<AudioFormatReader> reader(formats_.createReaderFor(file_to_split_));
+	if (reader == nullptr || reader->sampleRate <= 0)
+		return Result::fail("Cannot read " + file_to_split_.getFileName());
+
+	if (!stem_folder_.createDirectory())
+		return Result::fail("Cannot create " + stem_folder_.getFullPathName());
+
+	const int segment_samples = roundToInt(reader->sampleRate * SEGMENT_SECONDS);
+	const int num_segments = jmax(1, (int)((reader->lengthInSamples + segment_samples - 1) / segment_samples));
+
+	String error;
+	if (!open(*reader, num_segments, segment_samples, error))
+		return Result::fail(error);
+
+	int num_sent = 0;
+	int num_received = 0;
+	int num_failures = 0;
+
+	while (num_received < num_segments)
+	{
+		if (should_exit_())
+			return Result::fail("Stream was canceled.");
+
+		// keep the server busy, but never more than MAX_SEGMENTS_AHEAD segments ahead of what came back
+		const bool can_send = num_sent < num_segments && num_sent - num_received < MAX_SEGMENTS_AHEAD;
+		if (can_send)
+		{
+			if (!sendSegment(*reader, num_sent, segment_samples, error))
+				return Result::fail(error);
+			++num_sent;
+		}
+
+		// while there is more to send only a finished segment is taken, otherwise wait for it
+		const double segment_start = (double)num_received * segment_samples / reader->sampleRate;
+		const Fetch fetch = fetchStems(num_received, can_send ? 0 : POLL_WAIT_SECONDS, segment_start, error);
+
+		if (fetch == Fetch::ready)
+		{
+			num_failures = 0;
+			++num_received;
+			progress((double)num_received / num_segments);
+			on_stems(stems_);
+		}
+		else if (fetch == Fetch::failed && (should_exit_() || ++num_failures > SplitClient::MAX_RETRIES))
+		{
+			return Result::fail(should_exit_() ? String("Stream was canceled.") : error);
+		}
+	}
+
+	// the final headers; the stems are complete files from here on
+	stem_writers_.clear();
+	close();
+	progress(1.0);
+	on_stems(stems_);
+	return Result::ok();
+}
+
+bool SplitStream::open(const AudioFormatReader& reader, int num_segments, int segment_samples, String& error)
+{
+	URL url = URL(host_name_ + "/stream/open")
+		.withParameter("filename", file_to_split_.getFileName())
+		.withParameter("sample_rate", String(reader.sampleRate))
+		.withParameter("channels", String(reader.numChannels))
+		.withParameter("segments", String(num_segments))
+		.withParameter("segment_samples", String(segment_samples));
+	if (content_hash_.isNotEmpty())
+		url = url.withParameter("hash", content_hash_);
+
+	int status_code = 0;
+	std::unique_ptr<InputStream> input(connection_->open(url, true, {}, &status_code, &keepOpen, &should_exit_));
+
+	// an older server answers the unknown route with 404 or 405
+	if (input != nullptr && (status_code == 404 || status_code == 405))
+	{
+		unsupported_ = true;
+		error = "The Split server does not stream";
+		return false;
+	}
+
+	const String response = input != nullptr ? input->readEntireStreamAsString() : String("No response from " + host_name_);
+	if (input == nullptr || status_code < 200 || status_code >= 300)
+	{
+		error = "Cannot open a stream (" + String(status_code) + "): " + response;
+		return false;
+	}
+
+	stream_id_ = JSON::parse(response).getProperty("stream_id", var()).toString();
+	if (stream_id_.isEmpty())
+	{
+		error = "The Split server sent no stream id";
+		return false;
+	}
+
+	return true;
+}
+
+bool SplitStream::sendSegment(AudioFormatReader& reader, int index, int segment_samples, String& error)
+{
+	const int64 start = (int64)index * segment_samples;
+	const int num_samples = (int)jlimit((int64)0, (int64)segment_samples, reader.lengthInSamples - start);
+
+	AudioBuffer<float> buffer((int)reader.numChannels, jmax(1, num_samples));
+	reader.read(&buffer, 0, num_samples, start, true, true);
+
+	// the segment is encoded in memory; one segment is a few megabytes at most
+	MemoryBlock data;
+	{
+		FlacAudioFormat flac;
+		WavAudioFormat wav;
+		AudioFormat* format = encode_flac_ ? static_cast<AudioFormat*>(&flac) : &wav;
+
+		MemoryOutputStream* output = new MemoryOutputStream(data, false);
+		std::unique_ptr<AudioFormatWriter> writer(format->createWriterFor(output, reader.sampleRate,
+			reader.numChannels, reader.bitsPerSample <= 16 ? 16 : 24, {}, encode_flac_ ? SplitClient::FLAC_QUALITY : 0));
+		if (writer == nullptr)
+		{
+			delete output;
+			error = "Cannot encode " + file_to_split_.getFileName();
+			return false;
+		}
+
+		if (!writer->writeFromAudioSampleBuffer(buffer, 0, num_samples))
+		{
+			error = "Cannot encode " + file_to_split_.getFileName();
+			return false;
+		}
+	}
+
+	const String headers = String("Content-Type: ") + (encode_flac_ ? "audio/flac" : "audio/wav") + "\r\n";
+	const URL url = URL(host_name_ + "/stream/" + URL::addEscapeChars(stream_id_, false) + "/segment/" + String(index))
+		.withPOSTData(data);
+
+	for (int attempt = 0; attempt <= SplitClient::MAX_RETRIES && !should_exit_(); ++attempt)
+	{
+		if (attempt > 0)
+			Thread::sleep(250 << attempt);
+
+		int status_code = 0;
+		std::unique_ptr<InputStream> input(connection_->open(url, true, headers, &status_code, &keepOpen, &should_exit_));
+		if (input != nullptr && status_code >= 200 && status_code < 300)
+			return true;
+
+		error = "Segment " + String(index) + " failed (" + String(status_code) + "): "
+			+ (input != nullptr ? input->readEntireStreamAsString() : String("no response"));
+		DBG(error + ", attempt " + String(attempt + 1));
+	}
+
+	return false;
+}
+
+SplitStream::Fetch SplitStream::fetchStems(int index, int wait_seconds, double segment_start, String& error)
+{
+	const URL url = URL(host_name_ + "/stream/" + URL::addEscapeChars(stream_id_, false) + "/stems/" + String(index))
+		.withParameter("wait", String(wait_seconds));
+
+	int status_code = 0;
+	std::unique_ptr<InputStream> input(connection_->open(url, false, {}, &status_code, &keepOpen, &should_exit_,
+		connection_->getLongPollTimeout(wait_seconds)));
+
+	if (input != nullptr && status_code == 202)
+		return Fetch::pending;
+
+	if (input == nullptr || status_code != 200)
+	{
+		error = "Stems of segment " + String(index) + " failed (" + String(status_code) + ")";
+		return Fetch::failed;
+	}
+
+	// the zip is unpacked next to the stems, appended and thrown away
+	const File segment_folder = stem_folder_.getChildFile(".segment");
+	segment_folder.deleteRecursively();
+
+	Array<File> files;
+	const Result result = StreamingUnzip::extract(*input, segment_folder, files, [this] { return !should_exit_(); });
+
+	bool ok = result.wasOk();
+	if (!ok)
+		error = result.getErrorMessage();
+
+	for (const File& file : files)
+		if (ok && !file.isDirectory())
+			ok = appendStem(file, segment_start, error);
+
+	segment_folder.deleteRecursively();
+	return ok ? Fetch::ready : Fetch::failed;
+}
+
+bool SplitStream::appendStem(const File& file, double segment_start, String& error)
+{
+	std::unique_ptr<AudioFormatReader> reader(formats_.createReaderFor(file));
+	if (reader == nullptr)
+		return true; // not audio, e.g. a manifest next to the stems
+
+	const String name = file.getFileNameWithoutExtension();
+	StemWriter* stem = nullptr;
+	for (StemWriter* writer : stem_writers_)
+		if (writer->name == name)
+			stem = writer;
+
+	if (stem == nullptr)
+	{
+		const File stem_file = stem_folder_.getChildFile(File::createLegalFileName(name) + ".wav");
+		stem_file.deleteFile();
+
+		std::unique_ptr<FileOutputStream> output(stem_file.createOutputStream());
+		std::unique_ptr<AudioFormatWriter> writer;
+		if (output != nullptr)
+			writer.reset(WavAudioFormat().createWriterFor(output.get(), reader->sampleRate, reader->numChannels,
+				24, {}, 0));
+		if (writer == nullptr)
+		{
+			error = "Cannot write " + stem_file.getFullPathName();
+			return false;
+		}
+		output.release(); // the writer owns it now
+
+		stem = stem_writers_.add(new StemWriter());
+		stem->name = name;
+		stem->writer = std::move(writer);
+		stems_.add(stem_file);
+	}
+
+	// a segment fetched again after a broken download has some stems in already
+	const int64 start = (int64)(segment_start * stem->writer->getSampleRate() + 0.5);
+	if (stem->num_written > start)
+		return true;
+
+	// a stem the earlier segments didn't have starts with their length of silence
+	AudioBuffer<float> buffer(jmax((int)reader->numChannels, stem->writer->getNumChannels()), COPY_BLOCK_SIZE);
+	buffer.clear();
+	while (stem->num_written < start)
+	{
+		const int num_samples = (int)jmin((int64)COPY_BLOCK_SIZE, start - stem->num_written);
+		stem->writer->writeFromAudioSampleBuffer(buffer, 0, num_samples);
+		stem->num_written += num_samples;
+	}
+
+	for (int64 position = 0; position < reader->lengthInSamples; position += COPY_BLOCK_SIZE)
+	{
+		const int num_samples = (int)jmin((int64)COPY_BLOCK_SIZE, reader->lengthInSamples - position);
+		reader->read(&buffer, 0, num_samples, position, true, true);
+		if (!stem->writer->writeFromAudioSampleBuffer(buffer, 0, num_samples))
+		{
+			error = "Cannot write the " + name + " stem";
+			return false;
+		}
+		stem->num_written += num_samples;
+	}
+
+	// rewrites the header, so the file is playable up to here while the rest streams in
+	stem->writer->flush();
+	return true;
+}
+
+void SplitStream::close()
+{
+	if (stream_id_.isEmpty())
+		return;
+
+	// best effort, the server also drops streams nobody reads from
+	const URL url(host_name_ + "/stream/" + URL::addEscapeChars(stream_id_, false) + "/close");
+	std::unique_ptr<InputStream> input(connection_->open(url, true));
+	stream_id_.clear();
+}
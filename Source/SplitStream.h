@@ -0,0 +1,88 @@
+/*
+==============================================================================
+
+SplitStream.h
+Author: Filipe Borato
+
+==============================================================================
+*/
+#pragma once
+
+#include "HeadlessHeader.h"
+#include "SplitConnection.h"
+
+// Separates a file with the Split server's streaming routes: the audio goes out in
+// segments of SEGMENT_SECONDS and the stems of each segment come back as soon as the
+// server's network has finished it, so the stems start growing after one segment rather
+// than after the whole file.
+//
+//   POST <host>/stream/open                     -> filename, sample_rate, channels, segments,
+//                                                  segment_samples, hash; replies {"stream_id": "..."}
+//   POST <host>/stream/<id>/segment/<index>     -> the segment as WAV or FLAC
+//   GET  <host>/stream/<id>/stems/<index>?wait= -> 200 a zip with one audio file per stem,
+//                                                  202 while the segment is still separating
+//   POST <host>/stream/<id>/close               -> the server drops the stream
+//
+// Requests are plain HTTP, one per segment, through the shared SplitConnection like the
+// chunk upload. Up to MAX_SEGMENTS_AHEAD segments are sent before their stems are back;
+// while there is more to send only finished segments are picked up, then the rest is
+// long-polled. Each stem is appended to <stem folder>/<stem>.wav and its header is
+// rewritten after every segment, so the file on disk always plays up to the last segment.
+//
+// No UI: run() works on the caller's thread, SplitJobQueue runs it from its pool.
+class SplitStream
+{
+public:
+	static const int SEGMENT_SECONDS = 10;
+	static const int MAX_SEGMENTS_AHEAD = 3;
+	static const int POLL_WAIT_SECONDS = 20;
+
+	SplitStream(const File& file_to_split, const File& stem_folder, const String& host_name, bool encode_flac = false);
+	~SplitStream();
+
+	// the whole exchange. should_exit is polled throughout, progress gets 0..1 as segments
+	// come back and on_stems every stem file so far, each time a segment has been appended
+	Result run(std::function<bool()> should_exit, std::function<void(double)> progress,
+		std::function<void(const Array<File>&)> on_stems);
+
+	// sent with the open so the server can index the result; set before run()
+	void setContentHash(const String& hash) { content_hash_ = hash; }
+
+	// run() failed because the server has no /stream routes; the whole file upload still works
+	bool wasUnsupported() const { return unsupported_; }
+
+private:
+	struct StemWriter
+	{
+		String name;
+		std::unique_ptr<AudioFormatWriter> writer;
+		int64 num_written = 0;
+	};
+
+	enum class Fetch { ready, pending, failed };
+
+	bool open(const AudioFormatReader& reader, int num_segments, int segment_samples, String& error);
+	bool sendSegment(AudioFormatReader& reader, int index, int segment_samples, String& error);
+	// segment_start in seconds, where the segment goes in the stems
+	Fetch fetchStems(int index, int wait_seconds, double segment_start, String& error);
+	// appends one stem file of a segment, padding a stem that was missing from earlier ones
+	bool appendStem(const File& file, double segment_start, String& error);
+	void close();
+
+	File file_to_split_;
+	File stem_folder_;
+	String host_name_;
+	bool encode_flac_;
+	String content_hash_;
+
+	String stream_id_;
+	bool unsupported_ = false;
+	std::function<bool()> should_exit_;
+
+	SharedResourcePointer<SplitConnection> connection_;
+	AudioFormatManager formats_;
+	OwnedArray<StemWriter> stem_writers_;
+	Array<File> stems_;
+
+	JUCE_DECLARE_NON_COPYABLE(SplitStream)
+};
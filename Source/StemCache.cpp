@@ -0,0 +1,110 @@
+/*
+==============================================================================
+
+StemCache.cpp
+Author: Filipe Borato
+
+==============================================================================
+*/
+
+#include "StemCache.h"
+
+namespace
+{
+	const Identifier INDEX_TYPE("STEMCACHE");
+	const Identifier ENTRY_TYPE("ENTRY");
+	const Identifier STEM_TYPE("STEM");
+	const Identifier HASH_PROPERTY("hash");
+	const Identifier FOLDER_PROPERTY("folder");
+	const Identifier PATH_PROPERTY("path");
+}
+
+StemCache::StemCache()
+	: StemCache(getDefaultIndexFile())
+{
+}
+
+StemCache::StemCache(const File& indexFile)
+	: m_IndexFile(indexFile)
+	, m_Index(INDEX_TYPE)
+{
+	load();
+}
+
+String StemCache::hashFile(const File& file)
+{
+	FileInputStream input(file);
+	if (input.failedToOpen())
+		return {};
+
+	return SHA256(input).toHexString();
+}
+
+bool StemCache::lookup(const String& hash, File& stemFolder, Array<File>& stems)
+{
+	const ScopedLock l(m_Lock);
+
+	const ValueTree entry = m_Index.getChildWithProperty(HASH_PROPERTY, hash);
+	if (!entry.isValid() || entry.getNumChildren() == 0)
+		return false;
+
+	const File folder(entry[FOLDER_PROPERTY].toString());
+	Array<File> files;
+	for (int i = 0; i < entry.getNumChildren(); ++i)
+	{
+		const File stem = folder.getChildFile(entry.getChild(i)[PATH_PROPERTY].toString());
+		if (!stem.existsAsFile())
+			return false; // deleted or moved since, separate again
+		files.add(stem);
+	}
+
+	stemFolder = folder;
+	stems.swapWith(files);
+	return true;
+}
+
+void StemCache::add(const String& hash, const File& stemFolder, const Array<File>& stems)
+{
+	if (hash.isEmpty() || stems.isEmpty())
+		return;
+
+	const ScopedLock l(m_Lock);
+
+	// another instance may have written the index since it was read
+	load();
+
+	ValueTree entry(ENTRY_TYPE);
+	entry.setProperty(HASH_PROPERTY, hash, nullptr);
+	entry.setProperty(FOLDER_PROPERTY, stemFolder.getFullPathName(), nullptr);
+	for (const File& stem : stems)
+	{
+		ValueTree child(STEM_TYPE);
+		child.setProperty(PATH_PROPERTY, stem.getRelativePathFrom(stemFolder), nullptr);
+		entry.appendChild(child, nullptr);
+	}
+
+	m_Index.removeChild(m_Index.getChildWithProperty(HASH_PROPERTY, hash), nullptr);
+	m_Index.appendChild(entry, nullptr);
+	save();
+}
+
+File StemCache::getDefaultIndexFile()
+{
+	return File::getSpecialLocation(File::userApplicationDataDirectory)
+		.getChildFile("CompressorAndSplit").getChildFile("StemCache.xml");
+}
+
+void StemCache::load()
+{
+	std::unique_ptr<XmlElement> xml(XmlDocument::parse(m_IndexFile));
+	if (xml != nullptr && xml->hasTagName(INDEX_TYPE.toString()))
+		m_Index = ValueTree::fromXml(*xml);
+}
+
+void StemCache::save() const
+{
+	std::unique_ptr<XmlElement> xml(m_Index.createXml());
+	if (xml == nullptr || !m_IndexFile.getParentDirectory().createDirectory()
+		|| !xml->writeToFile(m_IndexFile, {}))
+		DBG("Cannot write the stem cache index " + m_IndexFile.getFullPathName());
+}
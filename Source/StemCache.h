@@ -0,0 +1,43 @@
+/*
+==============================================================================
+
+StemCache.h
+Author: Filipe Borato
+
+==============================================================================
+*/
+#pragma once
+
+#include "HeadlessHeader.h"
+
+// Remembers which stems came out of which audio, keyed by the SHA-256 of the file that
+// was sent for separation, so the same bounce is never uploaded or separated twice.
+//
+// The index is a small XML file in the user's application data folder, shared by every
+// instance; an entry only counts while all of its stem files are still on disk. The
+// server side of the same idea is GET <host>/cache/<hash> (see SplitJobQueue).
+class StemCache
+{
+public:
+	StemCache();
+	explicit StemCache(const File& indexFile);
+
+	// hex SHA-256 of the file's bytes, empty if it can't be read
+	static String hashFile(const File& file);
+
+	// the folder and files stored for hash, if every one of them still exists
+	bool lookup(const String& hash, File& stemFolder, Array<File>& stems);
+	void add(const String& hash, const File& stemFolder, const Array<File>& stems);
+
+	static File getDefaultIndexFile();
+
+private:
+	void load();
+	void save() const;
+
+	File m_IndexFile;
+	CriticalSection m_Lock;
+	ValueTree m_Index;
+
+	JUCE_DECLARE_NON_COPYABLE(StemCache)
+};
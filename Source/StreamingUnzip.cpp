@@ -0,0 +1,225 @@
+/*
+==============================================================================
+
+StreamingUnzip.cpp
+Author: Filipe Borato
+
+==============================================================================
+*/
+
+#include "StreamingUnzip.h"
+
+namespace
+{
+	const int LOCAL_HEADER_SIGNATURE = 0x04034b50;
+	const int CENTRAL_HEADER_SIGNATURE = 0x02014b50;
+	const int END_OF_CENTRAL_SIGNATURE = 0x06054b50;
+	const int DATA_DESCRIPTOR_SIGNATURE = 0x08074b50;
+	const int ZIP64_EXTRA_ID = 0x0001;
+
+	const int FLAG_ENCRYPTED = 0x0001;
+	const int FLAG_DATA_DESCRIPTOR = 0x0008;
+
+	const int METHOD_STORED = 0;
+	const int METHOD_DEFLATED = 8;
+
+	const int COPY_BUFFER_SIZE = 64 * 1024;
+
+	// the next numBytes of a forward-only stream; the inflater reads ahead in whole buffers,
+	// so it must not see past the end of its entry
+	class BoundedInputStream : public InputStream
+	{
+	public:
+		BoundedInputStream(InputStream& source, int64 numBytes)
+			: m_Source(source), m_nLength(numBytes)
+		{
+		}
+
+		int64 getTotalLength() override { return m_nLength; }
+		int64 getPosition() override { return m_nPosition; }
+		bool isExhausted() override { return m_nPosition >= m_nLength || m_Source.isExhausted(); }
+
+		int read(void* destBuffer, int maxBytesToRead) override
+		{
+			const int numBytes = (int)jmin((int64)maxBytesToRead, m_nLength - m_nPosition);
+			if (numBytes <= 0)
+				return 0;
+
+			const int numRead = m_Source.read(destBuffer, numBytes);
+			if (numRead > 0)
+				m_nPosition += numRead;
+			return numRead;
+		}
+
+		bool setPosition(int64 newPosition) override
+		{
+			// forwards only, by reading
+			if (newPosition < m_nPosition)
+				return false;
+
+			skipNextBytes(newPosition - m_nPosition);
+			return m_nPosition == newPosition;
+		}
+
+	private:
+		InputStream& m_Source;
+		int64 m_nLength;
+		int64 m_nPosition = 0;
+	};
+
+	bool readExactly(InputStream& source, void* dest, int numBytes)
+	{
+		return source.read(dest, numBytes) == numBytes;
+	}
+
+	// zip64 sizes live in an extra field when the header fields read 0xffffffff
+	void readZip64Sizes(const MemoryBlock& extra, int64& compressedSize, int64& uncompressedSize)
+	{
+		MemoryInputStream fields(extra, false);
+		while (fields.getNumBytesRemaining() >= 4)
+		{
+			const int id = (unsigned short)fields.readShort();
+			const int size = (unsigned short)fields.readShort();
+			const int64 end = fields.getPosition() + size;
+
+			if (id == ZIP64_EXTRA_ID)
+			{
+				if (uncompressedSize == 0xffffffff && fields.getPosition() + 8 <= end)
+					uncompressedSize = fields.readInt64();
+				if (compressedSize == 0xffffffff && fields.getPosition() + 8 <= end)
+					compressedSize = fields.readInt64();
+				return;
+			}
+
+			fields.setPosition(end);
+		}
+	}
+
+	bool copyStream(InputStream& input, OutputStream& output, int64& numCopied, HeapBlock<char>& buffer,
+		const std::function<bool()>& keepGoing)
+	{
+		numCopied = 0;
+		for (;;)
+		{
+			if (keepGoing && !keepGoing())
+				return false;
+
+			const int numRead = input.read(buffer, COPY_BUFFER_SIZE);
+			if (numRead <= 0)
+				return true;
+
+			if (!output.write(buffer, (size_t)numRead))
+				return false;
+
+			numCopied += numRead;
+		}
+	}
+}
+
+Result StreamingUnzip::extract(InputStream& source, const File& destinationFolder,
+	Array<File>& extractedFiles, std::function<bool()> keepGoing)
+{
+	if (!destinationFolder.createDirectory())
+		return Result::fail("Cannot create " + destinationFolder.getFullPathName());
+
+	HeapBlock<char> buffer(COPY_BUFFER_SIZE);
+
+	for (;;)
+	{
+		const int signature = source.readInt();
+		if (signature == CENTRAL_HEADER_SIGNATURE || signature == END_OF_CENTRAL_SIGNATURE)
+			return Result::ok(); // past the last entry
+
+		if (signature != LOCAL_HEADER_SIGNATURE)
+			return Result::fail(extractedFiles.isEmpty() ? "The response is not a zip archive"
+				: "The archive is truncated or corrupt");
+
+		// local file header, after the signature
+		char header[26];
+		if (!readExactly(source, header, sizeof(header)))
+			return Result::fail("The archive is truncated");
+
+		const int flags = ByteOrder::littleEndianShort(header + 2);
+		const int method = ByteOrder::littleEndianShort(header + 4);
+		int64 compressedSize = (uint32)ByteOrder::littleEndianInt(header + 14);
+		int64 uncompressedSize = (uint32)ByteOrder::littleEndianInt(header + 18);
+		const int nameLength = ByteOrder::littleEndianShort(header + 22);
+		const int extraLength = ByteOrder::littleEndianShort(header + 24);
+
+		MemoryBlock name, extra;
+		if (source.readIntoMemoryBlock(name, nameLength) != (size_t)nameLength
+			|| source.readIntoMemoryBlock(extra, extraLength) != (size_t)extraLength)
+			return Result::fail("The archive is truncated");
+
+		readZip64Sizes(extra, compressedSize, uncompressedSize);
+
+		const String entryName = String::fromUTF8((const char*)name.getData(), (int)name.getSize()).replaceCharacter('\\', '/');
+
+		if ((flags & FLAG_ENCRYPTED) != 0)
+			return Result::fail(entryName + " is encrypted");
+
+		if ((flags & FLAG_DATA_DESCRIPTOR) != 0 && compressedSize == 0)
+			return Result::fail(entryName + " has no size in its local header");
+
+		if (method != METHOD_STORED && method != METHOD_DEFLATED)
+			return Result::fail(entryName + " uses an unsupported compression method");
+
+		// no absolute paths or "..", the entries must stay inside the destination
+		const File target = destinationFolder.getChildFile(entryName);
+		if (entryName.startsWithChar('/') || entryName.contains("..") || !target.isAChildOf(destinationFolder))
+			return Result::fail(entryName + " points outside the destination folder");
+
+		BoundedInputStream entryData(source, compressedSize);
+
+		if (entryName.endsWithChar('/'))
+		{
+			target.createDirectory();
+		}
+		else
+		{
+			target.getParentDirectory().createDirectory();
+			target.deleteFile();
+
+			bool bCopied;
+			int64 numWritten = 0;
+			{
+				FileOutputStream output(target, COPY_BUFFER_SIZE);
+				if (output.failedToOpen())
+					return Result::fail("Cannot write " + target.getFullPathName());
+
+				if (method == METHOD_DEFLATED)
+				{
+					GZIPDecompressorInputStream inflater(&entryData, false,
+						GZIPDecompressorInputStream::deflateFormat, uncompressedSize);
+					bCopied = copyStream(inflater, output, numWritten, buffer, keepGoing);
+				}
+				else
+				{
+					bCopied = copyStream(entryData, output, numWritten, buffer, keepGoing);
+				}
+			}
+
+			extractedFiles.add(target);
+
+			if (!bCopied)
+				return keepGoing && !keepGoing() ? Result::fail("Canceled") : Result::fail("Cannot write " + target.getFullPathName());
+
+			if (numWritten != uncompressedSize)
+				return Result::fail(entryName + " is truncated");
+		}
+
+		// whatever the inflater didn't need, up to the next header
+		entryData.skipNextBytes(compressedSize - entryData.getPosition());
+		if (entryData.getPosition() != compressedSize)
+			return Result::fail("The archive is truncated");
+
+		// a data descriptor repeats crc and sizes after the data, with or without a signature
+		if ((flags & FLAG_DATA_DESCRIPTOR) != 0)
+		{
+			const bool zip64 = extra.getSize() > 0 && (compressedSize > 0xffffffff || uncompressedSize > 0xffffffff);
+			const int sizesLength = zip64 ? 16 : 8;
+			const int first = source.readInt();
+			source.skipNextBytes(first == DATA_DESCRIPTOR_SIGNATURE ? 4 + sizesLength : sizesLength);
+		}
+	}
+}
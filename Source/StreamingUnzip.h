@@ -0,0 +1,26 @@
+/*
+==============================================================================
+
+StreamingUnzip.h
+Author: Filipe Borato
+
+==============================================================================
+*/
+#pragma once
+
+#include "HeadlessHeader.h"
+
+// Extracts a zip archive while it is read from a forward-only stream, such as the Split
+// server's download response. ZipFile needs the central directory at the end of the
+// archive, i.e. the whole zip; this walks the local headers instead, so each entry is
+// inflated straight to disk and nothing but a copy buffer is held in memory.
+//
+// Entries must carry their sizes in the local header (stored or deflated, zip64 included);
+// archives written with data descriptors can't be split up without the central directory.
+struct StreamingUnzip
+{
+	// keepGoing is called between buffers; returning false cancels. Every file written is
+	// added to extractedFiles, also when the archive turns out to be broken halfway.
+	static Result extract(InputStream& source, const File& destinationFolder,
+		Array<File>& extractedFiles, std::function<bool()> keepGoing);
+};
@@ -0,0 +1,107 @@
+/*
+==============================================================================
+
+ApproximationCheck.cpp
+Author: Filipe Borato
+
+==============================================================================
+*/
+
+// Error bounds of the fast math in the detector and gain stage against the exact functions
+// they stand in for, over the ranges the parameters allow. Build it as TestSources.h
+// describes; it returns non-zero if any bound is broken. Run it after touching fastLog(),
+// fastdBToLinear() or CGainComputer; GoldenCheck.cpp covers the detector around them.
+
+#include "TestSources.h"
+
+namespace
+{
+	// the widest bounds the approximations may have
+	const double MAX_LINEAR_TO_DB_ERROR_DB = 1.0e-4;
+	const double MAX_DB_TO_LINEAR_RELATIVE_ERROR = 1.0e-6;
+	const double MAX_GAIN_RELATIVE_ERROR = 1.0e-5;
+
+	int g_nFailures = 0;
+
+	void report(const char* szName, double fWorst, double fBound)
+	{
+		const bool bPassed = fWorst <= fBound;
+		printf("%-40s worst %.3g, bound %.3g  %s\n", szName, fWorst, fBound, bPassed ? "ok" : "FAILED");
+		if (!bPassed)
+			++g_nFailures;
+	}
+
+	// the detector's envelope runs from the smallest normal float to 1.0, checked
+	// logarithmically down to a -200dB envelope and at the edges of the mantissa split
+	void checkLinearTodB()
+	{
+		double fWorst = 0.0;
+		for (int i = 0; i <= 200000; ++i)
+		{
+			const float x = (float)pow(10.0, -10.0 * i / 200000.0);
+			fWorst = std::max(fWorst, fabs(fastLinearTodB(x) - 20.0 * log10((double)x)));
+		}
+
+		const float edges[] = { FLT_MIN_PLUS, 2.0f / 3.0f, 0.6666666f, 0.6666667f, 0.5f, 1.0f };
+		for (float x : edges)
+			fWorst = std::max(fWorst, fabs(fastLinearTodB(x) - 20.0 * log10((double)x)));
+
+		report("fastLinearTodB vs 20 * log10", fWorst, MAX_LINEAR_TO_DB_ERROR_DB);
+	}
+
+	// input gain +-12dB, make up gain up to 40dB and gain reductions of up to -120dB
+	void checkdBToLinear()
+	{
+		double fWorst = 0.0;
+		for (int i = 0; i <= 200000; ++i)
+		{
+			const float fdB = -120.0f + 180.0f * i / 200000.0f;
+			const double fExact = pow(10.0, fdB / 20.0);
+			fWorst = std::max(fWorst, fabs(fastdBToLinear(fdB) - fExact) / fExact);
+		}
+
+		report("fastdBToLinear vs pow(10, dB / 20)", fWorst, MAX_DB_TO_LINEAR_RELATIVE_ERROR);
+	}
+
+	// computeBlock() (the SIMD version where there is one) over the parameter grid
+	void checkGainComputer()
+	{
+		const int nValues = 1021; // odd, so the vector loops have a tail
+		float detector[nValues];
+		float gain[nValues];
+		for (int i = 0; i < nValues; ++i)
+			detector[i] = -96.0f + 96.0f * i / (nValues - 1);
+
+		const float thresholds[] = { -60.0f, -40.0f, -24.0f, -12.0f, -3.0f, 0.0f };
+		const float ratios[] = { 1.0f, 1.5f, 2.0f, 4.0f, 10.0f, 20.0f };
+		const float kneeWidths[] = { 0.0f, 1.0f, 6.0f, 12.0f, 20.0f };
+		const float fMakeUpGain = 2.0f;
+
+		double fWorst = 0.0;
+		CGainComputer computer;
+		for (float fThreshold : thresholds)
+			for (float fRatio : ratios)
+				for (float fKneeWidth : kneeWidths)
+				{
+					computer.setParameters(fThreshold, fRatio, fKneeWidth);
+					computer.computeBlock(detector, gain, nValues, fMakeUpGain);
+
+					for (int i = 0; i < nValues; ++i)
+					{
+						const double fExact = fMakeUpGain * referenceGain(detector[i], fThreshold, fRatio, fKneeWidth);
+						fWorst = std::max(fWorst, fabs(gain[i] - fExact) / fExact);
+					}
+				}
+
+		report("CGainComputer vs lagrpol and pow", fWorst, MAX_GAIN_RELATIVE_ERROR);
+	}
+}
+
+int main()
+{
+	checkLinearTodB();
+	checkdBToLinear();
+	checkGainComputer();
+
+	return g_nFailures == 0 ? 0 : 1;
+}
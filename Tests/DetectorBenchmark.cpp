@@ -0,0 +1,129 @@
+/*
+==============================================================================
+
+DetectorBenchmark.cpp
+Author: Filipe Borato
+
+==============================================================================
+*/
+
+// Times the detector and gain stage kernels: CEnvelopeDetector::detectBlock() for every
+// detect mode, time constant style and log setting, and CGainComputer::computeBlock() with
+// a hard and a soft knee, on mono and stereo at several block sizes. Each row prints the
+// ns per sample (the best of a few runs) and how many such channel sets one core could run
+// in real time at SAMPLE_RATE. The whole processBlock() needs JUCE and is not timed here.
+// Build it as TestSources.h describes, with optimisations on.
+
+#include "TestSources.h"
+#include <chrono>
+#include <vector>
+
+namespace
+{
+	const float SAMPLE_RATE = 48000.0f;
+	const int SAMPLES_PER_RUN = 1 << 21; // per channel
+	const int NUM_RUNS = 5;
+
+	const char* const MODE_NAMES[3] = { "peak", "ms", "rms" };
+	const int BLOCK_SIZES[] = { 32, 64, 512, 4096 };
+
+	// keeps the outputs alive, so nothing is optimised away
+	volatile float g_fSink = 0.0f;
+
+	// noise with a level that moves, so the recursion takes both attack and release
+	std::vector<float> makeInput(int nSamples)
+	{
+		std::vector<float> samples(nSamples);
+		unsigned int uSeed = 12345;
+		for (int i = 0; i < nSamples; ++i)
+		{
+			uSeed = uSeed * 1664525u + 1013904223u;
+			const float fLevel = (i / 4800) % 2 == 0 ? 0.5f : 0.02f;
+			samples[i] = fLevel * ((float)(uSeed >> 8) / 8388608.0f - 1.0f);
+		}
+		return samples;
+	}
+
+	// best of NUM_RUNS, in ns per sample of one channel; process(channel, start, n) does one block
+	template <typename Process>
+	double timeRuns(int nChannels, int nBlockSize, Process process)
+	{
+		double fBest = 1e30;
+		for (int nRun = 0; nRun <= NUM_RUNS; ++nRun)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			for (int nStart = 0; nStart < SAMPLES_PER_RUN; nStart += nBlockSize)
+				for (int channel = 0; channel < nChannels; ++channel)
+					process(channel, nStart, nBlockSize);
+			const auto end = std::chrono::steady_clock::now();
+
+			// the first run only warms the caches up
+			const double fNs = std::chrono::duration<double, std::nano>(end - start).count();
+			if (nRun > 0)
+				fBest = std::min(fBest, fNs / ((double)SAMPLES_PER_RUN * nChannels));
+		}
+		return fBest;
+	}
+
+	void report(const char* szKernel, const char* szSetting, int nChannels, int nBlockSize, double fNsPerSample)
+	{
+		// one instance has nChannels samples to compute per sample period
+		const double fInstances = 1.0e9 / SAMPLE_RATE / (fNsPerSample * nChannels);
+		printf("%-14s %-22s %-7s %6d %10.2f %12.0f\n", szKernel, szSetting, nChannels == 1 ? "mono" : "stereo",
+			nBlockSize, fNsPerSample, fInstances);
+	}
+}
+
+int main()
+{
+	const std::vector<float> input = makeInput(SAMPLES_PER_RUN);
+	std::vector<float> output(4096);
+
+	printf("%-14s %-22s %-7s %6s %10s %12s\n", "kernel", "setting", "layout", "block", "ns/sample", "per core");
+
+	for (int nChannels = 1; nChannels <= 2; ++nChannels)
+		for (int nBlockSize : BLOCK_SIZES)
+		{
+			for (UINT uMode = 0; uMode < 3; ++uMode)
+				for (int nAnalog = 0; nAnalog < 2; ++nAnalog)
+					for (int nLog = 0; nLog < 2; ++nLog)
+					{
+						CEnvelopeDetector detectors[2];
+						for (CEnvelopeDetector& detector : detectors)
+							detector.init(SAMPLE_RATE, 10.0f, 200.0f, nAnalog != 0, uMode, nLog != 0);
+
+						const double fNs = timeRuns(nChannels, nBlockSize, [&](int channel, int nStart, int nSamples)
+						{
+							detectors[channel].detectBlock(&input[nStart], &output[0], nSamples);
+							g_fSink = output[nSamples - 1];
+						});
+
+						char szSetting[32];
+						snprintf(szSetting, sizeof(szSetting), "%s %s log %s", MODE_NAMES[uMode],
+							nAnalog != 0 ? "analog" : "digital", nLog != 0 ? "on" : "off");
+						report("detectBlock", szSetting, nChannels, nBlockSize, fNs);
+					}
+
+			// detector values around the threshold, so the knee is crossed
+			std::vector<float> detector(input.size());
+			for (size_t i = 0; i < input.size(); ++i)
+				detector[i] = -48.0f + 48.0f * fabsf(input[i]) * 2.0f;
+
+			const float kneeWidths[] = { 0.0f, 12.0f };
+			for (float fKneeWidth : kneeWidths)
+			{
+				CGainComputer computer;
+				computer.setParameters(-24.0f, 4.0f, fKneeWidth);
+
+				const double fNs = timeRuns(nChannels, nBlockSize, [&](int, int nStart, int nSamples)
+				{
+					computer.computeBlock(&detector[nStart], &output[0], nSamples, 1.0f);
+					g_fSink = output[nSamples - 1];
+				});
+
+				report("computeBlock", fKneeWidth > 0 ? "soft knee" : "hard knee", nChannels, nBlockSize, fNs);
+			}
+		}
+
+	return 0;
+}
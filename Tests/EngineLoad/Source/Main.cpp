@@ -0,0 +1,166 @@
+/*
+==============================================================================
+
+Main.cpp
+Author: Filipe Borato
+
+==============================================================================
+*/
+
+// How many compressors a machine runs in real time: N CompressorEngines (the plugin
+// without its wrapper, see HeadlessHeader.h) process stereo blocks the way a host's audio
+// threads would, spread over a ThreadPool with one thread per core. For N = 1, 2, 4 ... 512
+// it prints the throughput as a multiple of real time, the mean and worst wall time of a
+// block across all N against the block's deadline, and how many blocks missed it.
+//
+//   EngineLoad [block size = 128] [oversampling 0/1/2 = 0] [seconds = 2]
+//
+// Cache-miss counts are not reported: JUCE has no access to the CPU's performance
+// counters and reading them needs perf, VTune or Instruments with their own privileges;
+// run the tool under one of those for them.
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "../../../Source/CompressorEngine.h"
+
+namespace
+{
+	const double SAMPLE_RATE = 48000.0;
+	const int NUM_CHANNELS = 2;
+	const int MAX_INSTANCES = 512;
+	const int WARM_UP_BLOCKS = 16;
+
+	struct Instance
+	{
+		CompressorEngine engine;
+		AudioSampleBuffer buffer;
+	};
+
+	// one block of a consecutive range of instances, what one audio thread of a host does
+	class BlockJob : public ThreadPoolJob
+	{
+	public:
+		BlockJob(OwnedArray<Instance>& instances, int first, int last, const AudioSampleBuffer& input)
+			: ThreadPoolJob("Block")
+			, instances_(instances)
+			, first_(first)
+			, last_(last)
+			, input_(input)
+		{
+		}
+
+		void setStart(int start) { start_ = start; }
+
+		JobStatus runJob() override
+		{
+			const AudioSampleBuffer key;
+			for (int i = first_; i < last_; ++i)
+			{
+				AudioSampleBuffer& buffer = instances_[i]->buffer;
+				for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+					buffer.copyFrom(channel, 0, input_, channel, start_, buffer.getNumSamples());
+				instances_[i]->engine.process(buffer, key);
+			}
+			return jobHasFinished;
+		}
+
+	private:
+		OwnedArray<Instance>& instances_;
+		const int first_;
+		const int last_;
+		const AudioSampleBuffer& input_;
+		int start_ = 0;
+	};
+
+	// noise whose level moves in and out of compression, so every part of the engine works
+	AudioSampleBuffer makeInput(int num_samples)
+	{
+		AudioSampleBuffer input(NUM_CHANNELS, num_samples);
+		Random random(12345);
+		for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+			for (int i = 0; i < num_samples; ++i)
+			{
+				const float level = (i / 4800) % 2 == 0 ? 0.5f : 0.02f;
+				input.setSample(channel, i, level * (random.nextFloat() * 2.0f - 1.0f));
+			}
+		return input;
+	}
+
+	void runInstances(int num_instances, int block_size, int oversampling, int num_blocks, ThreadPool& pool,
+		const AudioSampleBuffer& input)
+	{
+		CompressorEngine::Parameters params;
+		params.threshold = -24.0f;
+		params.ratio = 4.0f;
+		params.kneeWidth = 6.0f;
+		params.attackTime = 5.0f;
+		params.releaseTime = 100.0f;
+		params.autoRelease = true;
+		params.oversampling = oversampling;
+
+		OwnedArray<Instance> instances;
+		for (int i = 0; i < num_instances; ++i)
+		{
+			Instance* instance = instances.add(new Instance());
+			instance->engine.prepare(SAMPLE_RATE, block_size, NUM_CHANNELS, params);
+			instance->buffer.setSize(NUM_CHANNELS, block_size);
+		}
+
+		// the instances are split evenly over the pool's threads
+		const int num_jobs = jmin(num_instances, pool.getNumThreads());
+		OwnedArray<BlockJob> jobs;
+		for (int j = 0; j < num_jobs; ++j)
+			jobs.add(new BlockJob(instances, j * num_instances / num_jobs, (j + 1) * num_instances / num_jobs, input));
+
+		const double deadline_us = 1.0e6 * block_size / SAMPLE_RATE;
+		const int input_blocks = input.getNumSamples() / block_size;
+		double total_us = 0.0, worst_us = 0.0;
+		int num_missed = 0;
+
+		for (int block = -WARM_UP_BLOCKS; block < num_blocks; ++block)
+		{
+			const int start = ((block + WARM_UP_BLOCKS) % input_blocks) * block_size;
+			const int64 ticks = Time::getHighResolutionTicks();
+
+			for (BlockJob* job : jobs)
+			{
+				job->setStart(start);
+				pool.addJob(job, false);
+			}
+			for (BlockJob* job : jobs)
+				pool.waitForJobToFinish(job, -1);
+
+			const double block_us = 1.0e6 * Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - ticks);
+			if (block < 0)
+				continue;
+
+			total_us += block_us;
+			worst_us = jmax(worst_us, block_us);
+			if (block_us > deadline_us)
+				++num_missed;
+		}
+
+		const double realtime = deadline_us * num_blocks / total_us * num_instances;
+		printf("%9d %12.1f %10.1f %10.1f %10.1f %8d\n", num_instances, realtime, total_us / num_blocks,
+			worst_us, deadline_us, num_missed);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int block_size = argc > 1 ? jlimit(16, 8192, atoi(argv[1])) : 128;
+	const int oversampling = argc > 2 ? jlimit(0, 2, atoi(argv[2])) : 0;
+	const double seconds = argc > 3 ? jlimit(0.1, 60.0, atof(argv[3])) : 2.0;
+	const int num_blocks = jmax(1, (int)(seconds * SAMPLE_RATE / block_size));
+
+	ThreadPool pool(SystemStats::getNumCpus());
+	const AudioSampleBuffer input = makeInput(jmax(block_size, (int)SAMPLE_RATE * 2));
+
+	printf("%d threads, %d sample blocks, %dx oversampling, %.1f s per run\n", pool.getNumThreads(), block_size,
+		1 << oversampling, seconds);
+	printf("%9s %12s %10s %10s %10s %8s\n", "instances", "x realtime", "mean us", "worst us", "deadline", "missed");
+
+	for (int num_instances = 1; num_instances <= MAX_INSTANCES; num_instances *= 2)
+		runInstances(num_instances, block_size, oversampling, num_blocks, pool, input);
+
+	return 0;
+}
@@ -0,0 +1,235 @@
+/*
+==============================================================================
+
+GoldenCheck.cpp
+Author: Filipe Borato
+
+==============================================================================
+*/
+
+// Pins the output of the detector and gain stage: reference signals go through the block
+// path the engine runs (detectBlock() with its per-mode kernels and vector dB stage, the
+// skipBlock() shortcut below the knee, CGainComputer::computeBlock()) and through the
+// scalar path it replaced (detect() per sample, lagrpol and pow), for every detect mode,
+// time constant style, log setting, knee and auto release. Each row reports whether the
+// two are bit exact, the largest absolute difference and the null depth of the compressed
+// signals against each other; it returns non-zero when a row is past the tolerances.
+// Build it as TestSources.h describes.
+
+#include "TestSources.h"
+#include <vector>
+
+namespace
+{
+	const float SAMPLE_RATE = 48000.0f;
+	const int NUM_SAMPLES = 72000;
+	const int BLOCK_SIZE = 61; // odd, so the vector loops have a tail in every block
+
+	const float ATTACK_MSEC = 10.0f;
+	const float RELEASE_MSEC = 200.0f;
+	const float THRESHOLD_DB = -24.0f;
+	const float RATIO = 4.0f;
+
+	// log rows compare gains, the others the linear envelope
+	const double MAX_GAIN_ERROR = 1.0e-5;
+	const double MAX_ENVELOPE_ERROR = 1.0e-6;
+	const double MAX_NULL_DEPTH_DB = -100.0;
+
+	int g_nFailures = 0;
+
+	enum Signal { SINE, NOISE, IMPULSES, BURSTS, NUM_SIGNALS };
+	const char* const SIGNAL_NAMES[NUM_SIGNALS] = { "sine", "noise", "impulses", "bursts" };
+	const char* const MODE_NAMES[3] = { "peak", "ms", "rms" };
+
+	// sines and noise keep the detector busy; the click trains and the bursts (loud, -70dB,
+	// silent in turn) compress, then spend blocks below the knee and go through skipBlock()
+	std::vector<float> makeSignal(Signal signal)
+	{
+		std::vector<float> samples(NUM_SAMPLES, 0.0f);
+		const double pi = 3.14159265358979323846;
+		unsigned int uSeed = 12345;
+
+		for (int i = 0; i < NUM_SAMPLES; ++i)
+		{
+			const float fSine = (float)sin(2.0 * pi * 997.0 * i / SAMPLE_RATE);
+			switch (signal)
+			{
+			case SINE:
+				samples[i] = 0.5f * fSine;
+				break;
+			case NOISE:
+				uSeed = uSeed * 1664525u + 1013904223u;
+				samples[i] = 0.25f * ((float)(uSeed >> 8) / 8388608.0f - 1.0f);
+				break;
+			case IMPULSES:
+				samples[i] = i % 9600 < 2400 && i % 24 == 0 ? 1.0f : 0.0f; // 2kHz clicks, then silence
+				break;
+			default:
+			{
+				const int nPart = (i / 12000) % 3;
+				samples[i] = nPart == 0 ? 0.7f * fSine : (nPart == 1 ? 0.0003f * fSine : 0.0f);
+				break;
+			}
+			}
+		}
+
+		return samples;
+	}
+
+	struct Setting
+	{
+		UINT uDetectMode;
+		bool bAnalogTC;
+		bool bLogDetector;
+		float fKneeWidth;
+		bool bAutoRelease;
+	};
+
+	// the scalar path: detect() per sample. detect() has no auto release, so that runs as a
+	// fast and a slow detector with the coefficients setAutoRelease() uses, and the higher one
+	std::vector<double> renderReference(const std::vector<float>& input, const Setting& setting)
+	{
+		CEnvelopeDetector fast, slow;
+		const float fSlowAttack_mSec = std::max(ATTACK_MSEC * AUTO_RELEASE_SLOW_ATTACK_FACTOR,
+			AUTO_RELEASE_MIN_SLOW_ATTACK_MSEC);
+		fast.init(SAMPLE_RATE, ATTACK_MSEC, setting.bAutoRelease ? RELEASE_MSEC / AUTO_RELEASE_RATIO : RELEASE_MSEC,
+			setting.bAnalogTC, setting.uDetectMode, false);
+		slow.init(SAMPLE_RATE, fSlowAttack_mSec, RELEASE_MSEC, setting.bAnalogTC, setting.uDetectMode, false);
+
+		std::vector<double> output(input.size());
+		for (size_t i = 0; i < input.size(); ++i)
+		{
+			double fEnvelope = fast.detect(input[i]);
+			if (setting.bAutoRelease)
+				fEnvelope = std::max(fEnvelope, (double)slow.detect(input[i]));
+
+			if (!setting.bLogDetector)
+			{
+				output[i] = fEnvelope;
+				continue;
+			}
+
+			const double fdB = fEnvelope <= 0 ? -96.0 : 20.0 * log10(fEnvelope);
+			output[i] = referenceGain(fdB, THRESHOLD_DB, RATIO, setting.fKneeWidth);
+		}
+
+		return output;
+	}
+
+	// the block path as CompressorEngine runs it, skipping blocks that stay below the knee
+	std::vector<double> renderBlocks(const std::vector<float>& input, const Setting& setting, int& nSkipped)
+	{
+		CEnvelopeDetector detector;
+		detector.init(SAMPLE_RATE, ATTACK_MSEC, RELEASE_MSEC, setting.bAnalogTC, setting.uDetectMode,
+			setting.bLogDetector);
+		detector.setAutoRelease(setting.bAutoRelease);
+
+		CGainComputer computer;
+		computer.setParameters(THRESHOLD_DB, RATIO, setting.fKneeWidth);
+
+		std::vector<double> output(input.size());
+		float buffer[BLOCK_SIZE];
+		nSkipped = 0;
+
+		for (int nStart = 0; nStart < (int)input.size(); nStart += BLOCK_SIZE)
+		{
+			const float* pInput = &input[nStart];
+			const int nSamples = std::min(BLOCK_SIZE, (int)input.size() - nStart);
+
+			if (setting.bLogDetector)
+			{
+				float fPeak = 0.0f;
+				for (int i = 0; i < nSamples; ++i)
+					fPeak = std::max(fPeak, fabsf(pInput[i]));
+
+				if (detector.staysBelow(fPeak, computer.getUnityLimit()))
+				{
+					detector.skipBlock(pInput, nSamples, fPeak);
+					std::fill(buffer, buffer + nSamples, 1.0f);
+					++nSkipped;
+				}
+				else
+				{
+					detector.detectBlock(pInput, buffer, nSamples);
+					computer.computeBlock(buffer, buffer, nSamples);
+				}
+			}
+			else
+			{
+				detector.detectBlock(pInput, buffer, nSamples);
+			}
+
+			for (int i = 0; i < nSamples; ++i)
+				output[nStart + i] = buffer[i];
+		}
+
+		return output;
+	}
+
+	void checkSetting(Signal signal, const std::vector<float>& input, const Setting& setting)
+	{
+		int nSkipped = 0;
+		const std::vector<double> reference = renderReference(input, setting);
+		const std::vector<double> blocks = renderBlocks(input, setting, nSkipped);
+
+		// the envelope rows null the envelopes, the gain rows the compressed signals
+		bool bBitExact = true;
+		double fMaxError = 0.0, fErrorEnergy = 0.0, fEnergy = 0.0;
+		for (size_t i = 0; i < input.size(); ++i)
+		{
+			const float fBlock = (float)blocks[i];
+			bBitExact = bBitExact && fBlock == (float)reference[i];
+			fMaxError = std::max(fMaxError, fabs(blocks[i] - reference[i]));
+
+			const double fScale = setting.bLogDetector ? input[i] : 1.0;
+			const double fDifference = (blocks[i] - reference[i]) * fScale;
+			fErrorEnergy += fDifference * fDifference;
+			fEnergy += reference[i] * fScale * reference[i] * fScale;
+		}
+
+		const double fNullDepth = fErrorEnergy > 0 ? 10.0 * log10(fErrorEnergy / fEnergy) : -INFINITY;
+		const double fMaxAllowed = setting.bLogDetector ? MAX_GAIN_ERROR : MAX_ENVELOPE_ERROR;
+		const bool bPassed = fMaxError <= fMaxAllowed && fNullDepth <= MAX_NULL_DEPTH_DB;
+		if (!bPassed)
+			++g_nFailures;
+
+		char szKnee[16] = "-";
+		if (setting.bLogDetector)
+			snprintf(szKnee, sizeof(szKnee), "%g", setting.fKneeWidth);
+
+		printf("%-9s %-5s %-8s %-4s %-5s %-4s %-9s %9.3g %9.1f %7d  %s\n", SIGNAL_NAMES[signal],
+			MODE_NAMES[setting.uDetectMode], setting.bAnalogTC ? "analog" : "digital",
+			setting.bLogDetector ? "on" : "off", szKnee, setting.bAutoRelease ? "on" : "off",
+			bBitExact ? "yes" : "no", fMaxError, fNullDepth, nSkipped, bPassed ? "ok" : "FAILED");
+	}
+}
+
+int main()
+{
+	printf("%-9s %-5s %-8s %-4s %-5s %-4s %-9s %9s %9s %7s\n", "signal", "mode", "tc", "log", "knee",
+		"auto", "bitexact", "max abs", "null dB", "skipped");
+
+	const float kneeWidths[] = { 0.0f, 12.0f };
+	for (int nSignal = 0; nSignal < NUM_SIGNALS; ++nSignal)
+	{
+		const Signal signal = (Signal)nSignal;
+		const std::vector<float> input = makeSignal(signal);
+
+		for (UINT uMode = 0; uMode < 3; ++uMode)
+			for (int nAnalog = 0; nAnalog < 2; ++nAnalog)
+				for (int nLog = 0; nLog < 2; ++nLog)
+					for (int nAuto = 0; nAuto < 2; ++nAuto)
+						for (float fKneeWidth : kneeWidths)
+						{
+							// the knee only matters once there is a gain
+							if (nLog == 0 && fKneeWidth != kneeWidths[0])
+								continue;
+
+							const Setting setting = { uMode, nAnalog != 0, nLog != 0, fKneeWidth, nAuto != 0 };
+							checkSetting(signal, input, setting);
+						}
+	}
+
+	printf("%s\n", g_nFailures == 0 ? "all rows ok" : "FAILED");
+	return g_nFailures == 0 ? 0 : 1;
+}
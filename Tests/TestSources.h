@@ -0,0 +1,45 @@
+/*
+==============================================================================
+
+TestSources.h
+Author: Filipe Borato
+
+==============================================================================
+*/
+#pragma once
+
+// The DSP sources the checks in this folder run, compiled into the check's own translation
+// unit, so each check builds with a single compiler command and needs no JUCE:
+//
+//   g++ -O2 -o <Check> <Check>.cpp
+//   cl /O2 /EHsc /D_WINDOWS <Check>.cpp
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#if !(defined _WINDOWS || defined _WINDLL)
+// the DSP sources use the min/max windows.h provides
+inline double min(double a, double b) { return a < b ? a : b; }
+inline double max(double a, double b) { return a > b ? a : b; }
+#endif
+
+#include "../Source/EnvelopeDetector.cpp"
+#include "../Source/GainComputer.cpp"
+
+// the curve as calcCompressorGain() computed it before CGainComputer: lagrpol across the
+// knee and pow() for the gain
+inline double referenceGain(double fDetectorValue, double fThreshold, double fRatio, double fKneeWidth)
+{
+	double CS = 1.0 - 1.0 / fRatio;
+	if (fKneeWidth > 0 && fDetectorValue > fThreshold - fKneeWidth / 2.0 &&
+		fDetectorValue < fThreshold + fKneeWidth / 2.0)
+	{
+		double x[2] = { fThreshold - fKneeWidth / 2.0, std::min(0.0, fThreshold + fKneeWidth / 2.0) };
+		double y[2] = { 0.0, CS };
+		CS = lagrpol(&x[0], &y[0], 2, fDetectorValue);
+	}
+
+	const double yG = std::min(0.0, CS * (fThreshold - fDetectorValue));
+	return pow(10.0, yG / 20.0);
+}